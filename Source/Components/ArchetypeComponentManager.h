@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ComponentManager.h"
+#include "../Containers/ArchetypeStorage.h"
+
+namespace JoeEngine {
+    //! The Archetype Component Manager class
+    /*!
+      Compatibility layer that exposes one component type stored in the engine's JEArchetypeStorage through the regular
+      JEComponentManager interface, so archetype-backed component types work with the engine's AddComponent(), GetComponent(),
+      SetComponent() and entity destruction just like PackedArray-backed ones.
+      Register one with JEEngineInstance::RegisterArchetypeComponent(). Systems that touch several components should iterate the
+      archetype storage directly with ForEachChunk()/ForEach() rather than going through this class per entity.
+      \sa JEArchetypeStorage, JEEngineInstance
+    */
+    template <typename T>
+    class JEArchetypeComponentManager : public JEComponentManager {
+    private:
+        //! Archetype storage.
+        /*! The storage that holds this component type. Owned by the engine instance. */
+        JEArchetypeStorage* m_storage;
+
+    public:
+        //! Constructor.
+        /*!
+          \param storage the archetype storage to keep the components in.
+        */
+        JEArchetypeComponentManager(JEArchetypeStorage* storage) : m_storage(storage) {}
+
+        //! Destructor (default).
+        virtual ~JEArchetypeComponentManager() = default;
+
+        //! Update components.
+        /*!
+          Does nothing - archetype components are meant to be updated by systems iterating the archetype storage.
+          Overrides purely virtual function declared in JEComponentManager.
+          \param engineInstance a reference to the current JEEngineInstance object if needed for certain API calls
+        */
+        void Update(JEEngineInstance* engineInstance) override {}
+
+        //! Add new component.
+        /*!
+          Adds a new, default-constructed component to the specified entity, moving it to the matching archetype.
+          Overrides purely virtual function declared in JEComponentManager.
+          \param entityID the id of the entity to add the component to
+        */
+        void AddNewComponent(uint32_t entityID) override {
+            m_storage->AddComponent<T>(entityID, T());
+        }
+
+        //! Remove component.
+        /*!
+          Removes the component from the specified entity, moving it to the matching archetype.
+          Overrides purely virtual function declared in JEComponentManager.
+          \param entityID the id of the entity to remove the component from
+        */
+        void RemoveComponent(uint32_t entityID) override {
+            m_storage->RemoveComponent<T>(entityID);
+        }
+
+        //! Get component.
+        /*!
+          Gets the component attached to the entity ID. The pointer is only valid until components are next added or removed.
+          \param entityID the entity ID whose component to return
+          \return pointer to the component attached to the entity ID
+        */
+        T* GetComponent(uint32_t entityID) const {
+            return m_storage->GetComponent<T>(entityID);
+        }
+
+        //! Set component.
+        /*!
+          Sets the component attached to the entity ID, adding it if the entity does not have one yet.
+          \param entityID the entity ID whose component to set
+          \param comp the new component data
+        */
+        void SetComponent(uint32_t entityID, T comp) {
+            m_storage->AddComponent<T>(entityID, comp);
+        }
+    };
+}
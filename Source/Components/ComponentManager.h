@@ -1,10 +1,28 @@
 #pragma once
 
 #include <stdint.h>
+#include <vector>
 
 namespace JoeEngine {
     class JEEngineInstance;
 
+    //! Component access struct
+    /*!
+      Declares which component types a component manager's update reads and writes, as bitmasks of type IDs built with
+      JEComponentTypeId::GetMask(), so that the JESystemScheduler can run the updates of managers that do not conflict at the
+      same time. An exclusive update conflicts with every other update and always runs alone, on the thread that runs the frame.
+    */
+    typedef struct je_component_access_t {
+        //! Mask of the component types that are only read.
+        uint64_t reads;
+
+        //! Mask of the component types that are written.
+        uint64_t writes;
+
+        //! Whether the update must run alone, e.g. because it touches engine state other than components.
+        bool exclusive;
+    } ComponentAccess;
+
     //! The Component Manager class
     /*!
       Abstract base class for all component manager derived classes.
@@ -42,5 +60,60 @@ namespace JoeEngine {
           \param entityID the id of the entity to remove the transform component from
         */
         virtual void RemoveComponent(uint32_t entityID) = 0;
+
+        //! Add new components.
+        /*!
+          Adds new components for a batch of entities, e.g. when spawning many entities at once.
+          Defaults to calling AddNewComponent() for each entity. Derived classes can override this to reserve storage once.
+          \param entityIDs the ids of the entities to add the component to
+        */
+        virtual void AddNewComponents(const std::vector<uint32_t>& entityIDs) {
+            for (uint32_t entityID : entityIDs) {
+                AddNewComponent(entityID);
+            }
+        }
+
+        //! Remove components.
+        /*!
+          Removes the components of a batch of entities, e.g. when destroying many entities at once.
+          Defaults to calling RemoveComponent() for each entity.
+          \param entityIDs the ids of the entities to remove the component from
+        */
+        virtual void RemoveComponents(const std::vector<uint32_t>& entityIDs) {
+            for (uint32_t entityID : entityIDs) {
+                RemoveComponent(entityID);
+            }
+        }
+
+        //! Get component access.
+        /*!
+          Declares the component types that Update() and UpdateChunk() read and write. Only entity destruction via
+          JEEngineInstance::DestroyEntity() and read-only engine API calls are allowed from a non-exclusive update.
+          Defaults to an exclusive update, which behaves exactly like a serial update in registration order.
+          \return the component types accessed by this manager's update.
+        */
+        virtual ComponentAccess GetComponentAccess() const {
+            return { 0, 0, true };
+        }
+
+        //! Get number of update chunks.
+        /*!
+          Number of independent chunks this manager's update can be split into, queried once per frame. If greater than one (and
+          the update is not exclusive), UpdateChunk() is invoked once per chunk, possibly concurrently, instead of Update().
+          Defaults to zero, i.e. Update() is always used.
+          \return the number of update chunks.
+        */
+        virtual uint32_t GetNumUpdateChunks() const {
+            return 0;
+        }
+
+        //! Update a chunk of components.
+        /*!
+          Updates one chunk of the stored components. Different chunks must touch disjoint components.
+          \param engineInstance a reference to the current JEEngineInstance object if needed for certain API calls
+          \param chunkIndex the chunk to update, in [0, numChunks).
+          \param numChunks the number of chunks returned by GetNumUpdateChunks() this frame.
+        */
+        virtual void UpdateChunk(JEEngineInstance* engineInstance, uint32_t chunkIndex, uint32_t numChunks) {}
     };
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <stdexcept>
+
+namespace JoeEngine {
+    //! The Component Type ID class
+    /*!
+      Hands out a small, dense integer ID per component type, so that the engine can look up a component type's manager with a
+      plain array index rather than hashing a std::type_index on every access.
+      IDs are assigned the first time a type is queried and are stable for the lifetime of the process.
+      \sa JEEngineInstance
+    */
+    class JEComponentTypeId {
+    private:
+        //! Get the next unused type ID.
+        //! Atomic, as different types may be queried for the first time from different threads.
+        static uint32_t NextId() {
+            static std::atomic<uint32_t> counter(0);
+            return counter++;
+        }
+
+    public:
+        //! Get the type ID of the specified component type.
+        /*! \return the type ID of component type T. */
+        template <typename T>
+        static uint32_t Get() {
+            static const uint32_t id = NextId();
+            return id;
+        }
+
+        //! Get a bitmask with the bit of each specified component type's ID set.
+        /*!
+          Throws an error if a type ID does not fit in the mask.
+          \return the mask of component types Ts.
+        */
+        template <typename... Ts>
+        static uint64_t GetMask() {
+            const uint32_t ids[] = { Get<Ts>()... };
+            uint64_t mask = 0;
+            for (uint32_t id : ids) {
+                if (id >= 64) {
+                    throw std::runtime_error("Too many component types for a component type mask");
+                }
+                mask |= 1ull << id;
+            }
+            return mask;
+        }
+    };
+}
@@ -22,12 +22,17 @@ namespace JoeEngine {
     } GeomType;
 
     //! Material Settings enum
-    /*! Indicates what material settings this material component has active/inactive. */
+    /*!
+      Indicates what material settings this material component has active/inactive.
+      OCCLUDER is not part of ALL_SETTINGS: occluder meshes are rasterized on the CPU every frame, so they are designated
+      explicitly and should be large, simple meshes (walls, buildings, terrain).
+    */
     typedef enum JE_MATERIAL_SETTINGS : uint32_t {
         NO_SETTINGS = 0x0,
         RECEIVES_SHADOWS = 0x1,
         CASTS_SHADOWS = 0x2,
-        ALL_SETTINGS = 0xF
+        ALL_SETTINGS = 0xF,
+        OCCLUDER = 0x10
     } MaterialSettings;
 
     //! The Material Component class
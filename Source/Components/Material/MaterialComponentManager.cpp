@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "MaterialComponentManager.h"
+#include "../ComponentTypeId.h"
 
 namespace JoeEngine {
     void JEMaterialComponentManager::Update(JEEngineInstance* engineInstance) {
@@ -7,12 +10,38 @@ namespace JoeEngine {
         }*/
     }
 
+    ComponentAccess JEMaterialComponentManager::GetComponentAccess() const {
+        return { 0, JEComponentTypeId::GetMask<MaterialComponent>(), false };
+    }
+
     void JEMaterialComponentManager::AddNewComponent(uint32_t entityID) {
         m_materialComponents.AddElement(entityID, MaterialComponent());
+        m_changedEntities.push_back(entityID);
     }
 
     void JEMaterialComponentManager::RemoveComponent(uint32_t id) {
         m_materialComponents[id] = MaterialComponent();
+        m_changedEntities.push_back(id);
+    }
+
+    void JEMaterialComponentManager::AddNewComponents(const std::vector<uint32_t>& entityIDs) {
+        uint32_t maxID = 0;
+        for (uint32_t id : entityIDs) {
+            maxID = std::max(maxID, id);
+        }
+
+        m_materialComponents.Reserve(m_materialComponents.Size() + (uint32_t)entityIDs.size(), maxID + 1);
+        for (uint32_t id : entityIDs) {
+            m_materialComponents.AddElement(id, MaterialComponent());
+        }
+        m_changedEntities.insert(m_changedEntities.end(), entityIDs.begin(), entityIDs.end());
+    }
+
+    void JEMaterialComponentManager::RemoveComponents(const std::vector<uint32_t>& entityIDs) {
+        for (uint32_t id : entityIDs) {
+            m_materialComponents[id] = MaterialComponent();
+        }
+        m_changedEntities.insert(m_changedEntities.end(), entityIDs.begin(), entityIDs.end());
     }
 
     MaterialComponent* JEMaterialComponentManager::GetComponent(uint32_t entityID) const {
@@ -22,9 +51,18 @@ namespace JoeEngine {
 
     void JEMaterialComponentManager::SetComponent(uint32_t entityID, MaterialComponent newComp) {
         m_materialComponents[entityID] = newComp;
+        m_changedEntities.push_back(entityID);
     }
 
     const PackedArray<MaterialComponent>& JEMaterialComponentManager::GetComponentList() const {
         return m_materialComponents;
     }
+
+    const std::vector<uint32_t>& JEMaterialComponentManager::GetChangedEntities() const {
+        return m_changedEntities;
+    }
+
+    void JEMaterialComponentManager::ClearChangedEntities() {
+        m_changedEntities.clear();
+    }
 }
@@ -17,6 +17,10 @@ namespace JoeEngine {
         /*! Manages all material component data. */
         PackedArray<MaterialComponent> m_materialComponents;
 
+        //! Entity IDs whose material component was added, set or removed since the last call to ClearChangedEntities().
+        /*! May contain duplicates. */
+        std::vector<uint32_t> m_changedEntities;
+
     public:
         //! Default constructor.
         /*! No specific behavior. */
@@ -40,6 +44,14 @@ namespace JoeEngine {
         */
         void Update(JEEngineInstance* engineInstance) override;
 
+        //! Get component access.
+        /*!
+          Declares that updating material components only writes material components.
+          Overrides virtual function declared in JEComponentManager.
+          \return the component types accessed by this manager's update.
+        */
+        ComponentAccess GetComponentAccess() const override;
+
         //! Add new material component.
         /*!
           Adds a new, default-constructed material component to the packed array of material components
@@ -58,9 +70,27 @@ namespace JoeEngine {
         */
         void RemoveComponent(uint32_t entityID) override;
 
+        //! Add new material components for a batch of entities.
+        /*!
+          Reserves room in the packed array of material components once, then adds a default-constructed material component
+          for each entity.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to add the material component to
+        */
+        void AddNewComponents(const std::vector<uint32_t>& entityIDs) override;
+
+        //! Remove material components for a batch of entities.
+        /*!
+          Resets the material component of each entity and appends all of them to the changed entities list at once.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to remove the material component from
+        */
+        void RemoveComponents(const std::vector<uint32_t>& entityIDs) override;
+
         //! Get material component.
         /*!
           Gets the material component attached to the entity ID.
+          Changes made through the returned pointer are not tracked; use SetComponent() to change an entity's material.
           \param entityID the entity ID whose material component to return
           \return pointer to the material component attached to the entity ID
         */
@@ -80,5 +110,16 @@ namespace JoeEngine {
           \return the list of mesh components.
         */
         const PackedArray<MaterialComponent>& GetComponentList() const;
+
+        //! Get changed entities.
+        /*!
+          Gets the IDs of the entities whose material component was added, set or removed since the last call to
+          ClearChangedEntities(), e.g. so that cached draw sort keys can be updated.
+          \return the list of changed entity IDs. May contain duplicates.
+        */
+        const std::vector<uint32_t>& GetChangedEntities() const;
+
+        //! Clear the list of changed entities.
+        void ClearChangedEntities();
     };
 }
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "MeshComponentManager.h"
+#include "../ComponentTypeId.h"
 
 namespace JoeEngine {
     void JEMeshComponentManager::Update(JEEngineInstance* engineInstance) {
@@ -7,12 +10,38 @@ namespace JoeEngine {
         }*/
     }
 
+    ComponentAccess JEMeshComponentManager::GetComponentAccess() const {
+        return { 0, JEComponentTypeId::GetMask<MeshComponent>(), false };
+    }
+
     void JEMeshComponentManager::AddNewComponent(uint32_t id) {
         m_meshComponents.AddElement(id, MeshComponent());
+        m_changedEntities.push_back(id);
     }
 
     void JEMeshComponentManager::RemoveComponent(uint32_t id) {
         m_meshComponents[id] = MeshComponent(-1, MESH_TRIANGLES);
+        m_changedEntities.push_back(id);
+    }
+
+    void JEMeshComponentManager::AddNewComponents(const std::vector<uint32_t>& entityIDs) {
+        uint32_t maxID = 0;
+        for (uint32_t id : entityIDs) {
+            maxID = std::max(maxID, id);
+        }
+
+        m_meshComponents.Reserve(m_meshComponents.Size() + (uint32_t)entityIDs.size(), maxID + 1);
+        for (uint32_t id : entityIDs) {
+            m_meshComponents.AddElement(id, MeshComponent());
+        }
+        m_changedEntities.insert(m_changedEntities.end(), entityIDs.begin(), entityIDs.end());
+    }
+
+    void JEMeshComponentManager::RemoveComponents(const std::vector<uint32_t>& entityIDs) {
+        for (uint32_t id : entityIDs) {
+            m_meshComponents[id] = MeshComponent(-1, MESH_TRIANGLES);
+        }
+        m_changedEntities.insert(m_changedEntities.end(), entityIDs.begin(), entityIDs.end());
     }
 
     MeshComponent* JEMeshComponentManager::GetComponent(uint32_t id) const {
@@ -22,9 +51,18 @@ namespace JoeEngine {
 
     void JEMeshComponentManager::SetComponent(uint32_t id, MeshComponent meshComp) {
         m_meshComponents[id] = meshComp;
+        m_changedEntities.push_back(id);
     }
 
     const PackedArray<MeshComponent>& JEMeshComponentManager::GetComponentList() const {
         return m_meshComponents;
     }
+
+    const std::vector<uint32_t>& JEMeshComponentManager::GetChangedEntities() const {
+        return m_changedEntities;
+    }
+
+    void JEMeshComponentManager::ClearChangedEntities() {
+        m_changedEntities.clear();
+    }
 }
@@ -16,6 +16,10 @@ namespace JoeEngine {
         /*! Manages all mesh component data. */
         PackedArray<MeshComponent> m_meshComponents;
 
+        //! Entity IDs whose mesh component was added, set or removed since the last call to ClearChangedEntities().
+        /*! May contain duplicates. */
+        std::vector<uint32_t> m_changedEntities;
+
     public:
         //! Default constructor.
         /*! No specific behavior. */
@@ -38,6 +42,14 @@ namespace JoeEngine {
         */
         void Update(JEEngineInstance* engineInstance) override;
 
+        //! Get component access.
+        /*!
+          Declares that updating mesh components only writes mesh components.
+          Overrides virtual function declared in JEComponentManager.
+          \return the component types accessed by this manager's update.
+        */
+        ComponentAccess GetComponentAccess() const override;
+
         //! Add new mesh component.
         /*!
           Adds a new, default-constructed mesh component to the packed array of mesh components
@@ -56,9 +68,27 @@ namespace JoeEngine {
         */
         void RemoveComponent(uint32_t entityID) override;
 
+        //! Add new mesh components for a batch of entities.
+        /*!
+          Reserves room in the packed array of mesh components once, then adds a default-constructed mesh component
+          for each entity.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to add the mesh component to
+        */
+        void AddNewComponents(const std::vector<uint32_t>& entityIDs) override;
+
+        //! Remove mesh components for a batch of entities.
+        /*!
+          Resets the mesh component of each entity and appends all of them to the changed entities list at once.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to remove the mesh component from
+        */
+        void RemoveComponents(const std::vector<uint32_t>& entityIDs) override;
+
         //! Get mesh component.
         /*!
           Gets the mesh component attached to the entity ID.
+          Changes made through the returned pointer are not tracked; use SetComponent() to change an entity's mesh.
           \param entityID the entity ID whose mesh component to return
           \return pointer to the mesh component attached to the entity ID
         */
@@ -78,5 +108,16 @@ namespace JoeEngine {
           \return the list of mesh components.
         */
         const PackedArray<MeshComponent>& GetComponentList() const;
+
+        //! Get changed entities.
+        /*!
+          Gets the IDs of the entities whose mesh component was added, set or removed since the last call to
+          ClearChangedEntities(), e.g. so that bounds derived from the mesh can be updated.
+          \return the list of changed entity IDs. May contain duplicates.
+        */
+        const std::vector<uint32_t>& GetChangedEntities() const;
+
+        //! Clear the list of changed entities.
+        void ClearChangedEntities();
     };
 }
@@ -3,8 +3,9 @@
 using namespace JoeEngine;
 
 void RotatorComponent::Update(JEEngineInstance* engineInstance) {
-    TransformComponent* trans = engineInstance->GetComponent<TransformComponent, JETransformComponentManager>(m_entityId);
-    trans->SetTransform(trans->GetTransform() * glm::rotate(glm::mat4(1.0f), 0.025f, m_axis));
+    // The rotator is removed along with its entity, so its entity index is always live here
+    TransformComponent* trans = engineInstance->GetComponentManager<TransformComponent, JETransformComponentManager>()->GetComponent(m_entityId);
+    trans->SetRotation(trans->GetRotation() * glm::angleAxis(0.025f, glm::normalize(m_axis)));
     /*if (m_entityId & 0x1) {
         engineInstance->DestroyEntity(m_entityId);
     }*/
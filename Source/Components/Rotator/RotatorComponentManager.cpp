@@ -1,11 +1,34 @@
+#include <algorithm>
+
 #include "RotatorComponentManager.h"
 
+//! Number of rotator components per update chunk.
+constexpr uint32_t ROTATOR_UPDATE_CHUNK_SIZE = 4096;
+
 void RotatorComponentManager::Update(JoeEngine::JEEngineInstance* engineInstance) {
     for (RotatorComponent& r : m_rotatorComponents) {
         r.Update(engineInstance);
     }
 }
 
+JoeEngine::ComponentAccess RotatorComponentManager::GetComponentAccess() const {
+    return { JoeEngine::JEComponentTypeId::GetMask<RotatorComponent>(),
+             JoeEngine::JEComponentTypeId::GetMask<JoeEngine::TransformComponent>(), false };
+}
+
+uint32_t RotatorComponentManager::GetNumUpdateChunks() const {
+    return (m_rotatorComponents.Size() + ROTATOR_UPDATE_CHUNK_SIZE - 1) / ROTATOR_UPDATE_CHUNK_SIZE;
+}
+
+void RotatorComponentManager::UpdateChunk(JoeEngine::JEEngineInstance* engineInstance, uint32_t chunkIndex, uint32_t numChunks) {
+    // Each rotator only writes its own entity's transform, so chunks never touch the same data
+    std::vector<RotatorComponent>& rotators = m_rotatorComponents.GetData();
+    const uint32_t end = std::min((chunkIndex + 1) * ROTATOR_UPDATE_CHUNK_SIZE, m_rotatorComponents.Size());
+    for (uint32_t i = chunkIndex * ROTATOR_UPDATE_CHUNK_SIZE; i < end; ++i) {
+        rotators[i].Update(engineInstance);
+    }
+}
+
 void RotatorComponentManager::AddNewComponent(uint32_t entityID) {
     m_rotatorComponents.AddElement(entityID, RotatorComponent());
 }
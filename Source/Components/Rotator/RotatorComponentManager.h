@@ -36,6 +36,32 @@ public:
     */
     void Update(JoeEngine::JEEngineInstance* engineInstance) override;
 
+    //! Get component access.
+    /*!
+      Declares that updating rotator components reads rotator components and writes transform components.
+      Overrides virtual function declared in JEComponentManager.
+      \return the component types accessed by this manager's update.
+    */
+    JoeEngine::ComponentAccess GetComponentAccess() const override;
+
+    //! Get number of update chunks.
+    /*!
+      Splits the rotator components into chunks of a fixed size, so that many rotators are updated in parallel.
+      Overrides virtual function declared in JEComponentManager.
+      \return the number of update chunks.
+    */
+    uint32_t GetNumUpdateChunks() const override;
+
+    //! Update a chunk of rotator components.
+    /*!
+      Updates one contiguous range of the packed array of rotator components.
+      Overrides virtual function declared in JEComponentManager.
+      \param engineInstance a reference to the current JEEngineInstance object if needed for certain API calls
+      \param chunkIndex the chunk to update.
+      \param numChunks the number of chunks this frame.
+    */
+    void UpdateChunk(JoeEngine::JEEngineInstance* engineInstance, uint32_t chunkIndex, uint32_t numChunks) override;
+
     //! Add new rotator component.
     /*!
       Adds a new, default-constructed rotator component to the packed array of rotator components
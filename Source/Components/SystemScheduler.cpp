@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "SystemScheduler.h"
+#include "../Utils/ThreadPool.h"
+
+namespace JoeEngine {
+    bool JESystemScheduler::Conflicts(const ComponentAccess& a, const ComponentAccess& b) {
+        return a.exclusive || b.exclusive || (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+    }
+
+    void JESystemScheduler::RunSystemJob_MT(void* data) {
+        const JESystemJob* job = static_cast<const JESystemJob*>(data);
+        job->scheduler->RunJob(job->nodeIndex, job->chunkIndex);
+    }
+
+    void JESystemScheduler::BuildGraph(const std::vector<std::unique_ptr<JEComponentManager>>& managers) {
+        if (m_numNodes != managers.size()) {
+            m_numNodes = (uint32_t)managers.size();
+            m_nodes = std::make_unique<JESystemNode[]>(m_numNodes);
+        }
+
+        m_jobs.clear();
+        for (uint32_t i = 0; i < m_numNodes; ++i) {
+            JESystemNode& node = m_nodes[i];
+            node.manager = managers[i].get();
+            node.access = node.manager->GetComponentAccess();
+            node.numChunks = node.access.exclusive ? 0 : node.manager->GetNumUpdateChunks();
+            node.successors.clear();
+            node.firstJob = (uint32_t)m_jobs.size();
+            const uint32_t numJobs = std::max(node.numChunks, 1u);
+            node.remainingJobs.store(numJobs, std::memory_order_relaxed);
+            for (uint32_t c = 0; c < numJobs; ++c) {
+                m_jobs.push_back({ this, i, c });
+            }
+
+            // Depend on every earlier conflicting update, so conflicting updates keep their registration order
+            uint32_t numDependencies = 0;
+            for (uint32_t j = 0; j < i; ++j) {
+                if (Conflicts(m_nodes[j].access, node.access)) {
+                    m_nodes[j].successors.push_back(i);
+                    ++numDependencies;
+                }
+            }
+            node.remainingDependencies.store(numDependencies, std::memory_order_relaxed);
+        }
+    }
+
+    void JESystemScheduler::LaunchNode(uint32_t nodeIndex) {
+        const JESystemNode& node = m_nodes[nodeIndex];
+        const uint32_t numJobs = std::max(node.numChunks, 1u);
+        for (uint32_t j = node.firstJob; j < node.firstJob + numJobs; ++j) {
+            JEThreadPoolInstance.EnqueueJob({ RunSystemJob_MT, &m_jobs[j] }, m_jobCounter);
+        }
+    }
+
+    void JESystemScheduler::RunJob(uint32_t nodeIndex, uint32_t chunkIndex) {
+        JESystemNode& node = m_nodes[nodeIndex];
+        if (node.numChunks > 1) {
+            node.manager->UpdateChunk(m_engineInstance, chunkIndex, node.numChunks);
+        } else {
+            node.manager->Update(m_engineInstance);
+        }
+
+        if (node.remainingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // Launched successors are counted before this job is, so the counter cannot be done while updates are left.
+            // Exclusive successors are left to the thread in Run().
+            for (uint32_t successor : node.successors) {
+                JESystemNode& successorNode = m_nodes[successor];
+                if (successorNode.remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1 && !successorNode.access.exclusive) {
+                    LaunchNode(successor);
+                }
+            }
+        }
+    }
+
+    void JESystemScheduler::Run(JEEngineInstance* engineInstance, const std::vector<std::unique_ptr<JEComponentManager>>& managers) {
+        m_engineInstance = engineInstance;
+        BuildGraph(managers);
+
+        JEJobCounter jobCounter;
+        m_jobCounter = &jobCounter;
+        for (uint32_t i = 0; i < m_numNodes; ++i) {
+            const JESystemNode& node = m_nodes[i];
+            if (!node.access.exclusive && node.remainingDependencies.load(std::memory_order_relaxed) == 0) {
+                LaunchNode(i);
+            }
+        }
+
+        // Every earlier update is a dependency of an exclusive update, and every later one waits on it, so once all launched
+        // jobs are done it is ready and nothing else can be running. Run it right here; it launches the updates that follow.
+        for (uint32_t i = 0; i < m_numNodes; ++i) {
+            if (m_nodes[i].access.exclusive) {
+                JEThreadPoolInstance.Wait(jobCounter);
+                RunJob(i, 0);
+            }
+        }
+        JEThreadPoolInstance.Wait(jobCounter);
+        m_jobCounter = nullptr;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "ComponentManager.h"
+
+namespace JoeEngine {
+    class JEEngineInstance;
+    class JEJobCounter;
+
+    //! The System Scheduler class
+    /*!
+      Runs the per-frame updates of all component managers, in parallel where possible.
+      Each frame, the scheduler queries every manager's ComponentAccess and builds a dependency graph: a manager's update depends
+      on the update of every earlier-registered manager it conflicts with (one writes a component type the other reads or writes,
+      or either is exclusive). Updates without dependencies are launched on JEThreadPoolInstance right away, split into chunks if
+      the manager supports it, and the last job of each update launches the successors it was the last dependency of, so the
+      outcome is the same as updating all managers serially in registration order. All jobs are counted on one JEJobCounter that
+      the calling thread waits on.
+      Exclusive updates depend on every earlier update and are depended on by every later one. The calling thread runs each of
+      them alone once the counter is done.
+      A non-exclusive update may enqueue jobs of its own, as long as it waits on them with JEThreadPool::Wait().
+      \sa JEComponentManager, ComponentAccess, JEThreadPool
+    */
+    class JESystemScheduler {
+    private:
+        //! System node.
+        /*! One node of the dependency graph, i.e. one component manager's update this frame. */
+        typedef struct je_system_node_t {
+            //! The component manager to update.
+            JEComponentManager* manager;
+
+            //! Declared component access this frame.
+            ComponentAccess access;
+
+            //! Number of update chunks this frame, zero or one if Update() is used.
+            uint32_t numChunks;
+
+            //! Indices of the nodes that depend on this one.
+            std::vector<uint32_t> successors;
+
+            //! Number of nodes this one depends on that are not complete yet.
+            std::atomic<uint32_t> remainingDependencies;
+
+            //! Number of this node's jobs that are not complete yet.
+            std::atomic<uint32_t> remainingJobs;
+
+            //! Index of this node's first job in the job list.
+            uint32_t firstJob;
+        } JESystemNode;
+
+        //! System job.
+        /*! Data for one thread pool job: one chunk of a node's update, or the whole update. */
+        typedef struct je_system_job_t {
+            //! The scheduler that launched this job.
+            JESystemScheduler* scheduler;
+
+            //! Index of the node to update.
+            uint32_t nodeIndex;
+
+            //! Chunk to update, ignored if the node does not use chunks.
+            uint32_t chunkIndex;
+        } JESystemJob;
+
+        //! Graph nodes, one per component manager. Reallocated only when the number of managers changes.
+        std::unique_ptr<JESystemNode[]> m_nodes;
+
+        //! Number of graph nodes.
+        uint32_t m_numNodes;
+
+        //! Thread pool jobs of this frame, one per node and chunk. Built up front so that jobs can be launched from any thread.
+        std::vector<JESystemJob> m_jobs;
+
+        //! Counter of all jobs launched this frame. Only set during Run().
+        JEJobCounter* m_jobCounter;
+
+        //! Engine instance passed to the updates this frame.
+        JEEngineInstance* m_engineInstance;
+
+        //! Check whether two updates may not run at the same time.
+        static bool Conflicts(const ComponentAccess& a, const ComponentAccess& b);
+
+        //! Thread pool job function.
+        static void RunSystemJob_MT(void* data);
+
+        //! Build this frame's dependency graph and job list.
+        void BuildGraph(const std::vector<std::unique_ptr<JEComponentManager>>& managers);
+
+        //! Enqueue all jobs of a node on the thread pool.
+        void LaunchNode(uint32_t nodeIndex);
+
+        //! Run one job of a node and, if it was the node's last job, launch the non-exclusive successors it unblocked.
+        void RunJob(uint32_t nodeIndex, uint32_t chunkIndex);
+
+    public:
+        //! Default constructor.
+        /*! No specific behavior. */
+        JESystemScheduler() : m_numNodes(0), m_jobCounter(nullptr), m_engineInstance(nullptr) {}
+
+        //! Destructor (default).
+        ~JESystemScheduler() = default;
+
+        JESystemScheduler(const JESystemScheduler& scheduler) = delete;
+        JESystemScheduler& operator=(const JESystemScheduler& scheduler) = delete;
+
+        //! Update component managers.
+        /*!
+          Updates every component manager once and returns when all updates are complete.
+          \param engineInstance the engine instance to pass to each update.
+          \param managers the component managers, in registration order.
+        */
+        void Run(JEEngineInstance* engineInstance, const std::vector<std::unique_ptr<JEComponentManager>>& managers);
+    };
+}
@@ -3,66 +3,105 @@
 #include "glm/glm.hpp"
 #include "glm/gtx/quaternion.hpp"
 
+#include "TransformStore.h"
+
 namespace JoeEngine {
     //! The Transform Component class
     /*!
       Contains the necessary transformation info to be attached to a particular entity.
-      This consists of one each of a translation, rotation, and scale.
-      A cached transform matrix is also stored to prevent excessively computing the overall transformation
-      matrix from the stored translation, rotation, and scale data.
-      \sa JETransformComponentManager, JEVulkanRenderer
+      This consists of one each of a translation, rotation, and scale, plus the composed (cached) transform matrix.
+      The data itself lives in the structure-of-arrays JETransformStore owned by the transform component manager; this class is
+      a lightweight handle into that store that keeps the familiar per-entity API.
+      Setters only mark the transform as dirty. Cached transforms are composed once per frame, only for dirty transforms, by the
+      transform component manager rather than on every setter call.
+      A transform may be parented to another entity's transform, in which case its translation, rotation, scale and SetTransform()
+      are relative to the parent, while GetTransform() still returns the world transform.
+      \sa JETransformComponentManager, JETransformStore, JEVulkanRenderer
     */
     class TransformComponent {
     private:
-        //! Translation.
-        /*! Vector3 translation data of this component. */
-        glm::vec3 m_translation;
-
-        //! Rotation.
-        /*! Quaternion rotation data of this component. */
-        glm::quat m_rotation;
-
-        //! Scale.
-        /*! Vector3 scale data of this component. */
-        glm::vec3 m_scale;
+        //! Transform store.
+        /*! The store that holds this component's data. */
+        JETransformStore* m_store;
 
-        //! Cached transform.
-        /*! The overall transform of this component. */
-        glm::mat4 m_cachedTransform;
+        //! Entity ID.
+        /*! The entity this component is attached to, used to look up its data in the store. */
+        uint32_t m_entityId;
 
     public:
         //! Default constructor.
+        /*! Constructs an invalid handle that is not attached to any store. */
+        TransformComponent() : m_store(nullptr), m_entityId(0) {}
+
+        //! Constructor.
         /*!
-          Initializes all members to an appropriate transformation.
-          Translation - 0, 0, 0
-          Rotation - 0
-          Scale - 1, 1, 1
-          Cached transform - identity matrix
+          Constructs a handle to the specified entity's transform data.
+          \param store the transform store holding the data.
+          \param entityId the entity the component is attached to.
         */
-        TransformComponent() : m_translation(0, 0, 0), m_rotation(glm::angleAxis(0.0f, glm::vec3(0, 1, 0))), m_scale(1, 1, 1), m_cachedTransform(1.0f) {}
+        TransformComponent(JETransformStore* store, uint32_t entityId) : m_store(store), m_entityId(entityId) {}
 
         //! Destructor (default).
         ~TransformComponent() = default;
 
         //! Recompute cached transform.
         /*!
-          Updates the cached transform to reflect the stored translation, rotation, and scale data.
+          Immediately updates the cached transform to reflect the stored translation, rotation, and scale data.
           If the cached transform has any changes (e.g. via SetTransform()) that are not reflected in the stored translation, rotation,
-          and scale data, they will be lost.
-          This function is automatically called from SetTranslation(), SetRotation(), and SetScale().
+          and scale data, they will be lost. The parent's current cached transform is used as is; children of this transform are
+          updated during the next per-frame pass.
+          Normally there is no need to call this - the transform component manager recomputes all cached transforms once per frame.
           \sa SetTranslation(), SetRotation, SetScale(), SetTransform()
         */
         void RecomputeTransform() {
-            m_cachedTransform = glm::translate(glm::mat4(1.0f), m_translation) * glm::toMat4(m_rotation) * glm::scale(glm::mat4(1.0f), m_scale);
+            const uint32_t dataIdx = m_store->GetDataIndex(m_entityId);
+            m_store->ComposeWorldMatrices(dataIdx, dataIdx + 1);
         }
 
         //! Get cached transform.
         /*!
-          Returns the overall (cached) transform of this component.
+          Returns the overall (cached) world transform of this component, including any parent transforms.
           \return the cached transform
         */
         const glm::mat4& GetTransform() const {
-            return m_cachedTransform;
+            return m_store->GetWorldMatrix(m_entityId);
+        }
+
+        //! Get cached local transform.
+        /*!
+          Returns the cached transform of this component relative to its parent. Same as GetTransform() if there is no parent.
+          \return the cached local transform
+        */
+        const glm::mat4& GetLocalTransform() const {
+            return m_store->GetLocalMatrix(m_entityId);
+        }
+
+        //! Get parent.
+        /*!
+          Returns the entity ID whose transform this component is parented to.
+          \return the parent entity ID, or JETransformStore::JE_TRANSFORM_NO_PARENT if there is no parent
+        */
+        uint32_t GetParent() const {
+            return m_store->GetParent(m_entityId);
+        }
+
+        //! Set parent.
+        /*!
+          Parents this transform to the specified entity's transform. The translation, rotation and scale of this component
+          become relative to the parent, and the world transform follows the parent from the next frame on.
+          Throws an error if the parent entity has no transform or is a descendant of this one.
+          \param parentEntityId the entity ID to parent this transform to
+        */
+        void SetParent(uint32_t parentEntityId) {
+            m_store->SetParent(m_entityId, parentEntityId);
+        }
+
+        //! Clear parent.
+        /*!
+          Detaches this transform from its parent, if any. The local transform becomes the world transform.
+        */
+        void ClearParent() {
+            m_store->ClearParent(m_entityId);
         }
 
         //! Get translation.
@@ -70,8 +109,8 @@ namespace JoeEngine {
           Returns the translation data of this component.
           \return the translation data
         */
-        const glm::vec3& GetTranslation() const {
-            return m_translation;
+        glm::vec3 GetTranslation() const {
+            return m_store->GetTranslation(m_entityId);
         }
         
         //! Get rotation.
@@ -79,8 +118,8 @@ namespace JoeEngine {
           Returns the rotation data of this component.
           \return the rotation data
         */
-        const glm::quat& GetRotation() const {
-            return m_rotation;
+        glm::quat GetRotation() const {
+            return m_store->GetRotation(m_entityId);
         }
         
         //! Get scale.
@@ -88,69 +127,66 @@ namespace JoeEngine {
           Returns the scale data of this component.
           \return the scale data
         */
-        const glm::vec3& GetScale() const {
-            return m_scale;
+        glm::vec3 GetScale() const {
+            return m_store->GetScale(m_entityId);
         }
 
         //! Set translation.
         /*!
           Sets the translation data of this component to the specified translation vector.
-          Automatically calls RecomputeTransform().
+          The cached transform is recomputed at the end of the frame's component updates.
           \param newTranslation the new translation data
           \sa RecomputeTransform()
         */
         void SetTranslation(const glm::vec3& newTranslation) {
-            m_translation = newTranslation;
-            RecomputeTransform();
+            m_store->SetTranslation(m_entityId, newTranslation);
         }
 
         //! Set rotation.
         /*!
           Sets the rotation data of this component to the specified rotation quaternion.
-          Automatically calls RecomputeTransform().
+          The cached transform is recomputed at the end of the frame's component updates.
           \param newRotation the new rotation quaternion data
           \sa RecomputeTransform()
         */
         void SetRotation(const glm::quat& newRotation) {
-            m_rotation = newRotation;
-            RecomputeTransform();
+            m_store->SetRotation(m_entityId, newRotation);
         }
 
         //! Set rotation.
         /*!
           Sets the rotation data of this component to the specified rotation angle and axis.
-          Automatically calls RecomputeTransform().
+          The cached transform is recomputed at the end of the frame's component updates.
           \param angle the new rotation angle
           \param axis the new rotation axis
           \sa RecomputeTransform()
         */
         void SetRotation(const float angle, const glm::vec3& axis) {
-            m_rotation = glm::angleAxis(angle, axis);
-            RecomputeTransform();
+            m_store->SetRotation(m_entityId, glm::angleAxis(angle, axis));
         }
 
         //! Set scale.
         /*!
           Sets the scale data of this component to the specified scale vector.
-          Automatically calls RecomputeTransform().
+          The cached transform is recomputed at the end of the frame's component updates.
           \param newScale the new scale data
           \sa RecomputeTransform()
         */
         void SetScale(const glm::vec3& newScale) {
-            m_scale = newScale;
-            RecomputeTransform();
+            m_store->SetScale(m_entityId, newScale);
         }
 
         //! Set cached transform.
         /*!
-          Sets the overall (cached) transform data of this component to the specified transformation matrix.
-          Does NOT automatically call RecomputeTransform(). Changes made to the overall transformation via
-          this function will stick until RecomputeTransform() is called.
+          Sets the overall (cached) transform data of this component to the specified transformation matrix. If the component
+          has a parent, the matrix is relative to the parent.
+          Changes made to the overall transformation via this function will stick until the translation, rotation or scale
+          is changed again (or RecomputeTransform() is called).
           \param newTransform the new transformation data
           \sa RecomputeTransform()
         */
         void SetTransform(const glm::mat4& newTransform) {
-            m_cachedTransform = newTransform;
+            m_store->SetLocalMatrix(m_entityId, newTransform);
         }
     };
 }
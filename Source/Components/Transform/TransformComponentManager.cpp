@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "TransformComponentManager.h"
+#include "../ComponentTypeId.h"
 
 namespace JoeEngine {
     void JETransformComponentManager::Update(JEEngineInstance* engineInstance) {
@@ -7,15 +10,38 @@ namespace JoeEngine {
         }*/
     }
 
+    ComponentAccess JETransformComponentManager::GetComponentAccess() const {
+        return { 0, JEComponentTypeId::GetMask<TransformComponent>(), false };
+    }
+
     void JETransformComponentManager::AddNewComponent(uint32_t id) {
-        m_transformComponents.AddElement(id, TransformComponent());
+        m_transformStore.AddElement(id);
+        m_transformComponents.AddElement(id, TransformComponent(&m_transformStore, id));
     }
 
     void JETransformComponentManager::RemoveComponent(uint32_t id) {
-        m_transformComponents[id] = TransformComponent();
+        m_transformStore.ResetElement(id);
         //m_transformComponents.RemoveElement(id);
     }
 
+    void JETransformComponentManager::AddNewComponents(const std::vector<uint32_t>& entityIDs) {
+        uint32_t maxID = 0;
+        for (uint32_t id : entityIDs) {
+            maxID = std::max(maxID, id);
+        }
+
+        const uint32_t numElements = m_transformComponents.Size() + (uint32_t)entityIDs.size();
+        m_transformStore.Reserve(numElements, maxID + 1);
+        m_transformComponents.Reserve(numElements, maxID + 1);
+        for (uint32_t id : entityIDs) {
+            JETransformComponentManager::AddNewComponent(id);
+        }
+    }
+
+    void JETransformComponentManager::RemoveComponents(const std::vector<uint32_t>& entityIDs) {
+        m_transformStore.ResetElements(entityIDs);
+    }
+
     TransformComponent* JETransformComponentManager::GetComponent(uint32_t id) const {
         // This should be an ok const cast. The [-operator on std::vector only returns const refs.
         return const_cast<TransformComponent*>(&m_transformComponents[id]);
@@ -24,4 +50,12 @@ namespace JoeEngine {
     const PackedArray<TransformComponent>& JETransformComponentManager::GetComponentList() const {
         return m_transformComponents;
     }
+
+    const JETransformStore& JETransformComponentManager::GetTransformStore() const {
+        return m_transformStore;
+    }
+
+    void JETransformComponentManager::ComposeTransforms() {
+        m_transformStore.ComposeDirtyWorldMatrices();
+    }
 }
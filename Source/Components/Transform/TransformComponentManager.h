@@ -2,18 +2,24 @@
 
 #include "../ComponentManager.h"
 #include "TransformComponent.h"
+#include "TransformStore.h"
 #include "../../Containers/PackedArray.h"
 
 namespace JoeEngine {
     //! The Transform Component Manager class
     /*!
-      Contains all transform components in a packed array of data.
-      \sa JEEngineInstance
+      Owns the structure-of-arrays store of all transform data, along with a packed array of transform component handles
+      into that store.
+      \sa JEEngineInstance, JETransformStore
     */
     class JETransformComponentManager : public JEComponentManager {
     private:
+        //! Transform store.
+        /*! Holds all transform data (translation, rotation, scale and world matrix streams). */
+        JETransformStore m_transformStore;
+
         //! Packed array of transform components.
-        /*! Manages all transform component data. */
+        /*! Handles into the transform store, kept in the same dense order as the store. */
         PackedArray<TransformComponent> m_transformComponents;
 
     public:
@@ -38,6 +44,14 @@ namespace JoeEngine {
         */
         void Update(JEEngineInstance* engineInstance) override;
 
+        //! Get component access.
+        /*!
+          Declares that updating transform components only writes transform components.
+          Overrides virtual function declared in JEComponentManager.
+          \return the component types accessed by this manager's update.
+        */
+        ComponentAccess GetComponentAccess() const override;
+
         //! Add new transform component.
         /*!
           Adds a new, default-constructed transform component to the packed array of transform components
@@ -56,6 +70,23 @@ namespace JoeEngine {
         */
         void RemoveComponent(uint32_t entityID) override;
 
+        //! Add new transform components for a batch of entities.
+        /*!
+          Reserves room in the transform store and the packed array of transform components once, then adds a default
+          transform component for each entity.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to add the transform component to
+        */
+        void AddNewComponents(const std::vector<uint32_t>& entityIDs) override;
+
+        //! Remove transform components for a batch of entities.
+        /*!
+          Resets the transforms of all the entities in a single pass over the transform store.
+          Overrides virtual function declared in JEComponentManager.
+          \param entityIDs the ids of the entities to remove the transform component from
+        */
+        void RemoveComponents(const std::vector<uint32_t>& entityIDs) override;
+
         //! Get transform component.
         /*!
           Gets the transform component attached to the entity ID.
@@ -70,5 +101,21 @@ namespace JoeEngine {
           \return the packed array of transform components.
         */
         const PackedArray<TransformComponent>& GetComponentList() const;
+
+        //! Get the transform store.
+        /*!
+          Gets the structure-of-arrays transform store. Its dense order matches the packed array of transform components,
+          so the world matrix stream can be indexed in lockstep with the other built-in component lists.
+          \return the transform store.
+        */
+        const JETransformStore& GetTransformStore() const;
+
+        //! Compose transforms.
+        /*!
+          Recomputes the world matrices of all transforms changed since the last call (and of everything parented below them), in one batch.
+          Invoked by the engine once per frame, after all component managers have been updated.
+          The changed dense indices and the store's version number are available via GetTransformStore() afterwards.
+        */
+        void ComposeTransforms();
     };
 }
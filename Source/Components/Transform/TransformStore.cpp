@@ -0,0 +1,515 @@
+#include "JoeEngineConfig.h"
+
+#ifndef JOE_ENGINE_SIMD_NONE
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+
+#include "TransformStore.h"
+#include "../../Utils/ParallelFor.h"
+
+namespace JoeEngine {
+    void JETransformStore::AddElement(uint32_t entityID) {
+        if (entityID + 1 > m_indirectionMap.size()) {
+            m_indirectionMap.resize(entityID + 1, -1);
+        }
+
+        if (m_indirectionMap[entityID] != -1) {
+            // Already present, just reset it
+            ResetAt(m_indirectionMap[entityID]);
+            return;
+        }
+
+        m_indirectionMap[entityID] = (int)m_dataIndices.size();
+        m_dataIndices.push_back(entityID);
+
+        m_translationX.push_back(0.0f);
+        m_translationY.push_back(0.0f);
+        m_translationZ.push_back(0.0f);
+        m_rotationX.push_back(0.0f);
+        m_rotationY.push_back(0.0f);
+        m_rotationZ.push_back(0.0f);
+        m_rotationW.push_back(1.0f);
+        m_scaleX.push_back(1.0f);
+        m_scaleY.push_back(1.0f);
+        m_scaleZ.push_back(1.0f);
+        m_localMatrices.push_back(glm::mat4(1.0f));
+        m_worldMatrices.push_back(glm::mat4(1.0f));
+        m_parentIds.push_back(JE_TRANSFORM_NO_PARENT);
+        m_childCounts.push_back(0);
+        m_dirtyFlags.push_back(JE_TRANSFORM_CLEAN);
+        m_structureChanged = true;
+        m_hierarchyChanged = true;
+    }
+
+    void JETransformStore::Reserve(uint32_t numElements, uint32_t numIndices) {
+        if (numIndices > m_indirectionMap.size()) {
+            m_indirectionMap.resize(numIndices, -1);
+        }
+
+        m_dataIndices.reserve(numElements);
+        m_translationX.reserve(numElements);
+        m_translationY.reserve(numElements);
+        m_translationZ.reserve(numElements);
+        m_rotationX.reserve(numElements);
+        m_rotationY.reserve(numElements);
+        m_rotationZ.reserve(numElements);
+        m_rotationW.reserve(numElements);
+        m_scaleX.reserve(numElements);
+        m_scaleY.reserve(numElements);
+        m_scaleZ.reserve(numElements);
+        m_localMatrices.reserve(numElements);
+        m_worldMatrices.reserve(numElements);
+        m_parentIds.reserve(numElements);
+        m_childCounts.reserve(numElements);
+        m_dirtyFlags.reserve(numElements);
+    }
+
+    void JETransformStore::RemoveElement(uint32_t entityID) {
+        if (!Contains(entityID)) {
+            return;
+        }
+
+        const uint32_t dataIdx = m_indirectionMap[entityID];
+        DetachAt(dataIdx);
+
+        const uint32_t lastIdx = Size() - 1;
+        if (dataIdx != lastIdx) {
+            MoveElement(lastIdx, dataIdx);
+            m_dataIndices[dataIdx] = m_dataIndices[lastIdx];
+            m_indirectionMap[m_dataIndices[dataIdx]] = dataIdx;
+        }
+        m_indirectionMap[entityID] = -1;
+
+        m_dataIndices.pop_back();
+        m_translationX.pop_back();
+        m_translationY.pop_back();
+        m_translationZ.pop_back();
+        m_rotationX.pop_back();
+        m_rotationY.pop_back();
+        m_rotationZ.pop_back();
+        m_rotationW.pop_back();
+        m_scaleX.pop_back();
+        m_scaleY.pop_back();
+        m_scaleZ.pop_back();
+        m_localMatrices.pop_back();
+        m_worldMatrices.pop_back();
+        m_parentIds.pop_back();
+        m_childCounts.pop_back();
+        m_dirtyFlags.pop_back();
+        m_structureChanged = true;
+        m_hierarchyChanged = true;
+    }
+
+    void JETransformStore::ResetElement(uint32_t entityID) {
+        ResetAt(GetDataIndex(entityID));
+    }
+
+    void JETransformStore::ResetElements(const std::vector<uint32_t>& entityIDs) {
+        // Flags the reset elements that had children, indexed by entity ID. Only allocated if needed.
+        std::vector<uint8_t> orphaning;
+        for (uint32_t entityID : entityIDs) {
+            const uint32_t dataIdx = GetDataIndex(entityID);
+
+            // Detach from the parent here, skipping the child count of parents that are reset in this batch as well
+            const uint32_t parentID = m_parentIds[dataIdx];
+            if (parentID != JE_TRANSFORM_NO_PARENT) {
+                if (orphaning.empty() || !orphaning[parentID]) {
+                    --m_childCounts[m_indirectionMap[parentID]];
+                }
+                m_parentIds[dataIdx] = JE_TRANSFORM_NO_PARENT;
+                m_hierarchyChanged = true;
+            }
+
+            if (m_childCounts[dataIdx] > 0) {
+                if (orphaning.empty()) {
+                    orphaning.assign(m_indirectionMap.size(), 0);
+                }
+                orphaning[entityID] = 1;
+                m_childCounts[dataIdx] = 0;
+                m_hierarchyChanged = true;
+            }
+
+            // Already detached, so this only writes the default transform
+            ResetAt(dataIdx);
+        }
+
+        if (!orphaning.empty()) {
+            // Orphaned children become roots and keep their local transform
+            for (uint32_t i = 0; i < Size(); ++i) {
+                const uint32_t parentID = m_parentIds[i];
+                if (parentID != JE_TRANSFORM_NO_PARENT && orphaning[parentID]) {
+                    m_parentIds[i] = JE_TRANSFORM_NO_PARENT;
+                    MarkWorldStale(i);
+                }
+            }
+        }
+    }
+
+    void JETransformStore::ResetAt(uint32_t dataIdx) {
+        m_translationX[dataIdx] = 0.0f;
+        m_translationY[dataIdx] = 0.0f;
+        m_translationZ[dataIdx] = 0.0f;
+        m_rotationX[dataIdx] = 0.0f;
+        m_rotationY[dataIdx] = 0.0f;
+        m_rotationZ[dataIdx] = 0.0f;
+        m_rotationW[dataIdx] = 1.0f;
+        m_scaleX[dataIdx] = 1.0f;
+        m_scaleY[dataIdx] = 1.0f;
+        m_scaleZ[dataIdx] = 1.0f;
+        m_localMatrices[dataIdx] = glm::mat4(1.0f);
+        m_worldMatrices[dataIdx] = glm::mat4(1.0f);
+        // Report the reset so that consumers of the world matrix (e.g. the scene BVH) pick up the new identity transform
+        m_dirtyFlags[dataIdx] = JE_TRANSFORM_CHANGED;
+        DetachAt(dataIdx);
+        m_structureChanged = true;
+    }
+
+    void JETransformStore::DetachAt(uint32_t dataIdx) {
+        const uint32_t parentID = m_parentIds[dataIdx];
+        if (parentID != JE_TRANSFORM_NO_PARENT) {
+            --m_childCounts[m_indirectionMap[parentID]];
+            m_parentIds[dataIdx] = JE_TRANSFORM_NO_PARENT;
+            m_hierarchyChanged = true;
+        }
+
+        if (m_childCounts[dataIdx] > 0) {
+            // Orphaned children become roots and keep their local transform
+            const uint32_t entityID = m_dataIndices[dataIdx];
+            for (uint32_t i = 0; i < Size(); ++i) {
+                if (m_parentIds[i] == entityID) {
+                    m_parentIds[i] = JE_TRANSFORM_NO_PARENT;
+                    MarkWorldStale(i);
+                }
+            }
+            m_childCounts[dataIdx] = 0;
+            m_hierarchyChanged = true;
+        }
+    }
+
+    void JETransformStore::SetParent(uint32_t entityID, uint32_t parentID) {
+        const uint32_t dataIdx = GetDataIndex(entityID);
+        const uint32_t parentIdx = GetDataIndex(parentID);
+
+        // Walk up from the new parent to make sure this entity is not one of its ancestors
+        uint32_t ancestorID = parentID;
+        while (ancestorID != JE_TRANSFORM_NO_PARENT) {
+            if (ancestorID == entityID) {
+                throw std::runtime_error("Transform parenting would create a cycle");
+            }
+            ancestorID = m_parentIds[m_indirectionMap[ancestorID]];
+        }
+
+        const uint32_t oldParentID = m_parentIds[dataIdx];
+        if (oldParentID == parentID) {
+            return;
+        }
+        if (oldParentID != JE_TRANSFORM_NO_PARENT) {
+            --m_childCounts[m_indirectionMap[oldParentID]];
+        }
+
+        m_parentIds[dataIdx] = parentID;
+        ++m_childCounts[parentIdx];
+        MarkWorldStale(dataIdx);
+        m_hierarchyChanged = true;
+    }
+
+    void JETransformStore::ClearParent(uint32_t entityID) {
+        const uint32_t dataIdx = GetDataIndex(entityID);
+        const uint32_t parentID = m_parentIds[dataIdx];
+        if (parentID == JE_TRANSFORM_NO_PARENT) {
+            return;
+        }
+
+        --m_childCounts[m_indirectionMap[parentID]];
+        m_parentIds[dataIdx] = JE_TRANSFORM_NO_PARENT;
+        MarkWorldStale(dataIdx);
+        m_hierarchyChanged = true;
+    }
+
+    void JETransformStore::MoveElement(uint32_t srcIdx, uint32_t dstIdx) {
+        m_translationX[dstIdx] = m_translationX[srcIdx];
+        m_translationY[dstIdx] = m_translationY[srcIdx];
+        m_translationZ[dstIdx] = m_translationZ[srcIdx];
+        m_rotationX[dstIdx] = m_rotationX[srcIdx];
+        m_rotationY[dstIdx] = m_rotationY[srcIdx];
+        m_rotationZ[dstIdx] = m_rotationZ[srcIdx];
+        m_rotationW[dstIdx] = m_rotationW[srcIdx];
+        m_scaleX[dstIdx] = m_scaleX[srcIdx];
+        m_scaleY[dstIdx] = m_scaleY[srcIdx];
+        m_scaleZ[dstIdx] = m_scaleZ[srcIdx];
+        m_localMatrices[dstIdx] = m_localMatrices[srcIdx];
+        m_worldMatrices[dstIdx] = m_worldMatrices[srcIdx];
+        m_parentIds[dstIdx] = m_parentIds[srcIdx];
+        m_childCounts[dstIdx] = m_childCounts[srcIdx];
+        m_dirtyFlags[dstIdx] = m_dirtyFlags[srcIdx];
+    }
+
+    void JETransformStore::ComposeAt(uint32_t i) {
+        // Same as glm::translate(T) * glm::toMat4(R) * glm::scale(S), without the two full 4x4 multiplies
+        const float qx = m_rotationX[i];
+        const float qy = m_rotationY[i];
+        const float qz = m_rotationZ[i];
+        const float qw = m_rotationW[i];
+
+        const float qxx = qx * qx;
+        const float qyy = qy * qy;
+        const float qzz = qz * qz;
+        const float qxz = qx * qz;
+        const float qxy = qx * qy;
+        const float qyz = qy * qz;
+        const float qwx = qw * qx;
+        const float qwy = qw * qy;
+        const float qwz = qw * qz;
+
+        const float sx = m_scaleX[i];
+        const float sy = m_scaleY[i];
+        const float sz = m_scaleZ[i];
+
+        glm::mat4& m = m_localMatrices[i];
+        m[0] = glm::vec4((1.0f - 2.0f * (qyy + qzz)) * sx, 2.0f * (qxy + qwz) * sx, 2.0f * (qxz - qwy) * sx, 0.0f);
+        m[1] = glm::vec4(2.0f * (qxy - qwz) * sy, (1.0f - 2.0f * (qxx + qzz)) * sy, 2.0f * (qyz + qwx) * sy, 0.0f);
+        m[2] = glm::vec4(2.0f * (qxz + qwy) * sz, 2.0f * (qyz - qwx) * sz, (1.0f - 2.0f * (qxx + qyy)) * sz, 0.0f);
+        m[3] = glm::vec4(m_translationX[i], m_translationY[i], m_translationZ[i], 1.0f);
+    }
+
+    void JETransformStore::ComposeBlock8(uint32_t dataIdx) {
+        #ifdef JOE_ENGINE_SIMD_AVX2
+        // Each register holds one matrix entry for 8 different elements
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        alignas(32) float entries[12][8];
+
+        const __m256 qx = _mm256_loadu_ps(&m_rotationX[dataIdx]);
+        const __m256 qy = _mm256_loadu_ps(&m_rotationY[dataIdx]);
+        const __m256 qz = _mm256_loadu_ps(&m_rotationZ[dataIdx]);
+        const __m256 qw = _mm256_loadu_ps(&m_rotationW[dataIdx]);
+
+        const __m256 qxx = _mm256_mul_ps(qx, qx);
+        const __m256 qyy = _mm256_mul_ps(qy, qy);
+        const __m256 qzz = _mm256_mul_ps(qz, qz);
+        const __m256 qxz = _mm256_mul_ps(qx, qz);
+        const __m256 qxy = _mm256_mul_ps(qx, qy);
+        const __m256 qyz = _mm256_mul_ps(qy, qz);
+        const __m256 qwx = _mm256_mul_ps(qw, qx);
+        const __m256 qwy = _mm256_mul_ps(qw, qy);
+        const __m256 qwz = _mm256_mul_ps(qw, qz);
+
+        const __m256 sx = _mm256_loadu_ps(&m_scaleX[dataIdx]);
+        const __m256 sy = _mm256_loadu_ps(&m_scaleY[dataIdx]);
+        const __m256 sz = _mm256_loadu_ps(&m_scaleZ[dataIdx]);
+
+        // Column 0
+        _mm256_store_ps(entries[0], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qyy, qzz))), sx));
+        _mm256_store_ps(entries[1], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(qxy, qwz)), sx));
+        _mm256_store_ps(entries[2], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(qxz, qwy)), sx));
+
+        // Column 1
+        _mm256_store_ps(entries[3], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(qxy, qwz)), sy));
+        _mm256_store_ps(entries[4], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qxx, qzz))), sy));
+        _mm256_store_ps(entries[5], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(qyz, qwx)), sy));
+
+        // Column 2
+        _mm256_store_ps(entries[6], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(qxz, qwy)), sz));
+        _mm256_store_ps(entries[7], _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(qyz, qwx)), sz));
+        _mm256_store_ps(entries[8], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qxx, qyy))), sz));
+
+        // Column 3
+        _mm256_store_ps(entries[9], _mm256_loadu_ps(&m_translationX[dataIdx]));
+        _mm256_store_ps(entries[10], _mm256_loadu_ps(&m_translationY[dataIdx]));
+        _mm256_store_ps(entries[11], _mm256_loadu_ps(&m_translationZ[dataIdx]));
+
+        // Scatter back out to the (column-major) matrix stream
+        for (uint32_t j = 0; j < 8; ++j) {
+            glm::mat4& m = m_localMatrices[dataIdx + j];
+            m[0] = glm::vec4(entries[0][j], entries[1][j], entries[2][j], 0.0f);
+            m[1] = glm::vec4(entries[3][j], entries[4][j], entries[5][j], 0.0f);
+            m[2] = glm::vec4(entries[6][j], entries[7][j], entries[8][j], 0.0f);
+            m[3] = glm::vec4(entries[9][j], entries[10][j], entries[11][j], 1.0f);
+        }
+        #else
+        for (uint32_t j = 0; j < 8; ++j) {
+            ComposeAt(dataIdx + j);
+        }
+        #endif
+    }
+
+    void JETransformStore::ComposeWorldMatrices(uint32_t begin, uint32_t end) {
+        uint32_t i = begin;
+
+        #ifdef JOE_ENGINE_SIMD_AVX2
+        for (; i + 8 <= end; i += 8) {
+            ComposeBlock8(i);
+        }
+        #endif
+
+        for (; i < end; ++i) {
+            ComposeAt(i);
+        }
+
+        for (i = begin; i < end; ++i) {
+            const uint32_t parentID = m_parentIds[i];
+            if (parentID == JE_TRANSFORM_NO_PARENT) {
+                m_worldMatrices[i] = m_localMatrices[i];
+            } else {
+                m_worldMatrices[i] = m_worldMatrices[m_indirectionMap[parentID]] * m_localMatrices[i];
+            }
+            m_dirtyFlags[i] = JE_TRANSFORM_CHANGED;
+        }
+    }
+
+    void JETransformStore::RebuildHierarchyOrder() {
+        const uint32_t size = Size();
+
+        // Compute the depth of every element, walking up until an element with a known depth (or a root) is found
+        constexpr uint32_t unknownDepth = 0xFFFFFFFF;
+        std::vector<uint32_t> depths(size, unknownDepth);
+        std::vector<uint32_t> path;
+        uint32_t numLevels = size > 0 ? 1 : 0;
+        for (uint32_t i = 0; i < size; ++i) {
+            path.clear();
+            uint32_t idx = i;
+            while (depths[idx] == unknownDepth) {
+                path.push_back(idx);
+                const uint32_t parentID = m_parentIds[idx];
+                if (parentID == JE_TRANSFORM_NO_PARENT) {
+                    break;
+                }
+                idx = m_indirectionMap[parentID];
+            }
+
+            uint32_t depth = (depths[idx] == unknownDepth) ? 0 : depths[idx] + 1;
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                depths[*it] = depth++;
+            }
+            if (depth > numLevels) {
+                numLevels = depth;
+            }
+        }
+
+        // Counting sort by depth, keeping dense order within each level
+        m_levelOffsets.assign(numLevels + 1, 0);
+        for (uint32_t i = 0; i < size; ++i) {
+            ++m_levelOffsets[depths[i] + 1];
+        }
+        for (uint32_t l = 0; l < numLevels; ++l) {
+            m_levelOffsets[l + 1] += m_levelOffsets[l];
+        }
+
+        m_levelOrder.resize(size);
+        m_levelParents.resize(size);
+        std::vector<uint32_t> cursors(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+        for (uint32_t i = 0; i < size; ++i) {
+            const uint32_t pos = cursors[depths[i]]++;
+            const uint32_t parentID = m_parentIds[i];
+            m_levelOrder[pos] = i;
+            m_levelParents[pos] = (parentID == JE_TRANSFORM_NO_PARENT) ? JE_TRANSFORM_NO_PARENT : (uint32_t)m_indirectionMap[parentID];
+        }
+    }
+
+    void JETransformStore::PropagateLevelRange(uint32_t begin, uint32_t end) {
+        // Only entries at the same depth are processed together, so parents are final and no two entries write the same element
+        for (uint32_t k = begin; k < end; ++k) {
+            const uint32_t i = m_levelOrder[k];
+            const uint32_t p = m_levelParents[k];
+            if (m_dirtyFlags[i] != JE_TRANSFORM_CLEAN || m_dirtyFlags[p] != JE_TRANSFORM_CLEAN) {
+                m_worldMatrices[i] = m_worldMatrices[p] * m_localMatrices[i];
+                m_dirtyFlags[i] = JE_TRANSFORM_CHANGED;
+            }
+        }
+    }
+
+    void JETransformStore::ComposeDirtyWorldMatrices() {
+        m_changedIndices.clear();
+
+        if (m_hierarchyChanged) {
+            RebuildHierarchyOrder();
+            m_hierarchyChanged = false;
+        }
+
+        const uint32_t size = Size();
+        constexpr uint64_t allNeedCompose = 0x0101010101010101ull;
+
+        // Recompose dirty local matrices. Scan the dirty flags 8 at a time so clean (static) regions are skipped quickly
+        // and fully dirty runs go through the batch kernel. Roots take their local matrix as their world matrix right away.
+        bool anyDirty = false;
+        uint32_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t flags;
+            std::memcpy(&flags, &m_dirtyFlags[i], sizeof(uint64_t));
+            if (flags == 0) {
+                continue;
+            }
+            anyDirty = true;
+
+            if (flags == allNeedCompose) {
+                ComposeBlock8(i);
+            }
+            for (uint32_t j = i; j < i + 8; ++j) {
+                if (m_dirtyFlags[j] == JE_TRANSFORM_CLEAN) {
+                    continue;
+                }
+                if (flags != allNeedCompose && m_dirtyFlags[j] == JE_TRANSFORM_NEEDS_COMPOSE) {
+                    ComposeAt(j);
+                }
+                if (m_parentIds[j] == JE_TRANSFORM_NO_PARENT) {
+                    m_worldMatrices[j] = m_localMatrices[j];
+                }
+            }
+        }
+
+        for (; i < size; ++i) {
+            if (m_dirtyFlags[i] == JE_TRANSFORM_CLEAN) {
+                continue;
+            }
+            anyDirty = true;
+
+            if (m_dirtyFlags[i] == JE_TRANSFORM_NEEDS_COMPOSE) {
+                ComposeAt(i);
+            }
+            if (m_parentIds[i] == JE_TRANSFORM_NO_PARENT) {
+                m_worldMatrices[i] = m_localMatrices[i];
+            }
+        }
+
+        if (anyDirty) {
+            // Propagate down the hierarchy one level at a time. Each level only reads the level above it.
+            const uint32_t numLevels = (uint32_t)m_levelOffsets.size() - 1;
+            for (uint32_t l = 1; l < numLevels; ++l) {
+                ParallelUtils::ParallelFor(m_levelOffsets[l], m_levelOffsets[l + 1], 0, [this](uint32_t startIdx, uint32_t endIdx) {
+                    PropagateLevelRange(startIdx, endIdx);
+                });
+            }
+
+            // Gather the changed indices and clear the flags
+            i = 0;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t flags;
+                std::memcpy(&flags, &m_dirtyFlags[i], sizeof(uint64_t));
+                if (flags == 0) {
+                    continue;
+                }
+
+                for (uint32_t j = i; j < i + 8; ++j) {
+                    if (m_dirtyFlags[j] != JE_TRANSFORM_CLEAN) {
+                        m_changedIndices.push_back(j);
+                    }
+                }
+                std::memset(&m_dirtyFlags[i], JE_TRANSFORM_CLEAN, 8);
+            }
+
+            for (; i < size; ++i) {
+                if (m_dirtyFlags[i] != JE_TRANSFORM_CLEAN) {
+                    m_changedIndices.push_back(i);
+                    m_dirtyFlags[i] = JE_TRANSFORM_CLEAN;
+                }
+            }
+        }
+
+        if (m_structureChanged || !m_changedIndices.empty()) {
+            ++m_version;
+        }
+        m_structureChanged = false;
+    }
+}
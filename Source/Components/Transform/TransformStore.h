@@ -0,0 +1,350 @@
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+
+#include "glm/glm.hpp"
+#include "glm/gtx/quaternion.hpp"
+
+namespace JoeEngine {
+    //! The Transform Store class
+    /*!
+      Structure-of-arrays storage for every entity's transform. Translation, rotation and scale are each split into one
+      float stream per component so that batches of 8 entities can be loaded straight into AVX registers, and the composed
+      world matrices live in their own densely packed stream for the culling, sorting and GPU upload passes.
+      Entity IDs map to dense indices the same way as PackedArray: elements are appended on add and the last element is
+      swapped into the hole on removal, so the dense order matches any PackedArray that is added to/removed from in lockstep.
+      Setters only mark an element as dirty; ComposeDirtyWorldMatrices() rebuilds the dirty world matrices once per frame and
+      records which dense indices changed so that downstream consumers can skip unchanged data.
+      Elements may be parented to other elements. Translation, rotation and scale are then relative to the parent, and world
+      matrices are propagated down the hierarchy one depth level at a time (breadth-first), with large levels split across the
+      thread pool. Only subtrees below a dirty element are recomputed.
+      \sa TransformComponent, JETransformComponentManager, PackedArray
+    */
+    class JETransformStore {
+    private:
+        //! Translation streams.
+        std::vector<float> m_translationX;
+        std::vector<float> m_translationY;
+        std::vector<float> m_translationZ;
+
+        //! Rotation (quaternion) streams.
+        std::vector<float> m_rotationX;
+        std::vector<float> m_rotationY;
+        std::vector<float> m_rotationZ;
+        std::vector<float> m_rotationW;
+
+        //! Scale streams.
+        std::vector<float> m_scaleX;
+        std::vector<float> m_scaleY;
+        std::vector<float> m_scaleZ;
+
+        //! Local matrix stream.
+        /*! The composed translate * rotate * scale of each element, relative to its parent (if any). */
+        std::vector<glm::mat4> m_localMatrices;
+
+        //! World matrix stream.
+        /*! The world transform of each element (parent world matrix * local matrix), in the same dense order as the other streams. */
+        std::vector<glm::mat4> m_worldMatrices;
+
+        //! Parent stream.
+        /*! The entity ID of each element's parent, or JE_TRANSFORM_NO_PARENT. Entity IDs are stable across swap-removals. */
+        std::vector<uint32_t> m_parentIds;
+
+        //! Child count stream.
+        /*! The number of elements parented to each element. Lets removal skip the orphaning scan for leaf elements. */
+        std::vector<uint32_t> m_childCounts;
+
+        //! Hierarchy level order.
+        /*! Dense indices sorted by depth in the hierarchy (roots first), and by dense index within each level. */
+        std::vector<uint32_t> m_levelOrder;
+
+        //! Hierarchy level parents.
+        /*! Parallel to the level order. The dense index of each entry's parent, or JE_TRANSFORM_NO_PARENT for roots. */
+        std::vector<uint32_t> m_levelParents;
+
+        //! Hierarchy level offsets.
+        /*! The start of each depth level in the level order, followed by one past the end of the last level. */
+        std::vector<uint32_t> m_levelOffsets;
+
+        //! Dirty flags.
+        /*!
+          Parallel to the dense streams, one byte per element (so that different entities can be flagged from different threads).
+          See JE_TRANSFORM_CLEAN, JE_TRANSFORM_NEEDS_COMPOSE and JE_TRANSFORM_CHANGED.
+        */
+        std::vector<uint8_t> m_dirtyFlags;
+
+        //! Dense indices whose world matrix changed during the last call to ComposeDirtyWorldMatrices().
+        std::vector<uint32_t> m_changedIndices;
+
+        //! Version number. Incremented whenever any world matrix changes or elements are added/removed.
+        uint64_t m_version;
+
+        //! Whether elements were added, removed or reset since the last call to ComposeDirtyWorldMatrices().
+        bool m_structureChanged;
+
+        //! Whether parenting changed or elements were added/removed since the level order was last built.
+        bool m_hierarchyChanged;
+
+        //! Indirection map.
+        /*! Maps entity IDs to dense indices. -1 is invalid. */
+        std::vector<int> m_indirectionMap;
+
+        //! Data-to-indirection indices list.
+        /*! Parallel to the dense streams. Stores the entity ID that owns each dense element. */
+        std::vector<uint32_t> m_dataIndices;
+
+        //! Write the default transform into the specified dense index and flag it as changed.
+        void ResetAt(uint32_t dataIdx);
+
+        //! Detach the element at the specified dense index from its parent, and turn its children into roots.
+        void DetachAt(uint32_t dataIdx);
+
+        //! Flag the element at the specified dense index so that its world matrix is recomputed, if not already flagged.
+        void MarkWorldStale(uint32_t dataIdx) {
+            if (m_dirtyFlags[dataIdx] == JE_TRANSFORM_CLEAN) {
+                m_dirtyFlags[dataIdx] = JE_TRANSFORM_CHANGED;
+            }
+        }
+
+        //! Rebuild the breadth-first level order of the hierarchy.
+        void RebuildHierarchyOrder();
+
+        //! Propagate world matrices for the level order entries [begin, end), which must all be at the same depth (> 0).
+        void PropagateLevelRange(uint32_t begin, uint32_t end);
+
+        //! Copy every stream's element from one dense index to another.
+        void MoveElement(uint32_t srcIdx, uint32_t dstIdx);
+
+        //! Compose the local matrix of a single dense element (scalar path).
+        void ComposeAt(uint32_t dataIdx);
+
+        //! Compose the local matrices of the 8 dense elements starting at the specified index (AVX2 path).
+        void ComposeBlock8(uint32_t dataIdx);
+
+    public:
+        //! Dirty flag - world matrix is up to date and unchanged this frame.
+        static constexpr uint8_t JE_TRANSFORM_CLEAN = 0;
+
+        //! Dirty flag - translation, rotation or scale changed and the world matrix must be recomposed.
+        static constexpr uint8_t JE_TRANSFORM_NEEDS_COMPOSE = 1;
+
+        //! Dirty flag - local matrix is up to date (e.g. written directly) but the world matrix must be recomputed and reported.
+        static constexpr uint8_t JE_TRANSFORM_CHANGED = 2;
+
+        //! Parent ID of elements that are not parented to anything.
+        static constexpr uint32_t JE_TRANSFORM_NO_PARENT = 0xFFFFFFFF;
+
+        //! Default constructor.
+        /*! No specific behavior. */
+        JETransformStore() : m_version(0), m_structureChanged(false), m_hierarchyChanged(false) {}
+
+        //! Destructor (default).
+        ~JETransformStore() = default;
+
+        //! Get size.
+        /*! \return the number of elements currently stored. */
+        uint32_t Size() const {
+            return (uint32_t)m_dataIndices.size();
+        }
+
+        //! Check whether an entity has a transform in this store.
+        /*!
+          \param entityID the entity ID to check.
+          \return true if the entity has a transform stored, false otherwise.
+        */
+        bool Contains(uint32_t entityID) const {
+            return entityID < m_indirectionMap.size() && m_indirectionMap[entityID] != -1;
+        }
+
+        //! Get the dense index of an entity's transform.
+        /*!
+          Throws an error if the entity has no transform in this store.
+          \param entityID the entity ID to look up.
+          \return the dense index of the entity's transform.
+        */
+        uint32_t GetDataIndex(uint32_t entityID) const {
+            if (!Contains(entityID)) {
+                throw std::runtime_error("Index out of bounds");
+            }
+            return (uint32_t)m_indirectionMap[entityID];
+        }
+
+        //! Add a default transform (identity) for the specified entity.
+        //! \param entityID the entity to add a transform for.
+        void AddElement(uint32_t entityID);
+
+        //! Reserve room for the specified total number of elements, and an indirection map covering the specified number of entity IDs.
+        //! \param numElements the total number of elements to reserve room for.
+        //! \param numIndices the number of entity IDs (highest entity ID + 1) the indirection map should cover.
+        void Reserve(uint32_t numElements, uint32_t numIndices);
+
+        //! Remove the specified entity's transform. The last element is swapped into its place.
+        //! Children of the removed transform become roots and keep their local transform.
+        //! \param entityID the entity whose transform to remove.
+        void RemoveElement(uint32_t entityID);
+
+        //! Reset the specified entity's transform to the default (identity) transform, detached from any parent or children.
+        //! \param entityID the entity whose transform to reset.
+        void ResetElement(uint32_t entityID);
+
+        //! Reset the transforms of a batch of entities, as if calling ResetElement() for each of them.
+        //! Children of the reset transforms are orphaned with a single scan over the store rather than one scan per parent.
+        //! \param entityIDs the entities whose transforms to reset.
+        void ResetElements(const std::vector<uint32_t>& entityIDs);
+
+        //! Get translation.
+        //! \param entityID the entity ID.
+        glm::vec3 GetTranslation(uint32_t entityID) const {
+            const uint32_t i = GetDataIndex(entityID);
+            return glm::vec3(m_translationX[i], m_translationY[i], m_translationZ[i]);
+        }
+
+        //! Get rotation.
+        //! \param entityID the entity ID.
+        glm::quat GetRotation(uint32_t entityID) const {
+            const uint32_t i = GetDataIndex(entityID);
+            return glm::quat(m_rotationW[i], m_rotationX[i], m_rotationY[i], m_rotationZ[i]);
+        }
+
+        //! Get scale.
+        //! \param entityID the entity ID.
+        glm::vec3 GetScale(uint32_t entityID) const {
+            const uint32_t i = GetDataIndex(entityID);
+            return glm::vec3(m_scaleX[i], m_scaleY[i], m_scaleZ[i]);
+        }
+
+        //! Get world matrix.
+        //! \param entityID the entity ID.
+        const glm::mat4& GetWorldMatrix(uint32_t entityID) const {
+            return m_worldMatrices[GetDataIndex(entityID)];
+        }
+
+        //! Get local matrix.
+        //! \param entityID the entity ID.
+        const glm::mat4& GetLocalMatrix(uint32_t entityID) const {
+            return m_localMatrices[GetDataIndex(entityID)];
+        }
+
+        //! Get parent.
+        /*!
+          \param entityID the entity ID.
+          \return the entity ID of the parent, or JE_TRANSFORM_NO_PARENT.
+        */
+        uint32_t GetParent(uint32_t entityID) const {
+            return m_parentIds[GetDataIndex(entityID)];
+        }
+
+        //! Set parent.
+        /*!
+          Parents the specified entity's transform to another entity's transform. Its translation, rotation and scale become
+          relative to the parent. Throws an error if either entity has no transform or if the parenting would create a cycle.
+          \param entityID the entity ID.
+          \param parentID the entity ID of the new parent.
+        */
+        void SetParent(uint32_t entityID, uint32_t parentID);
+
+        //! Clear parent.
+        /*!
+          Detaches the specified entity's transform from its parent, if any. Its local transform becomes its world transform.
+          \param entityID the entity ID.
+        */
+        void ClearParent(uint32_t entityID);
+
+        //! Set translation.
+        //! \param entityID the entity ID.
+        //! \param translation the new translation.
+        void SetTranslation(uint32_t entityID, const glm::vec3& translation) {
+            const uint32_t i = GetDataIndex(entityID);
+            m_translationX[i] = translation.x;
+            m_translationY[i] = translation.y;
+            m_translationZ[i] = translation.z;
+            m_dirtyFlags[i] = JE_TRANSFORM_NEEDS_COMPOSE;
+        }
+
+        //! Set rotation.
+        //! \param entityID the entity ID.
+        //! \param rotation the new rotation.
+        void SetRotation(uint32_t entityID, const glm::quat& rotation) {
+            const uint32_t i = GetDataIndex(entityID);
+            m_rotationX[i] = rotation.x;
+            m_rotationY[i] = rotation.y;
+            m_rotationZ[i] = rotation.z;
+            m_rotationW[i] = rotation.w;
+            m_dirtyFlags[i] = JE_TRANSFORM_NEEDS_COMPOSE;
+        }
+
+        //! Set scale.
+        //! \param entityID the entity ID.
+        //! \param scale the new scale.
+        void SetScale(uint32_t entityID, const glm::vec3& scale) {
+            const uint32_t i = GetDataIndex(entityID);
+            m_scaleX[i] = scale.x;
+            m_scaleY[i] = scale.y;
+            m_scaleZ[i] = scale.z;
+            m_dirtyFlags[i] = JE_TRANSFORM_NEEDS_COMPOSE;
+        }
+
+        //! Set local matrix directly.
+        /*!
+          The matrix sticks until the translation, rotation or scale of this element is changed again.
+          For elements without a parent this is also the world matrix.
+          \param entityID the entity ID.
+          \param localMatrix the new local matrix.
+        */
+        void SetLocalMatrix(uint32_t entityID, const glm::mat4& localMatrix) {
+            const uint32_t i = GetDataIndex(entityID);
+            m_localMatrices[i] = localMatrix;
+            m_dirtyFlags[i] = JE_TRANSFORM_CHANGED;
+        }
+
+        //! Get the densely packed world matrix stream.
+        /*! \return the list of world matrices, one per element, in dense order. */
+        const std::vector<glm::mat4>& GetWorldMatrices() const {
+            return m_worldMatrices;
+        }
+
+        //! Get the entity ID stored at a dense index.
+        //! \param dataIdx the dense index.
+        uint32_t GetEntityAt(uint32_t dataIdx) const {
+            return m_dataIndices[dataIdx];
+        }
+
+        //! Get the dense indices whose world matrix changed during the last call to ComposeDirtyWorldMatrices().
+        /*! \return the list of changed dense indices, in ascending order. */
+        const std::vector<uint32_t>& GetChangedIndices() const {
+            return m_changedIndices;
+        }
+
+        //! Get the version number.
+        /*!
+          Incremented whenever a world matrix changes or elements are added/removed, so consumers can cheaply tell whether
+          anything they derived from the world matrix stream is stale.
+          \return the current version number.
+        */
+        uint64_t GetVersion() const {
+            return m_version;
+        }
+
+        //! Compose world matrices.
+        /*!
+          Batch kernel. Rebuilds the local matrix (translate * rotate * scale) of every element in the dense range [begin, end),
+          then its world matrix against the parent's current world matrix.
+          Uses AVX2 to compose 8 elements at a time when available, falling back to scalar code for the remainder.
+          The composed elements (and their children) are updated and reported as changed by the next call to
+          ComposeDirtyWorldMatrices().
+          \param begin the first dense index to compose.
+          \param end one past the last dense index to compose.
+        */
+        void ComposeWorldMatrices(uint32_t begin, uint32_t end);
+
+        //! Compose dirty world matrices.
+        /*!
+          Rebuilds only the local matrices whose translation, rotation or scale changed since the last call, then propagates
+          world matrices level by level down the hierarchy below the changed elements. Clears all dirty flags and records the
+          dense indices whose world matrix changed. Runs of 8 consecutive dirty elements use the AVX2 kernel, and each level is
+          propagated with ParallelUtils::ParallelFor(), in parallel if it is large enough.
+        */
+        void ComposeDirtyWorldMatrices();
+    };
+}
@@ -0,0 +1,166 @@
+#include <cstring>
+
+#include "ArchetypeStorage.h"
+#include "../Utils/MemAllocUtils.h"
+
+namespace JoeEngine {
+    JEArchetypeStorage::~JEArchetypeStorage() {
+        for (JEArchetype& archetype : m_archetypes) {
+            for (JEArchetypeChunk& chunk : archetype.chunks) {
+                MemAllocUtils::alignedFree(chunk.data);
+            }
+        }
+    }
+
+    uint32_t JEArchetypeStorage::GetOrCreateArchetype(uint64_t signature) {
+        auto it = m_archetypeLookup.find(signature);
+        if (it != m_archetypeLookup.end()) {
+            return it->second;
+        }
+
+        JEArchetype archetype;
+        archetype.signature = signature;
+        archetype.columnOfType.fill(-1);
+
+        uint32_t rowSize = sizeof(uint32_t); // entity ID
+        for (uint32_t typeId = 0; typeId < JE_ARCHETYPE_MAX_COMPONENT_TYPES; ++typeId) {
+            if (signature & (1ull << typeId)) {
+                archetype.columnOfType[typeId] = (int8_t)archetype.typeIds.size();
+                archetype.typeIds.push_back(typeId);
+                archetype.columnSizes.push_back(m_typeSizes[typeId]);
+                rowSize += m_typeSizes[typeId];
+            }
+        }
+
+        // Leave enough room to align the start of every column
+        const uint32_t padding = JE_ARCHETYPE_COLUMN_ALIGNMENT * (uint32_t)archetype.typeIds.size();
+        archetype.chunkCapacity = (JE_ARCHETYPE_CHUNK_SIZE - padding) / rowSize;
+        if (archetype.chunkCapacity == 0) {
+            throw std::runtime_error("Archetype row does not fit in a chunk");
+        }
+
+        uint32_t offset = archetype.chunkCapacity * sizeof(uint32_t);
+        for (uint32_t c = 0; c < archetype.typeIds.size(); ++c) {
+            offset = (offset + JE_ARCHETYPE_COLUMN_ALIGNMENT - 1) & ~(JE_ARCHETYPE_COLUMN_ALIGNMENT - 1);
+            archetype.columnOffsets.push_back(offset);
+            offset += archetype.chunkCapacity * archetype.columnSizes[c];
+        }
+
+        const uint32_t archetypeIdx = (uint32_t)m_archetypes.size();
+        m_archetypes.emplace_back(std::move(archetype));
+        m_archetypeLookup[signature] = archetypeIdx;
+        return archetypeIdx;
+    }
+
+    void JEArchetypeStorage::AllocateRow(uint32_t archetypeIdx, uint32_t entityID) {
+        JEArchetype& archetype = m_archetypes[archetypeIdx];
+        if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.chunkCapacity) {
+            JEArchetypeChunk chunk;
+            chunk.data = static_cast<uint8_t*>(MemAllocUtils::alignedAlloc(64, JE_ARCHETYPE_CHUNK_SIZE));
+            if (chunk.data == nullptr) {
+                throw std::runtime_error("Failed to allocate archetype chunk");
+            }
+            chunk.count = 0;
+            archetype.chunks.push_back(chunk);
+        }
+
+        JEArchetypeChunk& chunk = archetype.chunks.back();
+        const uint32_t row = chunk.count++;
+        reinterpret_cast<uint32_t*>(chunk.data)[row] = entityID;
+
+        if (entityID + 1 > m_locations.size()) {
+            m_locations.resize(entityID + 1, { -1, 0, 0 });
+        }
+        m_locations[entityID] = { (int)archetypeIdx, (uint32_t)archetype.chunks.size() - 1, row };
+    }
+
+    void JEArchetypeStorage::FreeRow(uint32_t entityID) {
+        const JEArchetypeLocation location = m_locations[entityID];
+        JEArchetype& archetype = m_archetypes[location.archetype];
+        JEArchetypeChunk& lastChunk = archetype.chunks.back();
+        const uint32_t lastChunkIdx = (uint32_t)archetype.chunks.size() - 1;
+        const uint32_t lastRow = lastChunk.count - 1;
+
+        // Keep chunks densely packed by moving the archetype's last row into the hole
+        if (location.chunk != lastChunkIdx || location.row != lastRow) {
+            JEArchetypeChunk& chunk = archetype.chunks[location.chunk];
+            const uint32_t movedEntityID = reinterpret_cast<uint32_t*>(lastChunk.data)[lastRow];
+            reinterpret_cast<uint32_t*>(chunk.data)[location.row] = movedEntityID;
+            for (uint32_t c = 0; c < archetype.typeIds.size(); ++c) {
+                const uint32_t size = archetype.columnSizes[c];
+                std::memcpy(chunk.data + archetype.columnOffsets[c] + location.row * size,
+                            lastChunk.data + archetype.columnOffsets[c] + lastRow * size, size);
+            }
+            m_locations[movedEntityID] = location;
+        }
+
+        if (--lastChunk.count == 0) {
+            MemAllocUtils::alignedFree(lastChunk.data);
+            archetype.chunks.pop_back();
+        }
+        m_locations[entityID].archetype = -1;
+    }
+
+    void JEArchetypeStorage::MoveEntity(uint32_t entityID, uint64_t newSignature) {
+        const uint64_t oldSignature = GetSignature(entityID);
+        if (newSignature == 0) {
+            if (oldSignature != 0) {
+                FreeRow(entityID);
+            }
+            return;
+        }
+
+        // Note: may add to the archetype list, so take references only after this
+        const uint32_t newArchetypeIdx = GetOrCreateArchetype(newSignature);
+        if (oldSignature == 0) {
+            AllocateRow(newArchetypeIdx, entityID);
+            return;
+        }
+
+        const JEArchetypeLocation oldLocation = m_locations[entityID];
+        AllocateRow(newArchetypeIdx, entityID);
+        const JEArchetypeLocation newLocation = m_locations[entityID];
+
+        // Carry over the components both archetypes share
+        const JEArchetype& oldArchetype = m_archetypes[oldLocation.archetype];
+        const JEArchetype& newArchetype = m_archetypes[newArchetypeIdx];
+        const uint8_t* oldData = oldArchetype.chunks[oldLocation.chunk].data;
+        uint8_t* newData = newArchetype.chunks[newLocation.chunk].data;
+        for (uint32_t c = 0; c < newArchetype.typeIds.size(); ++c) {
+            const int oldColumn = oldArchetype.columnOfType[newArchetype.typeIds[c]];
+            if (oldColumn != -1) {
+                const uint32_t size = newArchetype.columnSizes[c];
+                std::memcpy(newData + newArchetype.columnOffsets[c] + newLocation.row * size,
+                            oldData + oldArchetype.columnOffsets[oldColumn] + oldLocation.row * size, size);
+            }
+        }
+
+        m_locations[entityID] = oldLocation;
+        FreeRow(entityID);
+        m_locations[entityID] = newLocation;
+    }
+
+    void* JEArchetypeStorage::GetComponentData(uint32_t entityID, uint32_t typeId) const {
+        if (typeId >= JE_ARCHETYPE_MAX_COMPONENT_TYPES || entityID >= m_locations.size()) {
+            return nullptr;
+        }
+
+        const JEArchetypeLocation& location = m_locations[entityID];
+        if (location.archetype == -1) {
+            return nullptr;
+        }
+
+        const JEArchetype& archetype = m_archetypes[location.archetype];
+        const int column = archetype.columnOfType[typeId];
+        if (column == -1) {
+            return nullptr;
+        }
+        return archetype.chunks[location.chunk].data + archetype.columnOffsets[column] + location.row * archetype.columnSizes[column];
+    }
+
+    void JEArchetypeStorage::RemoveEntity(uint32_t entityID) {
+        if (GetSignature(entityID) != 0) {
+            FreeRow(entityID);
+        }
+    }
+}
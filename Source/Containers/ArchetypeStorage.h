@@ -0,0 +1,243 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../Components/ComponentTypeId.h"
+
+namespace JoeEngine {
+    //! Size of each archetype chunk in bytes.
+    constexpr uint32_t JE_ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+    //! Alignment of each column within an archetype chunk, in bytes.
+    constexpr uint32_t JE_ARCHETYPE_COLUMN_ALIGNMENT = 16;
+
+    //! Maximum component type ID that can be stored in archetypes (each type is one bit of an archetype's signature).
+    constexpr uint32_t JE_ARCHETYPE_MAX_COMPONENT_TYPES = 64;
+
+    //! The Archetype Storage class.
+    /*!
+      Optional component storage backend. Entities with exactly the same set of components (an archetype) are stored together in
+      fixed-size chunks of JE_ARCHETYPE_CHUNK_SIZE bytes, with one densely packed column per component type plus a column of entity
+      IDs. Iterating several components at once then streams through contiguous memory, chunk by chunk, instead of hopping through
+      one indirection map per component type the way PackedArray-backed component managers do.
+      Adding or removing a component moves the entity to a different archetype, and removing an entity swaps the last row of its
+      archetype into the hole, so pointers to components are only valid until the next structural change.
+      Component types must be trivially copyable, as rows are moved between chunks with memcpy.
+      \sa JEArchetypeComponentManager, PackedArray, JEComponentTypeId
+    */
+    class JEArchetypeStorage {
+    private:
+        //! Archetype chunk.
+        typedef struct je_archetype_chunk_t {
+            //! JE_ARCHETYPE_CHUNK_SIZE bytes, starting with the entity ID column followed by each component column.
+            uint8_t* data;
+
+            //! Number of rows in use.
+            uint32_t count;
+        } JEArchetypeChunk;
+
+        //! Archetype.
+        typedef struct je_archetype_t {
+            //! Bitmask of the component type IDs stored in this archetype.
+            uint64_t signature;
+
+            //! Component type IDs stored in this archetype, in ascending order.
+            std::vector<uint32_t> typeIds;
+
+            //! Byte offset of each component column within a chunk, parallel to 'typeIds'.
+            std::vector<uint32_t> columnOffsets;
+
+            //! Size of one element of each component column, parallel to 'typeIds'.
+            std::vector<uint32_t> columnSizes;
+
+            //! Maps a component type ID to its column in this archetype, or -1.
+            std::array<int8_t, JE_ARCHETYPE_MAX_COMPONENT_TYPES> columnOfType;
+
+            //! Number of rows that fit in a chunk.
+            uint32_t chunkCapacity;
+
+            //! List of chunks. Every chunk but the last one is full.
+            std::vector<JEArchetypeChunk> chunks;
+        } JEArchetype;
+
+        //! Location of an entity's row.
+        typedef struct je_archetype_location_t {
+            //! Index into the archetype list, -1 if the entity has no components in this storage.
+            int archetype;
+
+            //! Chunk index within the archetype.
+            uint32_t chunk;
+
+            //! Row within the chunk.
+            uint32_t row;
+        } JEArchetypeLocation;
+
+        //! Size of each component type, indexed by component type ID (0 if never stored).
+        std::array<uint32_t, JE_ARCHETYPE_MAX_COMPONENT_TYPES> m_typeSizes;
+
+        //! List of archetypes. Archetypes are never destroyed, so indices into this list are stable.
+        std::vector<JEArchetype> m_archetypes;
+
+        //! Maps an archetype signature to its index in the archetype list. Only used on structural changes.
+        std::unordered_map<uint64_t, uint32_t> m_archetypeLookup;
+
+        //! Row location of each entity, indexed by entity ID.
+        std::vector<JEArchetypeLocation> m_locations;
+
+        //! Get the signature bit of a component type, throwing an error if its type ID is too large.
+        static uint64_t GetTypeBit(uint32_t typeId) {
+            if (typeId >= JE_ARCHETYPE_MAX_COMPONENT_TYPES) {
+                throw std::runtime_error("Too many component types for archetype storage");
+            }
+            return 1ull << typeId;
+        }
+
+        //! Get the archetype with the specified signature, creating it if it does not exist yet.
+        uint32_t GetOrCreateArchetype(uint64_t signature);
+
+        //! Append a row for the entity to the archetype and record its location. The component columns are left uninitialized.
+        void AllocateRow(uint32_t archetypeIdx, uint32_t entityID);
+
+        //! Remove the entity's row from its archetype, moving the archetype's last row into the hole.
+        void FreeRow(uint32_t entityID);
+
+        //! Move the entity to the archetype with the specified signature, carrying over the components both archetypes share.
+        void MoveEntity(uint32_t entityID, uint64_t newSignature);
+
+        //! Get a pointer to the entity's component of the specified type, or nullptr if it has none.
+        void* GetComponentData(uint32_t entityID, uint32_t typeId) const;
+
+        //! Get the entity's current signature (0 if it has no components in this storage).
+        uint64_t GetSignature(uint32_t entityID) const {
+            if (entityID >= m_locations.size() || m_locations[entityID].archetype == -1) {
+                return 0;
+            }
+            return m_archetypes[m_locations[entityID].archetype].signature;
+        }
+
+    public:
+        //! Default constructor.
+        /*! No specific behavior. */
+        JEArchetypeStorage() {
+            m_typeSizes.fill(0);
+        }
+
+        //! Destructor.
+        /*! Frees all chunks. */
+        ~JEArchetypeStorage();
+
+        JEArchetypeStorage(const JEArchetypeStorage& storage) = delete;
+        JEArchetypeStorage& operator=(const JEArchetypeStorage& storage) = delete;
+
+        //! Add a component to an entity.
+        /*!
+          Moves the entity to the archetype that includes this component type. If the entity already has a component of this type,
+          it is overwritten in place instead.
+          \param entityID the entity to add the component to.
+          \param component the component data.
+        */
+        template <typename T>
+        void AddComponent(uint32_t entityID, const T& component) {
+            static_assert(std::is_trivially_copyable<T>::value, "Archetype components must be trivially copyable");
+            static_assert(alignof(T) <= JE_ARCHETYPE_COLUMN_ALIGNMENT, "Archetype components must not be over-aligned");
+
+            const uint32_t typeId = JEComponentTypeId::Get<T>();
+            const uint64_t typeBit = GetTypeBit(typeId);
+            m_typeSizes[typeId] = sizeof(T);
+
+            const uint64_t signature = GetSignature(entityID);
+            if (!(signature & typeBit)) {
+                MoveEntity(entityID, signature | typeBit);
+            }
+            *static_cast<T*>(GetComponentData(entityID, typeId)) = component;
+        }
+
+        //! Remove a component from an entity.
+        /*!
+          Moves the entity to the archetype without this component type. Does nothing if the entity does not have the component.
+          \param entityID the entity to remove the component from.
+        */
+        template <typename T>
+        void RemoveComponent(uint32_t entityID) {
+            const uint64_t typeBit = GetTypeBit(JEComponentTypeId::Get<T>());
+            const uint64_t signature = GetSignature(entityID);
+            if (signature & typeBit) {
+                MoveEntity(entityID, signature & ~typeBit);
+            }
+        }
+
+        //! Check whether an entity has a component.
+        /*!
+          \param entityID the entity to check.
+          \return true if the entity has a component of type T in this storage, false otherwise.
+        */
+        template <typename T>
+        bool HasComponent(uint32_t entityID) const {
+            return (GetSignature(entityID) & GetTypeBit(JEComponentTypeId::Get<T>())) != 0;
+        }
+
+        //! Get an entity's component.
+        /*!
+          Throws an error if the entity does not have the component. The pointer is only valid until the next structural change.
+          \param entityID the entity whose component to get.
+          \return pointer to the component.
+        */
+        template <typename T>
+        T* GetComponent(uint32_t entityID) const {
+            T* component = static_cast<T*>(GetComponentData(entityID, JEComponentTypeId::Get<T>()));
+            if (component == nullptr) {
+                throw std::runtime_error("Entity does not have this component");
+            }
+            return component;
+        }
+
+        //! Remove an entity and all of its components from this storage.
+        //! \param entityID the entity to remove.
+        void RemoveEntity(uint32_t entityID);
+
+        //! Get the number of archetypes.
+        uint32_t NumArchetypes() const {
+            return (uint32_t)m_archetypes.size();
+        }
+
+        //! Invoke a function on every chunk that stores all of the specified component types.
+        /*!
+          This is the fastest way to iterate: each call receives one densely packed column per component type, which can be
+          processed with plain (or SIMD) loops. Chunks are independent, so they can also be handed to different threads.
+          Components must not be added or removed while iterating.
+          \param f the function to invoke, with signature void(uint32_t count, const uint32_t* entityIDs, Ts*... columns).
+        */
+        template <typename... Ts, typename F>
+        void ForEachChunk(F&& f) {
+            const uint64_t required = (GetTypeBit(JEComponentTypeId::Get<Ts>()) | ...);
+            for (JEArchetype& archetype : m_archetypes) {
+                if ((archetype.signature & required) != required) {
+                    continue;
+                }
+
+                for (JEArchetypeChunk& chunk : archetype.chunks) {
+                    f(chunk.count, reinterpret_cast<const uint32_t*>(chunk.data),
+                      reinterpret_cast<Ts*>(chunk.data + archetype.columnOffsets[archetype.columnOfType[JEComponentTypeId::Get<Ts>()]])...);
+                }
+            }
+        }
+
+        //! Invoke a function on every entity that has all of the specified component types.
+        /*!
+          Components must not be added or removed while iterating.
+          \param f the function to invoke, with signature void(uint32_t entityID, Ts&... components).
+        */
+        template <typename... Ts, typename F>
+        void ForEach(F&& f) {
+            ForEachChunk<Ts...>([&f](uint32_t count, const uint32_t* entityIDs, Ts*... columns) {
+                for (uint32_t i = 0; i < count; ++i) {
+                    f(entityIDs[i], columns[i]...);
+                }
+            });
+        }
+    };
+}
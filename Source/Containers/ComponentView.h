@@ -0,0 +1,183 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <algorithm>
+
+#include "PackedArray.h"
+
+namespace JoeEngine {
+    //! The Component View class.
+    /*!
+      Typed view over several packed arrays of components, e.g. JEComponentView<MeshComponent, MaterialComponent, TransformComponent>.
+      Iterating the view visits exactly the entities that have an element in every one of the packed arrays.
+      The smallest packed array drives the iteration and the other packed arrays are joined through their indirection maps. If all
+      the packed arrays happen to share the same packing (same entity at every dense position), which is checked once upon
+      construction, the join is skipped and all packed arrays are iterated densely.
+      Iteration can also be split into chunks of the driving packed array, e.g. to spread the work over the thread pool.
+      The view holds pointers to the packed arrays and must not outlive them, nor be used after elements are added or removed.
+      \sa PackedArray, JEEngineInstance
+    */
+    template <typename... Ts>
+    class JEComponentView {
+        static_assert(sizeof...(Ts) > 0, "A component view needs at least one component type");
+
+    private:
+        //! Packed arrays being viewed.
+        std::tuple<const PackedArray<Ts>*...> m_lists;
+
+        //! Data indices list of the smallest packed array, which drives the iteration.
+        const std::vector<int>* m_driverDataIndices;
+
+        //! Number of elements in the smallest packed array.
+        uint32_t m_driverSize;
+
+        //! Whether all packed arrays share the same packing.
+        bool m_aligned;
+
+        //! Invoke the function on every entity in the driving range [begin, end) - dense path.
+        template <typename F, size_t... Is>
+        void ForEachAligned(uint32_t begin, uint32_t end, F& f, std::index_sequence<Is...>) const {
+            for (uint32_t i = begin; i < end; ++i) {
+                f((uint32_t)(*m_driverDataIndices)[i], std::get<Is>(m_lists)->GetData()[i]...);
+            }
+        }
+
+        //! Invoke the function on a single entity if it has an element in every packed array - join path.
+        template <typename F, size_t... Is>
+        bool ForEntityJoined(uint32_t entityID, F& f, std::index_sequence<Is...>) const {
+            int dataIndices[sizeof...(Ts)];
+            bool hasAll = true;
+            ((hasAll = hasAll && (dataIndices[Is] = std::get<Is>(m_lists)->FindDataIndex(entityID)) != -1), ...);
+            if (hasAll) {
+                f(entityID, std::get<Is>(m_lists)->GetData()[dataIndices[Is]]...);
+            }
+            return hasAll;
+        }
+
+        //! Invoke the function on a single entity if it has an element in every packed array - dense path, one lookup.
+        template <typename F, size_t... Is>
+        bool ForEntityAligned(uint32_t entityID, F& f, std::index_sequence<Is...>) const {
+            const int dataIdx = std::get<0>(m_lists)->FindDataIndex(entityID);
+            if (dataIdx == -1) {
+                return false;
+            }
+            f(entityID, std::get<Is>(m_lists)->GetData()[dataIdx]...);
+            return true;
+        }
+
+        //! Invoke the function on every entity in the driving range [begin, end) - join path.
+        template <typename F, size_t... Is>
+        void ForEachJoined(uint32_t begin, uint32_t end, F& f, std::index_sequence<Is...> indices) const {
+            for (uint32_t i = begin; i < end; ++i) {
+                ForEntityJoined((uint32_t)(*m_driverDataIndices)[i], f, indices);
+            }
+        }
+
+    public:
+        //! Constructor.
+        /*!
+          Picks the smallest packed array to drive iteration and checks whether all packed arrays share the same packing.
+          \param lists the packed arrays to view, one per component type.
+        */
+        JEComponentView(const PackedArray<Ts>&... lists) : m_lists(&lists...), m_driverDataIndices(nullptr), m_driverSize(0),
+                                                            m_aligned(true) {
+            const uint32_t sizes[] = { lists.Size()... };
+            const std::vector<int>* dataIndices[] = { &lists.GetDataIndices()... };
+
+            uint32_t driver = 0;
+            for (uint32_t i = 1; i < sizeof...(Ts); ++i) {
+                if (sizes[i] < sizes[driver]) {
+                    driver = i;
+                }
+            }
+            m_driverDataIndices = dataIndices[driver];
+            m_driverSize = sizes[driver];
+
+            for (uint32_t i = 0; i < sizeof...(Ts) && m_aligned; ++i) {
+                m_aligned = sizes[i] == m_driverSize &&
+                            std::equal(dataIndices[i]->begin(), dataIndices[i]->begin() + m_driverSize, m_driverDataIndices->begin());
+            }
+        }
+
+        //! Destructor (default).
+        ~JEComponentView() = default;
+
+        //! Get size.
+        /*!
+          Returns the number of elements in the driving (smallest) packed array, i.e. an upper bound on the number of entities
+          visited. This is the range that ForEachInRange() and the chunk functions operate on.
+          \return the size of the driving range.
+        */
+        uint32_t Size() const {
+            return m_driverSize;
+        }
+
+        //! Check whether all packed arrays share the same packing.
+        /*! \return true if iteration is dense, false if other packed arrays are joined through their indirection maps. */
+        bool IsAligned() const {
+            return m_aligned;
+        }
+
+        //! Invoke a function on every entity in the view.
+        /*!
+          \param f the function to invoke, with signature void(uint32_t entityID, const Ts&... components).
+        */
+        template <typename F>
+        void ForEach(F&& f) const {
+            ForEachInRange(0, m_driverSize, f);
+        }
+
+        //! Invoke a function on every entity in a range of the view.
+        /*!
+          \param begin the first position in the driving range.
+          \param end one past the last position in the driving range.
+          \param f the function to invoke, with signature void(uint32_t entityID, const Ts&... components).
+        */
+        template <typename F>
+        void ForEachInRange(uint32_t begin, uint32_t end, F&& f) const {
+            end = std::min(end, m_driverSize);
+            if (m_aligned) {
+                ForEachAligned(begin, end, f, std::index_sequence_for<Ts...>());
+            } else {
+                ForEachJoined(begin, end, f, std::index_sequence_for<Ts...>());
+            }
+        }
+
+        //! Invoke a function on a single entity, if it is in the view.
+        /*!
+          Looks the entity up through the indirection maps instead of iterating, e.g. for the entities returned by a spatial query.
+          \param entityID the entity to look up.
+          \param f the function to invoke, with signature void(uint32_t entityID, const Ts&... components).
+          \return true if the entity has an element in every packed array, i.e. if the function was invoked.
+        */
+        template <typename F>
+        bool ForEntity(uint32_t entityID, F&& f) const {
+            if (m_aligned) {
+                return ForEntityAligned(entityID, f, std::index_sequence_for<Ts...>());
+            }
+            return ForEntityJoined(entityID, f, std::index_sequence_for<Ts...>());
+        }
+
+        //! Get number of chunks.
+        /*!
+          \param chunkSize the number of positions in the driving range per chunk.
+          \return the number of chunks needed to cover the view.
+        */
+        uint32_t GetNumChunks(uint32_t chunkSize) const {
+            return (m_driverSize + chunkSize - 1) / chunkSize;
+        }
+
+        //! Invoke a function on every entity in a chunk of the view.
+        /*!
+          Different chunks visit disjoint sets of entities, so they can be processed on different threads.
+          \param chunkIndex the chunk to iterate, in [0, GetNumChunks(chunkSize)).
+          \param chunkSize the number of positions in the driving range per chunk.
+          \param f the function to invoke, with signature void(uint32_t entityID, const Ts&... components).
+        */
+        template <typename F>
+        void ForEachInChunk(uint32_t chunkIndex, uint32_t chunkSize, F&& f) const {
+            ForEachInRange(chunkIndex * chunkSize, (chunkIndex + 1) * chunkSize, f);
+        }
+    };
+}
@@ -142,11 +142,52 @@ namespace JoeEngine {
             return m_data;
         }
 
+        //! Get data indices
+        /*!
+          Returns the data-to-indirection indices list, i.e. the index (e.g. entity ID) that owns each element of the data list.
+          Only the first Size() entries are valid.
+          \return const reference to the data indices list
+        */
+        const std::vector<int>& GetDataIndices() const {
+            return m_dataIndices;
+        }
+
+        //! Find data index
+        /*!
+          Looks up the position in the data list of the element at the specified index (e.g. an entity ID). Unlike the []-operator,
+          this does not throw for missing elements.
+          \param index the index to look up
+          \return the position of the element in the data list, or -1 if the index has no element
+        */
+        int FindDataIndex(uint32_t index) const {
+            if (index >= m_indirectionMap.size()) {
+                return -1;
+            }
+            return m_indirectionMap[index].m_index;
+        }
+
+        //! Reserve storage
+        /*!
+          Reserves room for the specified number of elements, and grows the indirection map to cover the specified number of
+          indices, so that a following batch of insertions does not reallocate.
+          \param numElements the total number of elements to reserve room for
+          \param numIndices the number of indices (e.g. highest entity ID + 1) the indirection map should cover
+        */
+        void Reserve(uint32_t numElements, uint32_t numIndices) {
+            m_data.reserve(numElements);
+            m_dataIndices.reserve(numElements);
+            if (numIndices > m_indirectionMap.size()) {
+                m_indirectionMap.resize(numIndices);
+            }
+        }
+
         //! Add index-element pair
         /*!
           Adds the specified data element to the densely-packed data list. Will re-use a previously invalid entry if one is available
           to avoid unnecessary allocations. The indirection map and data indices lists are updated to reflect this addition. Now, using
           the []-operator with the specified index will return the specified element.
+          If the index already has an element (e.g. a recycled entity ID whose component was reset rather than removed), that element
+          is replaced in place so that the dense order is unchanged.
           \param index the index to insert the element at
           \param element the specified data element
         */
@@ -155,6 +196,11 @@ namespace JoeEngine {
                 m_indirectionMap.resize(index + 1);
             }
 
+            if (m_indirectionMap[index].m_index != -1) {
+                m_data[m_indirectionMap[index].m_index] = element;
+                return;
+            }
+
             m_indirectionMap[index] = IDInt(m_numElements);
             if (m_numElements == m_data.size()) {
                 m_data.emplace_back(element);
@@ -1,13 +1,29 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <exception>
+#include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
-//#include <utility>
+#include <utility>
 
 #include "Utils/ScopedTimer.h"
+#include "Utils/RadixSort.h"
 #include "EngineInstance.h"
 
 namespace JoeEngine {
     void JEEngineInstance::Run() {
+        if (m_vulkanRenderer.IsHeadless()) {
+            RunHeadless(JE_DEFAULT_HEADLESS_NUM_FRAMES);
+            return;
+        }
+
+        if (m_vulkanRenderer.IsPipelined()) {
+            RunPipelined();
+            return;
+        }
+
         const JEVulkanWindow& window = m_vulkanRenderer.GetWindow();
 
         while (!window.ShouldClose()) {
@@ -20,235 +36,457 @@ namespace JoeEngine {
                     m_ioHandler.PollInput(); // Receive input, call registered callback functions
                 }
 
-                // Update components
-                for (int i = 0; i < m_componentManagers.size(); ++i) {
-                    {
-                        //ScopedTimer<float> timer("Component Manager " + std::to_string(i));
-                        m_componentManagers[i]->Update(this);
-                    }
-                }
+                UpdateFrame();
+                UpdateParticleMeshes();
 
-                // Destroy any entities marked for deletion
-                DestroyEntities();
+                JEFrameDrawData& drawData = m_frameDrawData[0];
+                PrepareDrawData(drawData);
 
-                // Update particle systems
-                {
-                    //ScopedTimer<float> timer("Update particle systems");
-                    m_physicsManager.UpdateParticleSystems(m_particleSystems);
-                }
+                RenderFrame(drawData);
 
-                {
-                    //ScopedTimer<float> timer("Update particle systems meshes");
-                    for (uint32_t i = 0; i < m_particleSystems.size(); ++i) {
-                        JEParticleSystem& particleSystem = m_particleSystems[i];
-                        m_vulkanRenderer.UpdateMesh(particleSystem.m_meshComponent, particleSystem.GetVertices(), particleSystem.GetIndices());
-                    }
-                }
-                
-                const PackedArray<MeshComponent>&      meshComponents      = GetComponentList<MeshComponent, JEMeshComponentManager>();
-                const PackedArray<MaterialComponent>&  materialComponents  = GetComponentList<MaterialComponent, JEMaterialComponentManager>();
-                const PackedArray<TransformComponent>& transformComponents = GetComponentList<TransformComponent, JETransformComponentManager>();
-
-                // TODO: eventually get list of lights and pass those instead
-
-                // TODO: scan/sort all material components so we only pass those that cast shadows to the shadow pass
-                const std::vector<MaterialComponent> materialComponentsVector = std::vector(materialComponents.begin(), materialComponents.end());
-                std::vector<std::pair<MaterialComponent, uint32_t>> indices;
-                for (uint32_t i = 0; i < materialComponentsVector.size(); ++i) {
-                    indices.emplace_back(std::pair<MaterialComponent, uint32_t>(materialComponentsVector[i], i));
-                }
+                UpdateWindowTitle((float)glfwGetTime() - startTime);
+            }
+        }
 
-                // Sort by material settings - only send shadow-casting geometry to the shadow pass
-                std::sort(std::begin(indices), std::end(indices),
-                    [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                    return (a.first.m_materialSettings & CASTS_SHADOWS) > (b.first.m_materialSettings & CASTS_SHADOWS);
-                });
+        m_vulkanRenderer.WaitForIdleDevice();
+        StopEngine();
+    }
 
-                uint32_t k = 0;
-                for (k = 0; k < indices.size(); ++k) {
-                    if (!(indices[k].first.m_materialSettings & CASTS_SHADOWS)) {
-                        break;
-                    }
-                }
-                
-                std::vector<MeshComponent>      meshComponentsSorted_shadow;
-                std::vector<MaterialComponent>  materialComponentsSorted_shadow;
-                std::vector<glm::mat4> transformComponentsSorted_shadow;
-                meshComponentsSorted_shadow.reserve(k);
-                materialComponentsSorted_shadow.reserve(k);
-                transformComponentsSorted_shadow.reserve(k);
-
-                std::sort(indices.begin(), indices.begin() + k,
-                    [&](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) -> bool {
-                    return (meshComponents[a.second].GetVertexHandle()) < (meshComponents[b.second].GetVertexHandle());
-                });
+    void JEEngineInstance::RunPipelined() {
+        const JEVulkanWindow& window = m_vulkanRenderer.GetWindow();
 
-                for (uint32_t j = 0; j < k; ++j) {
-                    meshComponentsSorted_shadow.emplace_back(meshComponents.GetData()[indices[j].second]);
-                    transformComponentsSorted_shadow.emplace_back(transformComponents.GetData()[indices[j].second].GetTransform());
-                }
+        // Prepare the first frame up front, so that there is always a frame to render while the next one is simulated
+        JEFrameDrawData* renderDrawData = &m_frameDrawData[0];
+        JEFrameDrawData* simulateDrawData = &m_frameDrawData[1];
+        m_ioHandler.PollInput();
+        UpdateFrame();
+        UpdateParticleMeshes();
+        PrepareDrawData(*renderDrawData);
 
-                m_vulkanRenderer.StartFrame();
+        while (!window.ShouldClose()) {
+            const float startTime = glfwGetTime();
 
-                {
-                    //ScopedTimer<float> timer("Shadow Pass Command Buffer Recording");
-                    m_vulkanRenderer.DrawShadowPass(meshComponentsSorted_shadow, m_sceneManager.m_shadowCamera);
-                }
+            // Input callbacks write to the scene, so they run before the simulation job is launched
+            m_ioHandler.PollInput();
 
-                // Get bounding box info from MeshBuffer Manager
-                const std::vector<BoundingBoxData>& boundingBoxes = m_vulkanRenderer.GetBoundingBoxData();
+            JEFrameSimulationJobData jobData = { this, simulateDrawData, nullptr };
+            JEJobCounter jobCounter;
+            JEThreadPoolInstance.EnqueueJob({ SimulateFrame_MT, &jobData }, &jobCounter);
 
-                std::vector<MeshComponent> meshComponentsPassedCulling;
-                std::vector<MaterialComponent> materialComponentsPassedCulling;
-                std::vector<glm::mat4> transformsPassedCulling;
-                meshComponentsPassedCulling.reserve(256);
-                materialComponentsPassedCulling.reserve(256);
-                transformsPassedCulling.reserve(256);
+            try {
+                RenderFrame(*renderDrawData);
+            } catch (...) {
+                // The job still references the job data on this stack
+                JEThreadPoolInstance.Wait(jobCounter);
+                throw;
+            }
 
-                {
-                    //ScopedTimer<float> timer("Frustum Culling");
-
-                    // TODO: multi-thread this
-                    for (uint32_t i = 0; i < meshComponents.Size(); ++i) {
-                        const MeshComponent& meshComp = meshComponents.GetData()[i];
-                        if (meshComp.GetVertexHandle() == -1 || meshComp.GetIndexHandle() == -1) {
-                            continue;
-                        }
-
-                        const TransformComponent& transformComp = transformComponents.GetData()[i];
-                        if (m_sceneManager.m_camera.Cull(transformComp, boundingBoxes[meshComp.GetVertexHandle()])) {
-                            meshComponentsPassedCulling.emplace_back(meshComp);
-                            transformsPassedCulling.emplace_back(transformComp.GetTransform());
-                            materialComponentsPassedCulling.emplace_back(materialComponents.GetData()[i]);
-                        }
-                    }
-                }
+            JEThreadPoolInstance.Wait(jobCounter);
+            if (jobData.exception) {
+                std::rethrow_exception(jobData.exception);
+            }
 
-                // Sort all components by material properties and by mesh for efficient descriptor set binding and instanced rendering
-                indices.clear();
-                std::vector<MeshComponent>      meshComponentsSorted;
-                std::vector<MaterialComponent>  materialComponentsSorted;
-                std::vector<glm::mat4> transformComponentsSorted;
-                for (uint32_t i = 0; i < materialComponentsPassedCulling.size(); ++i) {
-                    indices.emplace_back(std::pair<MaterialComponent, uint32_t>(materialComponentsPassedCulling[i], i));
-                }
+            // Nothing reads the scene now, until the next simulation job is launched
+            m_vulkanRenderer.RecreateOutOfDateWindowResources();
+            UpdateParticleMeshes();
+            std::swap(renderDrawData, simulateDrawData);
 
-                // 1. Sort by render layer
-                std::sort(std::begin(indices), std::end(indices),
-                    [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                    return (a.first.m_renderLayer) < (b.first.m_renderLayer);
-                });
+            UpdateWindowTitle((float)glfwGetTime() - startTime);
+        }
 
-                // 2. Sort by shader index
-                uint32_t idx = 0;
-                uint32_t currSortIdx = 0;
-                while (idx <= indices.size()) {
-                    if (idx == indices.size()) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                            return (a.first.m_shaderID) < (b.first.m_shaderID);
-                        });
-                        break;
-                    }
+        m_vulkanRenderer.WaitForIdleDevice();
+        StopEngine();
+    }
 
-                    // Detect a change in the sorted materials
-                    if (indices[idx].first.m_renderLayer != indices[currSortIdx].first.m_renderLayer) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                            return (a.first.m_shaderID) < (b.first.m_shaderID);
-                        });
-                        currSortIdx = idx;
-                    }
-                    ++idx;
-                }
+    void JEEngineInstance::SimulateFrame_MT(void* data) {
+        JEFrameSimulationJobData* jobData = (JEFrameSimulationJobData*)data;
+        try {
+            jobData->engineInstance->UpdateFrame();
+            jobData->engineInstance->PrepareDrawData(*jobData->drawData);
+        } catch (...) {
+            jobData->exception = std::current_exception();
+        }
+    }
 
-                // 3. Sort by descriptor index
-                idx = 0;
-                currSortIdx = 0;
-                while (idx <= indices.size()) {
-                    if (idx == indices.size()) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                            return (a.first.m_descriptorID) < (b.first.m_descriptorID);
-                        });
-                        break;
-                    }
+    void JEEngineInstance::RenderFrame(const JEFrameDrawData& drawData) {
+        if (!m_vulkanRenderer.StartFrame()) {
+            return;
+        }
 
-                    // Detect a change in the sorted materials
-                    if (indices[idx].first.m_shaderID != indices[currSortIdx].first.m_shaderID) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) {
-                            return (a.first.m_descriptorID) < (b.first.m_descriptorID);
-                        });
-                        currSortIdx = idx;
-                    }
-                    ++idx;
-                }
+        {
+            //ScopedTimer<float> timer("Shadow Pass Command Buffer Recording");
+            m_vulkanRenderer.DrawShadowPass(drawData.meshComponentsShadow, drawData.shadowCamera);
+        }
 
-                // 4. Sort by mesh component (needed for instanced rendering)
-                idx = 0;
-                currSortIdx = 0;
-                while (idx <= indices.size()) {
-                    if (idx == indices.size()) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [&](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) -> bool {
-                            return (meshComponentsPassedCulling[a.second].GetVertexHandle()) < (meshComponentsPassedCulling[b.second].GetVertexHandle());
-                        });
-                        break;
-                    }
+        {
+            //ScopedTimer<float> timer("Deferred Geom/Lighting/Post Passes Command Buffer Recording");
+            m_vulkanRenderer.DrawMeshes(drawData.meshComponentsSorted, drawData.materialComponentsSorted, drawData.drawBatches,
+                                        drawData.camera, m_particleSystems);
+        }
+
+        {
+            //ScopedTimer<float> timer("GPU workload submission");
+            m_vulkanRenderer.SubmitFrame(drawData.materialComponentsSorted, drawData.transformsShadow, drawData.transformsSorted,
+                                         drawData.transformsShadowVersion, drawData.transformsSortedVersion,
+                                         drawData.camera, drawData.shadowCamera);
+        }
+    }
+
+    void JEEngineInstance::UpdateWindowTitle(float elapsedTime) {
+        // TODO: clean this up?
+        const float fps = 1.0f / elapsedTime;
+        static float avgElapsed = 0.0f;
+        static float avgFps = 0.0f;
+        static uint32_t numFrames = 0;
+        ++numFrames;
+        avgElapsed += elapsedTime;
+        avgFps += fps;
+        glfwSetWindowTitle(m_vulkanRenderer.GetGLFWWindow(), ("The Joe Engine - Demo - " +
+                                                              std::to_string(elapsedTime * 1000.0f) + " ms / frame, " +
+                                                              std::to_string(avgElapsed * 1000.0f / numFrames).c_str() + " avg ms / frame | " +
+                                                              std::to_string(fps) + " fps, " + 
+                                                              std::to_string(avgFps / (float)numFrames).c_str() + " avg fps").c_str());
+    }
+
+    void JEEngineInstance::RunHeadless(uint32_t numFrames) {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double totalMs = 0.0;
+        double minMs = std::numeric_limits<double>::max();
+        double maxMs = 0.0;
+        size_t numDrawn = 0;
+
+        for (uint32_t frame = 0; frame < numFrames; ++frame) {
+            const Clock::time_point startTime = Clock::now();
+
+            UpdateFrame();
+            UpdateParticleMeshes();
+
+            JEFrameDrawData& drawData = m_frameDrawData[0];
+            PrepareDrawData(drawData);
+            numDrawn += drawData.meshComponentsSorted.size();
+
+            const double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+            totalMs += elapsedMs;
+            minMs = std::min(minMs, elapsedMs);
+            maxMs = std::max(maxMs, elapsedMs);
+        }
+
+        if (numFrames > 0) {
+            std::cout << "Headless run: " << numFrames << " frames, " << totalMs << " ms total | " <<
+                         totalMs / numFrames << " avg ms / frame, " << minMs << " min, " << maxMs << " max | " <<
+                         numDrawn / numFrames << " avg visible meshes / frame" << std::endl;
+        }
+
+        StopEngine();
+    }
 
-                    // Detect a change in the sorted materials
-                    if (indices[idx].first.m_descriptorID != indices[currSortIdx].first.m_descriptorID) {
-                        std::sort(indices.begin() + currSortIdx, indices.begin() + idx,
-                            [&](const std::pair<MaterialComponent, uint32_t>& a, const std::pair<MaterialComponent, uint32_t>& b) -> bool {
-                            return (meshComponentsPassedCulling[a.second].GetVertexHandle()) < (meshComponentsPassedCulling[b.second].GetVertexHandle());
-                        });
-                        currSortIdx = idx;
+    void JEEngineInstance::UpdateFrame() {
+        // Release the previous frame's temporaries
+        m_frameArena.Reset();
+
+        // Update components, running non-conflicting component managers in parallel
+        {
+            //ScopedTimer<float> timer("Component Managers");
+            m_systemScheduler.Run(this, m_componentManagers);
+        }
+
+        // Destroy any entities marked for deletion
+        DestroyEntities();
+
+        // Rebuild world matrices for this frame's transform changes in one batch
+        {
+            //ScopedTimer<float> timer("Compose transforms");
+            GetComponentManager<TransformComponent, JETransformComponentManager>()->ComposeTransforms();
+        }
+
+        // Mark the cached draw list entries of entities whose mesh or material changed. The mesh changes are consumed by
+        // UpdateSceneBVH() below.
+        {
+            JEMaterialComponentManager* materialManager = GetComponentManager<MaterialComponent, JEMaterialComponentManager>();
+            m_drawListCache.Invalidate(GetComponentManager<MeshComponent, JEMeshComponentManager>()->GetChangedEntities());
+            m_drawListCache.Invalidate(materialManager->GetChangedEntities());
+            materialManager->ClearChangedEntities();
+        }
+
+        // Refit the scene BVH to this frame's changes
+        {
+            //ScopedTimer<float> timer("Update scene BVH");
+            UpdateSceneBVH();
+        }
+
+        // Update particle systems
+        {
+            //ScopedTimer<float> timer("Update particle systems");
+            m_physicsManager.UpdateParticleSystems(m_particleSystems);
+        }
+    }
+
+    void JEEngineInstance::UpdateParticleMeshes() {
+        //ScopedTimer<float> timer("Update particle systems meshes");
+        for (uint32_t i = 0; i < m_particleSystems.size(); ++i) {
+            JEParticleSystem& particleSystem = m_particleSystems[i];
+            m_vulkanRenderer.UpdateMesh(particleSystem.m_meshComponent, particleSystem.GetVertices(), particleSystem.GetIndices());
+        }
+    }
+
+    void JEEngineInstance::UpdateSceneBVH() {
+        JEMeshComponentManager* meshManager = GetComponentManager<MeshComponent, JEMeshComponentManager>();
+        const PackedArray<MeshComponent>& meshComponents = meshManager->GetComponentList();
+        const JETransformStore& transformStore = GetComponentManager<TransformComponent, JETransformComponentManager>()->GetTransformStore();
+        const std::vector<BoundingBoxData>& boundingBoxes = m_vulkanRenderer.GetBoundingBoxData();
+
+        const auto updateEntity = [&](uint32_t entityID) {
+            const int meshIdx = meshComponents.FindDataIndex(entityID);
+            if (meshIdx < 0 || !transformStore.Contains(entityID)) {
+                m_sceneBVH.Remove(entityID);
+                return;
+            }
+            const MeshComponent& meshComp = meshComponents.GetData()[meshIdx];
+            if (meshComp.GetVertexHandle() == -1 || meshComp.GetIndexHandle() == -1) {
+                m_sceneBVH.Remove(entityID);
+                return;
+            }
+
+            // World-space box around the transformed mesh bounding box
+            const BoundingBoxData& boundingBox = boundingBoxes[meshComp.GetVertexHandle()];
+            const glm::mat4& worldMatrix = transformStore.GetWorldMatrix(entityID);
+            const glm::vec3 localExtents = (boundingBox[7] - boundingBox[0]) * 0.5f;
+            const glm::vec3 center = glm::vec3(worldMatrix * glm::vec4((boundingBox[0] + boundingBox[7]) * 0.5f, 1.0f));
+            const glm::vec3 extents = glm::abs(glm::vec3(worldMatrix[0])) * localExtents.x +
+                                      glm::abs(glm::vec3(worldMatrix[1])) * localExtents.y +
+                                      glm::abs(glm::vec3(worldMatrix[2])) * localExtents.z;
+            m_sceneBVH.Update(entityID, center - extents, center + extents);
+        };
+
+        // Entities whose mesh was added, set or removed (including destroyed entities), then entities that moved
+        for (uint32_t entityID : meshManager->GetChangedEntities()) {
+            updateEntity(entityID);
+        }
+        meshManager->ClearChangedEntities();
+
+        for (uint32_t dataIdx : transformStore.GetChangedIndices()) {
+            updateEntity(transformStore.GetEntityAt(dataIdx));
+        }
+    }
+
+    void JEEngineInstance::PrepareDrawData(JEFrameDrawData& drawData) {
+        // Output lists keep their capacity from frame to frame, all other lists below are frame arena temporaries
+        drawData.meshComponentsShadow.clear();
+        drawData.transformsShadow.clear();
+        drawData.meshComponentsSorted.clear();
+        drawData.materialComponentsSorted.clear();
+        drawData.transformsSorted.clear();
+        drawData.drawBatches.clear();
+        const JEFrameAllocator<uint8_t> frameAllocator(&m_frameArena);
+
+        const PackedArray<MeshComponent>& meshList = GetComponentList<MeshComponent, JEMeshComponentManager>();
+        const PackedArray<MaterialComponent>& materialList = GetComponentList<MaterialComponent, JEMaterialComponentManager>();
+        const JETransformStore& transformStore = GetComponentManager<TransformComponent, JETransformComponentManager>()->GetTransformStore();
+
+        // Joins the component lists by entity for the entities returned by the scene BVH and the draw list, so nothing below
+        // relies on the lists happening to share the same packing
+        const JEComponentView<MeshComponent, MaterialComponent, TransformComponent> drawableView(
+            meshList, materialList, GetComponentList<TransformComponent, JETransformComponentManager>());
+
+        // Get bounding volume info from MeshBuffer Manager
+        const std::vector<BoundingBoxData>& boundingBoxes = m_vulkanRenderer.GetBoundingBoxData();
+        const std::vector<BoundingSphereData>& boundingSpheres = m_vulkanRenderer.GetBoundingSphereData();
+
+        // Culling candidates, gathered by a broad phase query of the scene BVH: the scene BVH skips whole regions outside the
+        // queried volume. Only entities that also have a material with all of 'requiredSettings' are gathered.
+        JEFrameVector<MeshComponent> candidateMeshes(frameAllocator);
+        JEFrameVector<const MaterialComponent*> candidateMaterials(frameAllocator);
+        JEFrameVector<const glm::mat4*> candidateMatrices(frameAllocator);
+        JEFrameVector<uint32_t> candidateIDs(frameAllocator);
+        JEFrameVector<uint32_t> survivors(frameAllocator);
+        candidateMeshes.reserve(m_sceneBVH.Size());
+        candidateMaterials.reserve(m_sceneBVH.Size());
+        candidateMatrices.reserve(m_sceneBVH.Size());
+        candidateIDs.reserve(m_sceneBVH.Size());
+        survivors.reserve(m_sceneBVH.Size());
+        const auto gatherCandidates = [&](const JEFrustum& frustum, uint32_t requiredSettings) {
+            candidateMeshes.clear();
+            candidateMaterials.clear();
+            candidateMatrices.clear();
+            candidateIDs.clear();
+            m_sceneBVH.QueryFrustum(frustum, [&](uint32_t entityID) {
+                drawableView.ForEntity(entityID, [&](uint32_t, const MeshComponent& meshComp, const MaterialComponent& materialComp,
+                                                     const TransformComponent& transformComp) {
+                    if ((materialComp.m_materialSettings & requiredSettings) != requiredSettings) {
+                        return;
                     }
-                    ++idx;
-                }
+                    candidateMeshes.emplace_back(meshComp);
+                    candidateMaterials.emplace_back(&materialComp);
+                    candidateMatrices.emplace_back(&transformComp.GetTransform());
+                    candidateIDs.emplace_back(entityID);
+                });
+            });
+            survivors.resize(candidateMeshes.size());
+        };
+
+        // TODO: eventually get list of lights and pass those instead
+        const JECamera& shadowCamera = m_sceneManager.m_shadowCamera;
+        const JECamera& camera = m_sceneManager.m_camera;
+        const JEFrustum cameraFrustum = camera.GetFrustum();
+
+        // Level of detail: each mesh's LOD errors are projected to pixels at the mesh's closest point to the scene camera, and the
+        // coarsest LOD whose error stays below JE_LOD_MAX_SCREEN_SPACE_ERROR is drawn. Culling always uses the full-detail bounds.
+        const JEMeshBufferManager& meshBufferManager = m_vulkanRenderer.m_meshBufferManager;
+        const float pixelsPerUnitAtUnitDistance = 0.5f * (float)m_vulkanRenderer.m_height * std::abs(camera.GetProj()[1][1]);
+        const auto selectLod = [&](const MeshComponent& mesh, const glm::mat4& worldMatrix) {
+            const int bufferId = mesh.GetVertexHandle();
+            if (bufferId < 0 || meshBufferManager.GetLodChain(bufferId).empty()) {
+                return bufferId;
+            }
 
-                for (uint32_t i = 0; i < indices.size(); ++i) {
-                    materialComponentsSorted.emplace_back(indices[i].first);
-                    meshComponentsSorted.emplace_back(meshComponentsPassedCulling[indices[i].second]);
-                    transformComponentsSorted.emplace_back(transformsPassedCulling[indices[i].second]);
-                }
+            const float scale = std::sqrt(std::max({ glm::dot(glm::vec3(worldMatrix[0]), glm::vec3(worldMatrix[0])),
+                                                     glm::dot(glm::vec3(worldMatrix[1]), glm::vec3(worldMatrix[1])),
+                                                     glm::dot(glm::vec3(worldMatrix[2]), glm::vec3(worldMatrix[2])) }));
+            const BoundingSphereData& sphere = boundingSpheres[bufferId];
+            const glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(sphere.center, 1.0f));
+            const float distance = std::max(glm::length(center - camera.GetEye()) - sphere.radius * scale, camera.GetNearPlane());
+            return meshBufferManager.SelectLod(bufferId, pixelsPerUnitAtUnitDistance * scale / distance);
+        };
+        const auto lodMesh = [](const MeshComponent& mesh, int lod) {
+            return lod == mesh.GetVertexHandle() ? mesh : MeshComponent(lod, MESH_TRIANGLES);
+        };
+
+        // Radix sort scratch lists for the shadow caster sort
+        JEFrameVector<uint64_t> sortKeys(frameAllocator);
+        JEFrameVector<uint32_t> sortValues(frameAllocator);
+        JEFrameVector<uint64_t> sortKeysTmp(frameAllocator);
+        JEFrameVector<uint32_t> sortValuesTmp(frameAllocator);
+        sortKeys.reserve(m_sceneBVH.Size());
+        sortValues.reserve(m_sceneBVH.Size());
+        sortKeysTmp.resize(m_sceneBVH.Size());
+        sortValuesTmp.resize(m_sceneBVH.Size());
+
+        // Only send shadow casters inside the light's view volume whose shadows can fall inside the camera frustum to the shadow
+        // pass, sorted by mesh LOD
+        JEFrameVector<uint32_t> shadowDrawIndices(frameAllocator);
+        JEFrameVector<int> casterLods(frameAllocator);
+        {
+            //ScopedTimer<float> timer("Shadow Caster Culling");
+            const JEFrustum lightFrustum = shadowCamera.GetOrthoFrustum();
+            gatherCandidates(lightFrustum, CASTS_SHADOWS);
+            const uint32_t numCasters = m_frustumCuller.CullShadowCasters(lightFrustum, cameraFrustum, shadowCamera.GetLook(),
+                                                                          candidateMeshes.data(), candidateMatrices.data(),
+                                                                          (uint32_t)candidateMeshes.size(), boundingBoxes,
+                                                                          boundingSpheres, survivors.data());
+
+            uint32_t maxShadowMeshHandle = 0;
+            casterLods.resize(candidateMeshes.size());
+            for (uint32_t s = 0; s < numCasters; ++s) {
+                casterLods[survivors[s]] = selectLod(candidateMeshes[survivors[s]], *candidateMatrices[survivors[s]]);
+                const uint32_t meshHandle = (uint32_t)casterLods[survivors[s]];
+                maxShadowMeshHandle = std::max(maxShadowMeshHandle, meshHandle);
+                sortKeys.emplace_back(meshHandle);
+                sortValues.emplace_back(survivors[s]);
+            }
+            RadixSortUtils::SortKeyValuePairs(sortKeys.data(), sortValues.data(), sortKeysTmp.data(), sortValuesTmp.data(),
+                                              (uint32_t)sortKeys.size(), RadixSortUtils::NumBitsNeeded(maxShadowMeshHandle));
+
+            const uint32_t k = (uint32_t)sortValues.size();
+            drawData.meshComponentsShadow.reserve(k);
+            drawData.transformsShadow.reserve(k);
+            shadowDrawIndices.reserve(k);
+            for (uint32_t j = 0; j < k; ++j) {
+                drawData.meshComponentsShadow.emplace_back(lodMesh(candidateMeshes[sortValues[j]], casterLods[sortValues[j]]));
+                drawData.transformsShadow.emplace_back(*candidateMatrices[sortValues[j]]);
+                shadowDrawIndices.emplace_back(candidateIDs[sortValues[j]]);
+            }
+        }
 
-                {
-                    //ScopedTimer<float> timer("Deferred Geom/Lighting/Post Passes Command Buffer Recording");
-                    m_vulkanRenderer.DrawMeshes(meshComponentsSorted, materialComponentsSorted, m_sceneManager.m_camera, m_particleSystems);
-                }
-                
-                {
-                    //ScopedTimer<float> timer("GPU workload submission");
-                    m_vulkanRenderer.SubmitFrame(materialComponentsSorted, transformComponentsSorted_shadow, transformComponentsSorted);
+        JEFrameVector<uint32_t> visibleIDs(frameAllocator);
+        JEFrameVector<uint32_t> visibleLods(frameAllocator);
+        {
+            //ScopedTimer<float> timer("Frustum and Occlusion Culling");
+            gatherCandidates(cameraFrustum, NO_SETTINGS);
+
+            // Narrow phase: exact tests of the candidates' bounding volumes
+            uint32_t numSurvivors = m_frustumCuller.Cull(cameraFrustum, candidateMeshes.data(), candidateMatrices.data(),
+                                                         (uint32_t)candidateMeshes.size(), boundingBoxes, boundingSpheres,
+                                                         survivors.data());
+
+            // Occlusion: rasterize the visible opaque occluders on the CPU and drop the survivors hidden behind them
+            JEFrameVector<MeshComponent> occluderMeshes(frameAllocator);
+            JEFrameVector<const glm::mat4*> occluderMatrices(frameAllocator);
+            for (uint32_t s = 0; s < numSurvivors; ++s) {
+                const MaterialComponent& material = *candidateMaterials[survivors[s]];
+                if ((material.m_materialSettings & OCCLUDER) && material.m_renderLayer < TRANSLUCENT) {
+                    occluderMeshes.emplace_back(candidateMeshes[survivors[s]]);
+                    occluderMatrices.emplace_back(candidateMatrices[survivors[s]]);
                 }
-
-                // TODO: clean this up?
-                const float endTime = glfwGetTime();
-                const float elapsedTime = endTime - startTime;
-                const float fps = 1.0f / elapsedTime;
-                static float avgElapsed = 0.0f;
-                static float avgFps = 0.0f;
-                static uint32_t numFrames = 0;
-                ++numFrames;
-                avgElapsed += elapsedTime;
-                avgFps += fps;
-                glfwSetWindowTitle(m_vulkanRenderer.GetGLFWWindow(), ("The Joe Engine - Demo - " +
-                                                                      std::to_string(elapsedTime * 1000.0f) + " ms / frame, " +
-                                                                      std::to_string(avgElapsed * 1000.0f / numFrames).c_str() + " avg ms / frame | " +
-                                                                      std::to_string(fps) + " fps, " + 
-                                                                      std::to_string(avgFps / (float)numFrames).c_str() + " avg fps").c_str());
+            }
+            m_occlusionCuller.RenderOccluders(camera.GetViewProj(), occluderMeshes.data(), occluderMatrices.data(),
+                                              (uint32_t)occluderMeshes.size(), m_vulkanRenderer.m_meshBufferManager);
+            numSurvivors = m_occlusionCuller.Cull(candidateMeshes.data(), candidateMatrices.data(), survivors.data(), numSurvivors,
+                                                  boundingBoxes, survivors.data());
+
+            visibleIDs.reserve(numSurvivors);
+            visibleLods.reserve(numSurvivors);
+            for (uint32_t s = 0; s < numSurvivors; ++s) {
+                visibleIDs.emplace_back(candidateIDs[survivors[s]]);
+                visibleLods.emplace_back((uint32_t)selectLod(candidateMeshes[survivors[s]], *candidateMatrices[survivors[s]]));
             }
         }
 
-        m_vulkanRenderer.WaitForIdleDevice();
-        StopEngine();
+        const uint64_t transformStoreVersion = transformStore.GetVersion();
+        const bool transformsChanged = transformStoreVersion != m_lastTransformStoreVersion;
+        m_lastTransformStoreVersion = transformStoreVersion;
+
+        // Update the persistent draw list, sorted by material properties and by mesh LOD for efficient descriptor set binding and
+        // instanced rendering, then by view depth. Entries only move when visibility, components, LODs or depths change.
+        const glm::mat4& viewMatrix = camera.GetView();
+        const bool viewChanged = viewMatrix != m_lastViewMatrix;
+        m_lastViewMatrix = viewMatrix;
+        const bool drawListChanged = m_drawListCache.Update(visibleIDs.data(), visibleLods.data(), (uint32_t)visibleIDs.size(),
+                                                            meshList, materialList, transformStore, viewMatrix,
+                                                            viewChanged || transformsChanged);
+
+        const uint32_t numDrawn = m_drawListCache.Size();
+        drawData.meshComponentsSorted.reserve(numDrawn);
+        drawData.materialComponentsSorted.reserve(numDrawn);
+        drawData.transformsSorted.reserve(numDrawn);
+        for (uint32_t i = 0; i < numDrawn; ++i) {
+            drawableView.ForEntity(m_drawListCache.GetEntityAt(i), [&](uint32_t, const MeshComponent& meshComp,
+                                                                       const MaterialComponent& materialComp,
+                                                                       const TransformComponent& transformComp) {
+                drawData.meshComponentsSorted.emplace_back(lodMesh(meshComp, (int)m_drawListCache.GetMeshAt(i)));
+                drawData.materialComponentsSorted.emplace_back(materialComp);
+                drawData.transformsSorted.emplace_back(transformComp.GetTransform());
+            });
+        }
+        drawData.drawBatches.assign(m_drawListCache.GetBatches().begin(), m_drawListCache.GetBatches().end());
+
+        // Only bump the transform list versions when their contents actually changed, i.e. some transform was modified or
+        // the set/order of drawn entities differs from last frame. This lets the renderer skip redundant SSBO uploads.
+        const auto sameDrawIndices = [](const JEFrameVector<uint32_t>& drawIndices, const std::vector<uint32_t>& lastDrawIndices) {
+            return drawIndices.size() == lastDrawIndices.size() &&
+                   std::equal(drawIndices.begin(), drawIndices.end(), lastDrawIndices.begin());
+        };
+        if (transformsChanged || !sameDrawIndices(shadowDrawIndices, m_lastShadowDrawIndices)) {
+            ++m_shadowTransformsVersion;
+            m_lastShadowDrawIndices.assign(shadowDrawIndices.begin(), shadowDrawIndices.end());
+        }
+        if (transformsChanged || drawListChanged) {
+            ++m_sortedTransformsVersion;
+        }
+        drawData.transformsShadowVersion = m_shadowTransformsVersion;
+        drawData.transformsSortedVersion = m_sortedTransformsVersion;
+        drawData.camera = camera;
+        drawData.shadowCamera = shadowCamera;
     }
 
-    void JEEngineInstance::InitializeEngine(RendererSettings rendererSettings) {
+    void JEEngineInstance::InitializeEngine(RendererSettings rendererSettings, const JEThreadPoolSettings& threadPoolSettings) {
         {
             ScopedTimer<float> timer("Initialize Joe Engine");
+            // Start the workers before any asset processing that uses them
+            if (!JEThreadPoolInstance.IsStarted()) {
+                JEThreadPoolInstance.Start(threadPoolSettings);
+            }
+
             // Init list of component managers
             RegisterComponentManager<MeshComponent, JEMeshComponentManager>();
             RegisterComponentManager<MaterialComponent, JEMaterialComponentManager>();
@@ -258,6 +496,11 @@ namespace JoeEngine {
             m_sceneManager.Initialize(this);
             m_vulkanRenderer.Initialize(rendererSettings, &m_sceneManager, this);
 
+            if (m_vulkanRenderer.IsHeadless()) {
+                // No window to receive input from
+                return;
+            }
+
             GLFWwindow* window = m_vulkanRenderer.GetGLFWWindow();
             m_ioHandler.Initialize(window);
             glfwSetWindowUserPointer(window, this);
@@ -271,11 +514,25 @@ namespace JoeEngine {
     }
 
     void JEEngineInstance::DestroyEntities() {
+        if (m_destroyedEntities.empty()) {
+            return;
+        }
+
+        std::vector<uint32_t> entityIDs;
+        entityIDs.reserve(m_destroyedEntities.size());
         for (Entity e : m_destroyedEntities) {
-            for (uint32_t i = 0; i < m_componentManagers.size(); ++i) {
-                m_componentManagers[i]->RemoveComponent(e.GetId());
+            // Skip stale handles (e.g. the same entity destroyed twice) so the components of a recycled index are left alone
+            if (!m_entityManager.DestroyEntity(e)) {
+                continue;
             }
-            m_entityManager.DestroyEntity(e);
+
+            // Drop all archetype components at once rather than moving the entity through one archetype per component
+            m_archetypeStorage.RemoveEntity(e.GetId());
+            entityIDs.push_back(e.GetId());
+        }
+
+        for (uint32_t i = 0; i < m_componentManagers.size(); ++i) {
+            m_componentManagers[i]->RemoveComponents(entityIDs);
         }
         m_destroyedEntities.clear();
     }
@@ -295,17 +552,48 @@ namespace JoeEngine {
         return entity;
     }
 
+    std::vector<Entity> JEEngineInstance::SpawnEntities(uint32_t count, uint32_t componentMask) {
+        // Shifting a 32-bit mask by 32 or more is undefined, and any mask is valid once 32 managers are registered
+        const size_t numManagers = m_componentManagers.size();
+        if (numManagers < 32 && (componentMask >> numManagers)) {
+            throw std::runtime_error("Component mask selects an unregistered component manager");
+        }
+
+        std::vector<Entity> entities;
+        m_entityManager.SpawnEntities(count, entities);
+
+        std::vector<uint32_t> entityIDs;
+        entityIDs.reserve(count);
+        for (const Entity& entity : entities) {
+            entityIDs.push_back(entity.GetId());
+        }
+
+        for (uint32_t i = 0; i < m_componentManagers.size() && i < 32; ++i) {
+            if (componentMask & (1u << i)) {
+                m_componentManagers[i]->AddNewComponents(entityIDs);
+            }
+        }
+
+        return entities;
+    }
+
     void JEEngineInstance::DestroyEntity(Entity entity) {
+        std::unique_lock<std::mutex> lock(m_destroyedEntitiesMutex);
         m_destroyedEntities.push_back(entity);
     }
 
+    void JEEngineInstance::DestroyEntities(const std::vector<Entity>& entities) {
+        std::unique_lock<std::mutex> lock(m_destroyedEntitiesMutex);
+        m_destroyedEntities.insert(m_destroyedEntities.end(), entities.begin(), entities.end());
+    }
+
     void JEEngineInstance::LoadScene(uint32_t id) {
         m_sceneManager.LoadScene(id, { JE_DEFAULT_SCREEN_WIDTH, JE_DEFAULT_SCREEN_HEIGHT },
                                      { JE_DEFAULT_SHADOW_MAP_WIDTH, JE_DEFAULT_SHADOW_MAP_HEIGHT });
     }
 
-    MeshComponent JEEngineInstance::CreateMeshComponent(const std::string& filepath) {
-        MeshComponent meshComp = m_vulkanRenderer.CreateMesh(filepath);
+    MeshComponent JEEngineInstance::CreateMeshComponent(const std::string& filepath, uint32_t numLods) {
+        MeshComponent meshComp = m_vulkanRenderer.CreateMesh(filepath, numLods);
         return meshComp;
     }
 
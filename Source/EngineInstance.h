@@ -1,8 +1,9 @@
 #pragma once
 
+#include <array>
+#include <exception>
 #include <string>
-#include <unordered_map>
-#include <typeindex>
+#include <mutex>
 
 #include "Io/IOHandler.h"
 #include "Scene/SceneManager.h"
@@ -10,12 +11,72 @@
 #include "Physics/ParticleSystem.h"
 #include "Physics/PhysicsManager.h"
 #include "Scene/EntityManager.h"
+#include "Scene/FrustumCuller.h"
+#include "Scene/OcclusionCuller.h"
+#include "Scene/DrawListCache.h"
+#include "Scene/BoundingVolumeHierarchy.h"
 #include "Components/ComponentManager.h"
+#include "Components/ComponentTypeId.h"
+#include "Components/SystemScheduler.h"
+#include "Components/ArchetypeComponentManager.h"
+#include "Containers/ComponentView.h"
+#include "Utils/FrameAllocator.h"
+#include "Utils/ThreadPool.h"
 #include "Components/Mesh/MeshComponentManager.h"
 #include "Components/Material/MaterialComponentManager.h"
 #include "Components/Transform/TransformComponentManager.h"
 
 namespace JoeEngine {
+    //! Component mask enum
+    /*!
+      Selects which components SpawnEntities() adds to each new entity. Bit i selects the i-th registered component manager;
+      the built-in managers are always registered first, in this order.
+    */
+    typedef enum JE_COMPONENT_MASK : uint32_t {
+        JE_COMPONENT_MESH = 0x1,
+        JE_COMPONENT_MATERIAL = 0x2,
+        JE_COMPONENT_TRANSFORM = 0x4,
+        JE_COMPONENT_BUILT_IN = 0x7
+    } ComponentMask;
+
+    //! Frame draw data.
+    /*!
+      All of the per-frame lists produced by the engine's visibility/sorting step and consumed by the renderer, along with the
+      cameras they were prepared for. A snapshot of everything the renderer reads from the scene, so that the next frame can be
+      simulated while this one is recorded and submitted. Shared by the windowed and headless main loops.
+    */
+    typedef struct je_frame_draw_data_t {
+        //! Shadow-casting meshes, sorted by mesh.
+        std::vector<MeshComponent> meshComponentsShadow;
+
+        //! Shadow-casting transforms, parallel to 'meshComponentsShadow'.
+        std::vector<glm::mat4> transformsShadow;
+
+        //! Meshes that passed culling, sorted for optimal resource binding frequency.
+        std::vector<MeshComponent> meshComponentsSorted;
+
+        //! Materials that passed culling, parallel to 'meshComponentsSorted'.
+        std::vector<MaterialComponent> materialComponentsSorted;
+
+        //! Transforms that passed culling, parallel to 'meshComponentsSorted'.
+        std::vector<glm::mat4> transformsSorted;
+
+        //! Instanced draw batches over 'meshComponentsSorted', in order.
+        std::vector<JEDrawBatch> drawBatches;
+
+        //! Version of 'transformsShadow'. Only changes when the list contents differ from the previous frame's.
+        uint64_t transformsShadowVersion;
+
+        //! Version of 'transformsSorted'. Only changes when the list contents differ from the previous frame's.
+        uint64_t transformsSortedVersion;
+
+        //! Scene camera the lists were culled and sorted for.
+        JECamera camera;
+
+        //! Shadow camera the shadow caster list was culled for.
+        JECamera shadowCamera;
+    } JEFrameDrawData;
+
     //! The Engine Instance class.
     /*!
       This is the most important class - the actual instance of the Joe Engine. It owns and manages all the major subsystems,
@@ -41,19 +102,50 @@ namespace JoeEngine {
         // Entity manager.
         JEEntityManager m_entityManager;
 
+        //! Archetype storage.
+        /*! Chunked storage for component types registered via RegisterArchetypeComponent(). */
+        JEArchetypeStorage m_archetypeStorage;
+
         //! List of various component managers.
         std::vector<std::unique_ptr<JEComponentManager>> m_componentManagers;
+
+        //! System scheduler.
+        /*! Runs the component managers' updates each frame, in parallel where their declared component accesses allow. */
+        JESystemScheduler m_systemScheduler;
         
         //! List of particle systems.
         std::vector<JEParticleSystem> m_particleSystems;
 
-        //! Map of component type to index in the list 'm_componentManagers'.
-        // TODO: replace me?
-        std::unordered_map<std::type_index, uint32_t> m_componentTypeToIndex;
+        //! Component managers indexed by component type ID.
+        /*! Non-owning, nullptr for component types without a registered manager. See JEComponentTypeId. */
+        std::vector<JEComponentManager*> m_componentManagersByType;
+
+        //! Take ownership of a component manager and register it for the specified component type.
+        template <typename T>
+        void AddComponentManager(JEComponentManager* manager) {
+            m_componentManagers.emplace_back(std::unique_ptr<JEComponentManager>(manager));
+
+            const uint32_t typeId = JEComponentTypeId::Get<T>();
+            if (typeId >= m_componentManagersByType.size()) {
+                m_componentManagersByType.resize(typeId + 1, nullptr);
+            }
+            m_componentManagersByType[typeId] = manager;
+        }
+
+        //! Get the manager registered for a component type with a direct array index. Throws an error if there is none.
+        template <typename T>
+        JEComponentManager* GetManagerForType() const {
+            const uint32_t typeId = JEComponentTypeId::Get<T>();
+            if (typeId >= m_componentManagersByType.size() || m_componentManagersByType[typeId] == nullptr) {
+                throw std::runtime_error("Component type not registered");
+            }
+            return m_componentManagersByType[typeId];
+        }
         
         //! Initialization/startup function.
         //! \param rendererSettings the user-provided renderer subsystem settings.
-        void InitializeEngine(RendererSettings rendererSettings);
+        //! \param threadPoolSettings the user-provided thread pool settings.
+        void InitializeEngine(RendererSettings rendererSettings, const JEThreadPoolSettings& threadPoolSettings);
 
         //! Stop/shutdown function.
         void StopEngine();
@@ -61,26 +153,139 @@ namespace JoeEngine {
         //! List of entities destroyed this frame.
         std::vector<Entity> m_destroyedEntities;
 
+        //! Synchronizes DestroyEntity() calls from component manager updates running in parallel.
+        std::mutex m_destroyedEntitiesMutex;
+
         //! Synchronously destroy entities in the list 'm_destroyedEntities', then clear the list.
+        //! Components are removed with one batched call per component manager.
         void DestroyEntities();
 
+        //! Throw an error if the entity handle does not refer to a live entity, e.g. because its index has been recycled.
+        void ValidateEntity(const Entity& entity) const {
+            if (!m_entityManager.IsAlive(entity)) {
+                throw std::runtime_error("Stale entity handle");
+            }
+        }
+
+        //! Transform store version seen by the previous call to PrepareDrawData().
+        uint64_t m_lastTransformStoreVersion;
+
+        //! Entity IDs of the previous frame's shadow casters, in draw order.
+        std::vector<uint32_t> m_lastShadowDrawIndices;
+
+        //! Current version of the shadow caster transform list.
+        uint64_t m_shadowTransformsVersion;
+
+        //! Current version of the visible mesh transform list.
+        uint64_t m_sortedTransformsVersion;
+
+        //! Frame arena.
+        /*! Linear allocator for frame preparation temporaries, reset at the start of every frame. */
+        JEFrameArena m_frameArena;
+
+        //! Frustum culling stage.
+        JEFrustumCuller m_frustumCuller;
+
+        //! Occlusion culling stage, run on the frustum culling survivors.
+        JEOcclusionCuller m_occlusionCuller;
+
+        //! Persistent draw list of the visible meshes.
+        JEDrawListCache m_drawListCache;
+
+        //! Camera view matrix seen by the previous call to PrepareDrawData().
+        glm::mat4 m_lastViewMatrix;
+
+        //! Scene bounding volume hierarchy.
+        /*! World-space bounds of every entity with a valid mesh and a transform, kept up to date by UpdateSceneBVH(). */
+        JEBoundingVolumeHierarchy m_sceneBVH;
+
+        //! Frame draw data, double-buffered.
+        /*!
+          Reused every frame so that their lists keep their capacity. With pipelined frames, the renderer reads one of them while the
+          next frame is prepared into the other. Otherwise only the first one is used.
+        */
+        std::array<JEFrameDrawData, 2> m_frameDrawData;
+
+        //! Frame simulation job data.
+        typedef struct je_frame_simulation_job_data_t {
+            //! Engine instance to simulate.
+            JEEngineInstance* engineInstance;
+
+            //! Frame draw data to prepare.
+            JEFrameDrawData* drawData;
+
+            //! Exception thrown by the job, if any, to rethrow on the render thread.
+            std::exception_ptr exception;
+        } JEFrameSimulationJobData;
+
+        //! Thread pool job function: simulate a frame and prepare its draw data.
+        static void SimulateFrame_MT(void* data);
+
+        //! Run the main loop with pipelined frames.
+        /*!
+          Each frame is simulated and prepared by a thread pool job while the main thread records and submits the previous frame
+          from its draw data. Input is polled before each simulation job, and the window-dependent resources and particle system
+          meshes are only updated between jobs, so the two never touch the same state.
+        */
+        void RunPipelined();
+
+        //! Record and submit a frame from its draw data. Skips the frame if no swap chain image could be acquired.
+        //! \param drawData the frame draw data to render.
+        void RenderFrame(const JEFrameDrawData& drawData);
+
+        //! Show the frame time in the window title.
+        //! \param elapsedTime the time the frame took, in seconds.
+        void UpdateWindowTitle(float elapsedTime);
+
+        //! Simulate one frame: update all component managers, destroy entities, update the scene BVH and update particle systems.
+        //! Touches no GPU resources, see UpdateParticleMeshes().
+        void UpdateFrame();
+
+        //! Upload the particle systems' meshes as simulated by UpdateFrame().
+        void UpdateParticleMeshes();
+
+        //! Update the scene BVH for this frame's mesh changes and transform changes.
+        void UpdateSceneBVH();
+
+        //! Build the shadow caster list and the culled, sorted draw lists for the current frame.
+        //! \param drawData the frame draw data to fill.
+        void PrepareDrawData(JEFrameDrawData& drawData);
+
     public:
         // Default constructor.
         /*! Invokes the other constructor with default settings. */
         JEEngineInstance() : JEEngineInstance(RendererSettings::Default) {}
 
         //! Constructor.
-        /*! Invokes the initialization function. */
-        JEEngineInstance(RendererSettings rendererSettings) {
-            InitializeEngine(rendererSettings);
+        /*!
+          Invokes the initialization function.
+          \param rendererSettings the renderer subsystem settings.
+          \param threadPoolSettings the settings to start JEThreadPoolInstance with, unless it was already started.
+        */
+        JEEngineInstance(RendererSettings rendererSettings, const JEThreadPoolSettings& threadPoolSettings = JEThreadPoolSettings())
+            : m_lastTransformStoreVersion(0), m_shadowTransformsVersion(0), m_sortedTransformsVersion(0), m_lastViewMatrix(0.0f) {
+            InitializeEngine(rendererSettings, threadPoolSettings);
         }
 
         //! Destructor (default).
         ~JEEngineInstance() = default;
 
-        //! Run the main loop.
+        //! Run the main loop. Runs the headless loop instead if the engine was created with RendererSettings::Headless.
+        /*!
+          With RendererSettings::PipelinedFrames, the next frame is simulated on the thread pool while the current one is recorded
+          and submitted, at the cost of one frame of latency. Component manager updates must then not create or update GPU
+          resources.
+        */
         void Run();
 
+        //! Run a fixed number of frames without a window or GPU, then shut down.
+        /*!
+          Performs the same simulation and draw list preparation as Run(), but skips input, command recording and submission.
+          Prints per-frame timing statistics when done. Useful for profiling and CI.
+          \param numFrames the number of frames to simulate.
+        */
+        void RunHeadless(uint32_t numFrames);
+
         //! Get the renderer subsystem.
         JEVulkanRenderer& GetRenderSubsystem() {
             return m_vulkanRenderer;
@@ -94,10 +299,33 @@ namespace JoeEngine {
         //! User function - spawn an entity into the scene.
         Entity SpawnEntity();
 
+        //! User function - spawn a batch of entities into the scene.
+        /*!
+          Much cheaper than calling SpawnEntity() repeatedly: each selected component manager reserves storage once and adds all
+          the components in a single call.
+          \param count the number of entities to spawn.
+          \param componentMask which component managers to add components from, see ComponentMask.
+          \return the newly spawned entities.
+        */
+        std::vector<Entity> SpawnEntities(uint32_t count, uint32_t componentMask = JE_COMPONENT_BUILT_IN);
+
         //! User function - destroy an entity in the scene.
+        //! The entity is destroyed at the end of the frame's component updates. Destroying an already destroyed entity does nothing.
+        //! Safe to call from component manager updates running in parallel.
         //! \param entity the entity to destroy.
         void DestroyEntity(Entity entity);
 
+        //! User function - destroy a batch of entities in the scene.
+        //! The entities are destroyed at the end of the frame's component updates, together with any others destroyed this frame.
+        //! \param entities the entities to destroy.
+        void DestroyEntities(const std::vector<Entity>& entities);
+
+        //! User function - check whether an entity handle refers to a live entity.
+        //! \param entity the entity handle to check.
+        bool IsEntityAlive(const Entity& entity) const {
+            return m_entityManager.IsAlive(entity);
+        }
+
         //! Load a particular scene.
         //! \param id the scene ID to load.
         void LoadScene(uint32_t id);
@@ -106,23 +334,54 @@ namespace JoeEngine {
         template <typename T, typename U>
         void RegisterComponentManager() {
             // TODO: custom allocator instead of 'operator new'?
-            m_componentManagers.emplace_back(std::unique_ptr<U>(new U()));
-            m_componentTypeToIndex[typeid(T)] = m_componentManagers.size() - 1;
+            AddComponentManager<T>(new U());
+        }
+
+        //! Register a component type stored in the archetype storage with the engine.
+        /*!
+          The component type is then used through AddComponent(), GetComponent<T, JEArchetypeComponentManager<T>>() etc. like any
+          other component type, and can also be iterated together with other archetype components via GetArchetypeStorage().
+        */
+        template <typename T>
+        void RegisterArchetypeComponent() {
+            AddComponentManager<T>(new JEArchetypeComponentManager<T>(&m_archetypeStorage));
+        }
+
+        //! Get the scene bounding volume hierarchy, e.g. for frustum, box, sphere or ray queries against entity bounds.
+        /*!
+          Holds every entity with a valid mesh and a transform, up to date as of the end of the last frame's simulation.
+          Mesh changes are only seen when made through SetComponent().
+        */
+        const JEBoundingVolumeHierarchy& GetSceneBVH() const {
+            return m_sceneBVH;
+        }
+
+        //! Get the archetype storage, e.g. to iterate archetype components chunk by chunk.
+        JEArchetypeStorage& GetArchetypeStorage() {
+            return m_archetypeStorage;
+        }
+
+        //! Get a particular component manager.
+        template <typename T, typename U>
+        U* GetComponentManager() const {
+            return static_cast<U*>(GetManagerForType<T>());
         }
 
         //! Get a particular component manager's list of components.
         template <typename T, typename U>
         const PackedArray<T>& GetComponentList() const {
-            return static_cast<U*>(m_componentManagers[m_componentTypeToIndex.at(typeid(T))].get())->GetComponentList();
+            return static_cast<U*>(GetManagerForType<T>())->GetComponentList();
         }
 
         //! Create a mesh component with a specific path to a mesh file. Invokes a mesh loading function in the renderer.
         /*!
           \param filepath the mesh file source path.
+          \param numLods the maximum number of levels of detail to generate for the mesh. The LOD drawn for each entity is selected
+          every frame by its projected screen-space error.
           \return the newly created Mesh Component.
         */
         // TODO: replace me with something more general? or not, as this is a built-in component type
-        MeshComponent CreateMeshComponent(const std::string& filepath);
+        MeshComponent CreateMeshComponent(const std::string& filepath, uint32_t numLods = 0);
 
         //! Load a texture into the engine at a specific path. Invokes a function in the renderer.
         /*!
@@ -154,30 +413,36 @@ namespace JoeEngine {
         void InstantiateParticleSystem(const JEParticleSystemSettings& settings, const MaterialComponent& materialComponent);
 
         //! Add a component to a particular entity.
+        //! Throws an error if the entity handle is stale.
         //! \param entity the entity to add a component to.
         template<typename T>
         void AddComponent(const Entity& entity) {
-            m_componentManagers[m_componentTypeToIndex.at(typeid(T))].get()->AddNewComponent(entity.GetId());
+            ValidateEntity(entity);
+            GetManagerForType<T>()->AddNewComponent(entity.GetId());
         }
 
         //! Get the component attached to an entity.
         /*!
+          Throws an error if the entity handle is stale.
           \param entity the entity to get the component for
           \return a pointer to the retrieved component.
         */
         template <typename T, typename U>
         T* GetComponent(const Entity& entity) const {
-            return static_cast<U*>(m_componentManagers[m_componentTypeToIndex.at(typeid(T))].get())->GetComponent(entity.GetId());
+            ValidateEntity(entity);
+            return static_cast<U*>(GetManagerForType<T>())->GetComponent(entity.GetId());
         }
 
         //! Set a entity's component data to some new component data.
         /*!
+          Throws an error if the entity handle is stale.
           \param entity the entity to set the component for.
           \param comp the new component data.
         */
         template <typename U, typename T>
         void SetComponent(const Entity& entity, const T& comp) {
-            static_cast<U*>(m_componentManagers[m_componentTypeToIndex.at(typeid(T))].get())->SetComponent(entity.GetId(), comp);
+            ValidateEntity(entity);
+            static_cast<U*>(GetManagerForType<T>())->SetComponent(entity.GetId(), comp);
         }
     };
 }
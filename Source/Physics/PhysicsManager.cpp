@@ -7,7 +7,7 @@
 
 #include "JoeEngineConfig.h"
 #include "PhysicsManager.h"
-#include "../Utils/ThreadPool.h"
+#include "../Utils/ParallelFor.h"
 
 namespace JoeEngine {
     void JEPhysicsManager::Initialize() {
@@ -19,13 +19,10 @@ namespace JoeEngine {
         float dt;
         uint32_t startIdx;
         uint32_t endIdx;
-        bool complete;
     } ParticleUpdateData;
 
-    // Multithreading functions for particle updates
-    void UpdateParticleSystems_MT(void* data) {
-        ParticleUpdateData* particleData = (ParticleUpdateData*)data;
-
+    // Update a range of particles, run in parallel
+    static void UpdateParticleRange(const ParticleUpdateData* particleData) {
         std::vector<glm::vec3>& positions = particleData->particleSystem->GetPositionData();
         std::vector<glm::vec3>& velocities = particleData->particleSystem->GetVelocityData();
         std::vector<glm::vec3>& accels = particleData->particleSystem->GetAccelData();
@@ -111,8 +108,6 @@ namespace JoeEngine {
             lifetimes[i] -= lifetimeDecrement;
         }
         #endif
-
-        particleData->complete = true;
     }
     
     void JEPhysicsManager::UpdateParticleSystems(std::vector<JEParticleSystem>& particleSystems) {
@@ -134,53 +129,10 @@ namespace JoeEngine {
                 constexpr bool multithread = true;
 
                 if constexpr (multithread) {
-                    const uint32_t numParticlesPerGroup = 10000;
-                    const uint32_t numGroups = particleSystem.m_settings.numParticles / numParticlesPerGroup;
-                    
-                    std::vector<ParticleUpdateData> particleUpdateDataList;
-                    particleUpdateDataList.reserve(numGroups);
-                    for (uint32_t i = 0; i < numGroups; ++i) {
-                        ParticleUpdateData particleUpdate;
-                        particleUpdate.complete = false;
-                        particleUpdate.dt = m_updateDt;
-                        particleUpdate.startIdx = i * numParticlesPerGroup;
-                        particleUpdate.endIdx = particleUpdate.startIdx + numParticlesPerGroup;
-                        particleUpdate.particleSystem = &particleSystem;
-                        particleUpdateDataList.push_back(particleUpdate);
-                        JEThreadPoolInstance.EnqueueJob({ UpdateParticleSystems_MT, particleUpdateDataList.data() + i });
-                    }
-
-                    // Integrate any remaining particles on this thread
-                    for (uint32_t i = numParticlesPerGroup * numGroups; i < particleSystem.m_settings.numParticles; ++i) {
-                        velocities[i] += accels[i] * m_updateDt;
-                    }
-
-                    for (uint32_t i = numParticlesPerGroup * numGroups; i < particleSystem.m_settings.numParticles; ++i) {
-                        positions[i] += velocities[i] * m_updateDt;
-                    }
-
-                    for (uint32_t i = numParticlesPerGroup * numGroups; i < particleSystem.m_settings.numParticles; ++i) {
-                        lifetimes[i] -= m_updateRateMillis;
-                    }
-
-                    // Busy-wait for the thread jobs to complete
-                    {
-                        //ScopedTimer<float> timer("Busy-wait for particle update threads to complete");
-                        while (true) {
-                            uint32_t numJobsComplete = 0;
-                            for (uint32_t i = 0; i < particleUpdateDataList.size(); ++i) {
-                                // If any job is not yet complete, start waiting again
-                                if (particleUpdateDataList[i].complete) {
-                                    ++numJobsComplete;
-                                }
-                            }
-
-                            // All jobs completed
-                            if (numJobsComplete == particleUpdateDataList.size()) {
-                                break;
-                            }
-                        }
-                    }
+                    ParallelUtils::ParallelFor(0, particleSystem.m_settings.numParticles, 0, [&](uint32_t startIdx, uint32_t endIdx) {
+                        const ParticleUpdateData particleUpdate = { &particleSystem, m_updateDt, startIdx, endIdx };
+                        UpdateParticleRange(&particleUpdate);
+                    });
                 } else {
                     #ifdef JOE_ENGINE_SIMD_AVX
                     // TODO: AVX implementation for particle updates
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <unordered_map>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #include "MeshBufferManager.h"
+#include "MeshSimplification.h"
+#include "../Utils/ParallelFor.h"
 
 namespace JoeEngine {
     JESingleMesh JEMeshBufferManager::m_screenSpaceTriangle {};
@@ -46,6 +49,12 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::Cleanup() {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - no GPU buffers were ever created
+            m_numBuffers = 0;
+            return;
+        }
+
         for (uint32_t i = 0; i < m_numBuffers; ++i) {
             vkDestroyBuffer(device, m_vertexBuffers[i], nullptr);
             vkFreeMemory(device, m_vertexBufferMemory[i], nullptr);
@@ -72,48 +81,68 @@ namespace JoeEngine {
         m_vertexPointLists.push_back(std::vector<JEMeshPointVertex>());
         m_indexLists.push_back(std::vector<uint32_t>());
         m_boundingBoxes.push_back(BoundingBoxData());
+        m_boundingSpheres.push_back({ glm::vec3(0.0f), 0.0f });
+        m_lodChains.push_back(std::vector<JEMeshLod>());
     }
 
-    void JEMeshBufferManager::ComputeMeshBounds(const std::vector<JEMeshVertex>& vertices, uint32_t bufferId) {
-        glm::vec3 minPos = glm::vec3(FLT_MAX);
-        glm::vec3 maxPos = glm::vec3(-FLT_MAX);
-
-        for (const JEMeshVertex& vertex : vertices) {
-            minPos = glm::vec3(std::min(minPos.x, vertex.pos.x), std::min(minPos.y, vertex.pos.y), std::min(minPos.z, vertex.pos.z));
-            maxPos = glm::vec3(std::max(maxPos.x, vertex.pos.x), std::max(maxPos.y, vertex.pos.y), std::max(maxPos.z, vertex.pos.z));
+    // Bounding box of the vertex positions, and a bounding sphere centered on the box
+    template <typename VertexType>
+    static void ComputeBounds(const std::vector<VertexType>& vertices, BoundingBoxData& boundingBox, BoundingSphereData& boundingSphere) {
+        if (vertices.size() == 0) {
+            return;
         }
 
-        if (vertices.size() > 0) {
-            m_boundingBoxes[bufferId][0] = minPos;
-            m_boundingBoxes[bufferId][1] = glm::vec3(minPos.x, minPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][2] = glm::vec3(minPos.x, maxPos.y, minPos.z);
-            m_boundingBoxes[bufferId][3] = glm::vec3(minPos.x, maxPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][4] = glm::vec3(maxPos.x, minPos.y, minPos.z);
-            m_boundingBoxes[bufferId][5] = glm::vec3(maxPos.x, minPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][6] = glm::vec3(maxPos.x, maxPos.y, minPos.z);
-            m_boundingBoxes[bufferId][7] = maxPos;
-        }
+        // Extents of the vertex positions, as (min, max)
+        using Extents = std::array<glm::vec3, 2>;
+        const Extents emptyExtents = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+        const Extents extents = ParallelUtils::ParallelReduce(0, (uint32_t)vertices.size(), 0, emptyExtents,
+            [&](uint32_t begin, uint32_t end) {
+                Extents rangeExtents = emptyExtents;
+                for (uint32_t i = begin; i < end; ++i) {
+                    rangeExtents[0] = glm::min(rangeExtents[0], vertices[i].pos);
+                    rangeExtents[1] = glm::max(rangeExtents[1], vertices[i].pos);
+                }
+                return rangeExtents;
+            },
+            [](const Extents& a, const Extents& b) {
+                return Extents { glm::min(a[0], b[0]), glm::max(a[1], b[1]) };
+            });
+        const glm::vec3 minPos = extents[0];
+        const glm::vec3 maxPos = extents[1];
+
+        boundingBox[0] = minPos;
+        boundingBox[1] = glm::vec3(minPos.x, minPos.y, maxPos.z);
+        boundingBox[2] = glm::vec3(minPos.x, maxPos.y, minPos.z);
+        boundingBox[3] = glm::vec3(minPos.x, maxPos.y, maxPos.z);
+        boundingBox[4] = glm::vec3(maxPos.x, minPos.y, minPos.z);
+        boundingBox[5] = glm::vec3(maxPos.x, minPos.y, maxPos.z);
+        boundingBox[6] = glm::vec3(maxPos.x, maxPos.y, minPos.z);
+        boundingBox[7] = maxPos;
+
+        // The farthest vertex from the box center bounds the mesh more tightly than the box's corners
+        const glm::vec3 center = (minPos + maxPos) * 0.5f;
+        const float maxDist2 = ParallelUtils::ParallelReduce(0, (uint32_t)vertices.size(), 0, 0.0f,
+            [&](uint32_t begin, uint32_t end) {
+                float rangeMaxDist2 = 0.0f;
+                for (uint32_t i = begin; i < end; ++i) {
+                    const glm::vec3 offset = vertices[i].pos - center;
+                    rangeMaxDist2 = std::max(rangeMaxDist2, glm::dot(offset, offset));
+                }
+                return rangeMaxDist2;
+            },
+            [](float a, float b) {
+                return std::max(a, b);
+            });
+        boundingSphere.center = center;
+        boundingSphere.radius = std::sqrt(maxDist2);
     }
 
-    void JEMeshBufferManager::ComputeMeshBounds(const std::vector<JEMeshPointVertex>& vertices, uint32_t bufferId) {
-        glm::vec3 minPos = glm::vec3(FLT_MAX);
-        glm::vec3 maxPos = glm::vec3(-FLT_MAX);
-
-        for (const JEMeshPointVertex& vertex : vertices) {
-            minPos = glm::vec3(std::min(minPos.x, vertex.pos.x), std::min(minPos.y, vertex.pos.y), std::min(minPos.z, vertex.pos.z));
-            maxPos = glm::vec3(std::max(maxPos.x, vertex.pos.x), std::max(maxPos.y, vertex.pos.y), std::max(maxPos.z, vertex.pos.z));
-        }
+    void JEMeshBufferManager::ComputeMeshBounds(const std::vector<JEMeshVertex>& vertices, uint32_t bufferId) {
+        ComputeBounds(vertices, m_boundingBoxes[bufferId], m_boundingSpheres[bufferId]);
+    }
 
-        if (vertices.size() > 0) {
-            m_boundingBoxes[bufferId][0] = minPos;
-            m_boundingBoxes[bufferId][1] = glm::vec3(minPos.x, minPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][2] = glm::vec3(minPos.x, maxPos.y, minPos.z);
-            m_boundingBoxes[bufferId][3] = glm::vec3(minPos.x, maxPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][4] = glm::vec3(maxPos.x, minPos.y, minPos.z);
-            m_boundingBoxes[bufferId][5] = glm::vec3(maxPos.x, minPos.y, maxPos.z);
-            m_boundingBoxes[bufferId][6] = glm::vec3(maxPos.x, maxPos.y, minPos.z);
-            m_boundingBoxes[bufferId][7] = maxPos;
-        }
+    void JEMeshBufferManager::ComputeMeshBounds(const std::vector<JEMeshPointVertex>& vertices, uint32_t bufferId) {
+        ComputeBounds(vertices, m_boundingBoxes[bufferId], m_boundingSpheres[bufferId]);
     }
 
     MeshComponent JEMeshBufferManager::CreateMeshComponent(const std::string& filepath) {
@@ -145,6 +174,59 @@ namespace JoeEngine {
         return MeshComponent((int)(m_numBuffers++), MESH_POINTS);
     }
 
+    void JEMeshBufferManager::GenerateLodChain(int bufferId, uint32_t maxNumLods) {
+        // Copy the full-detail mesh, as creating the LODs' buffers grows the member lists
+        const std::vector<JEMeshVertex> vertices = m_vertexLists[bufferId];
+        std::vector<uint32_t> indices = m_indexLists[bufferId];
+
+        for (uint32_t i = 0; i < maxNumLods; ++i) {
+            uint32_t targetIndexCount = (uint32_t)(indices.size() * JE_MESH_LOD_REDUCTION);
+            targetIndexCount -= targetIndexCount % 3;
+            if (targetIndexCount < JE_MESH_LOD_MIN_INDICES) {
+                break;
+            }
+
+            // Each LOD is simplified from the previous one, so its error relative to the full-detail mesh is bounded by the sum
+            // of the errors along the chain
+            float error = 0.0f;
+            std::vector<uint32_t> lodIndices = MeshSimplificationUtils::SimplifyMesh(vertices, indices, targetIndexCount, &error);
+            if (lodIndices.size() > indices.size() * 9 / 10) {
+                // Not simplifying any further, e.g. because of the mesh's topology
+                break;
+            }
+            indices.swap(lodIndices);
+
+            // Only keep the vertices the LOD still references
+            std::vector<uint32_t> remap(vertices.size(), ~0u);
+            std::vector<JEMeshVertex> lodVertices;
+            std::vector<uint32_t> remappedIndices(indices.size());
+            for (uint32_t j = 0; j < indices.size(); ++j) {
+                uint32_t& newIndex = remap[indices[j]];
+                if (newIndex == ~0u) {
+                    newIndex = (uint32_t)lodVertices.size();
+                    lodVertices.push_back(vertices[indices[j]]);
+                }
+                remappedIndices[j] = newIndex;
+            }
+
+            const float previousError = m_lodChains[bufferId].empty() ? 0.0f : m_lodChains[bufferId].back().geometricError;
+            AddLod(bufferId, lodVertices, remappedIndices, previousError + error);
+        }
+    }
+
+    int JEMeshBufferManager::AddLod(int bufferId, const std::vector<JEMeshVertex>& vertices, const std::vector<uint32_t>& indices,
+                                    float geometricError) {
+        const int lodBufferId = CreateMeshComponent(vertices, indices).GetVertexHandle();
+
+        // Keep the chain ordered from finest to coarsest
+        std::vector<JEMeshLod>& chain = m_lodChains[bufferId];
+        const JEMeshLod lod = { lodBufferId, geometricError };
+        chain.insert(std::upper_bound(chain.begin(), chain.end(), lod,
+                                      [](const JEMeshLod& a, const JEMeshLod& b) { return a.geometricError < b.geometricError; }),
+                     lod);
+        return lodBufferId;
+    }
+
     void JEMeshBufferManager::LoadModelFromFile(const std::string& filepath) {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
@@ -209,6 +291,12 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::UpdateMeshBuffer(uint32_t bufferId, const std::vector<JEMeshVertex>& vertices, const std::vector<uint32_t>& indices) {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - only the CPU-side bounds need updating
+            ComputeMeshBounds(m_vertexLists[bufferId], bufferId);
+            return;
+        }
+
         VkDeviceSize bufferSize = sizeof(JEMeshVertex) * vertices.size();
         //VkBuffer stagingBuffer;
         //VkDeviceMemory stagingBufferMemory;
@@ -227,6 +315,12 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::UpdateMeshBuffer(uint32_t bufferId, const std::vector<JEMeshPointVertex>& vertices, const std::vector<uint32_t>& indices) {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - only the CPU-side bounds need updating
+            ComputeMeshBounds(m_vertexLists[bufferId], bufferId);
+            return;
+        }
+
         VkDeviceSize bufferSize = sizeof(JEMeshPointVertex) * vertices.size();
         //VkBuffer stagingBuffer;
         //VkDeviceMemory stagingBufferMemory;
@@ -245,6 +339,13 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::CreateVertexBuffer(const std::vector<JEMeshVertex>& vertices, VkBuffer* vertexBuffer, VkDeviceMemory* vertexBufferMemory) {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - keep the CPU-side lists only
+            *vertexBuffer = VK_NULL_HANDLE;
+            *vertexBufferMemory = VK_NULL_HANDLE;
+            return;
+        }
+
         VkDeviceSize bufferSize = sizeof(JEMeshVertex) * vertices.size();
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
@@ -263,6 +364,13 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::CreateVertexBuffer(const std::vector<JEMeshPointVertex>& vertices, VkBuffer* vertexBuffer, VkDeviceMemory* vertexBufferMemory) {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - keep the CPU-side lists only
+            *vertexBuffer = VK_NULL_HANDLE;
+            *vertexBufferMemory = VK_NULL_HANDLE;
+            return;
+        }
+
         VkDeviceSize bufferSize = sizeof(JEMeshPointVertex) * vertices.size();
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
@@ -281,6 +389,13 @@ namespace JoeEngine {
     }
 
     void JEMeshBufferManager::CreateIndexBuffer(const std::vector<uint32_t>& indices, VkBuffer* indexBuffer, VkDeviceMemory* indexBufferMemory) {
+        if (device == VK_NULL_HANDLE) {
+            // Headless - keep the CPU-side lists only
+            *indexBuffer = VK_NULL_HANDLE;
+            *indexBufferMemory = VK_NULL_HANDLE;
+            return;
+        }
+
         VkDeviceSize bufferSize = sizeof(uint32_t) * indices.size();
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
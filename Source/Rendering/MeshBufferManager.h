@@ -16,6 +16,24 @@ namespace JoeEngine {
     //! Typedef for bounding box data - a bounding box is a list of 8 3D points (corners of the box).
     using BoundingBoxData = std::array<glm::vec3, 8>;
 
+    //! Bounding sphere data.
+    typedef struct je_bounding_sphere_data_t {
+        //! Sphere center in mesh space.
+        glm::vec3 center;
+
+        //! Sphere radius.
+        float radius;
+    } BoundingSphereData;
+
+    //! Mesh level of detail.
+    typedef struct je_mesh_lod_t {
+        //! ID of the mesh buffer holding the LOD's geometry.
+        int bufferId;
+
+        //! Largest distance between the LOD's surface and the full-detail surface, in mesh units.
+        float geometricError;
+    } JEMeshLod;
+
     //! The JEMeshBufferManager
     /*!
       Class that manages all mesh buffer data, from loading to access.
@@ -48,6 +66,13 @@ namespace JoeEngine {
         //! List of mesh bounding boxes.
         std::vector<BoundingBoxData> m_boundingBoxes;
 
+        //! List of mesh bounding spheres.
+        std::vector<BoundingSphereData> m_boundingSpheres;
+
+        //! List of mesh LOD chains. Each chain lists the mesh's coarser LODs from finest to coarsest and is empty for meshes
+        //! without LODs (and for the LODs themselves).
+        std::vector<std::vector<JEMeshLod>> m_lodChains;
+
         //! Number of buffers currently being stored.
         uint16_t m_numBuffers; // TODO: make more intelligent w/ free list for when mesh data is no longer used
 
@@ -101,14 +126,14 @@ namespace JoeEngine {
         */
         void CreateIndexBuffer(const std::vector<uint32_t>& indices, VkBuffer* indexBuffer, VkDeviceMemory* indexBufferMemory);
 
-        //! Computes the bounding box data for a triangle mesh.
+        //! Computes the bounding box and bounding sphere data for a triangle mesh.
         /*!
           \param vertices the list of triangle mesh vertiex.
           \param bufferId the ID of the mesh buffer to compute bounding box data for.
         */
         void ComputeMeshBounds(const std::vector<JEMeshVertex>& vertices, uint32_t bufferId);
         
-        //! Computes the bounding box data for a point mesh.
+        //! Computes the bounding box and bounding sphere data for a point mesh.
         /*!
           \param vertices the list of point mesh vertiex.
           \param bufferId the ID of the mesh buffer to compute bounding box data for.
@@ -126,6 +151,8 @@ namespace JoeEngine {
             m_vertexLists.reserve(128);
             m_indexLists.reserve(128);
             m_boundingBoxes.reserve(128);
+            m_boundingSpheres.reserve(128);
+            m_lodChains.reserve(128);
         }
 
         //! Destructor (default).
@@ -167,6 +194,53 @@ namespace JoeEngine {
         */
         MeshComponent CreateMeshComponent(const std::vector<JEMeshPointVertex>& vertices, const std::vector<uint32_t>& indices);
 
+        //! Generate a chain of LODs for a triangle mesh.
+        /*!
+          Each LOD is simplified from the previous one (see MeshSimplificationUtils::SimplifyMesh) to JE_MESH_LOD_REDUCTION of its
+          triangles, and is stored in a mesh buffer of its own. Generation stops early once the mesh does not simplify any further
+          or would drop below JE_MESH_LOD_MIN_INDICES indices.
+          \param bufferId the ID of the full-detail mesh buffer.
+          \param maxNumLods the maximum number of LODs to generate, not counting the full-detail mesh.
+        */
+        void GenerateLodChain(int bufferId, uint32_t maxNumLods);
+
+        //! Add an LOD to a triangle mesh.
+        /*!
+          \param bufferId the ID of the full-detail mesh buffer.
+          \param vertices the LOD's triangle mesh vertices.
+          \param indices the LOD's mesh indices.
+          \param geometricError the largest distance between the LOD's surface and the full-detail surface, in mesh units.
+          \return the ID of the LOD's mesh buffer.
+        */
+        int AddLod(int bufferId, const std::vector<JEMeshVertex>& vertices, const std::vector<uint32_t>& indices, float geometricError);
+
+        //! Select the LOD to draw a mesh with.
+        /*!
+          Selects the coarsest LOD whose geometric error projects to at most JE_LOD_MAX_SCREEN_SPACE_ERROR pixels.
+          \param bufferId the ID of the full-detail mesh buffer.
+          \param pixelsPerUnit the number of pixels one mesh unit covers on screen at the mesh's closest point to the camera.
+          \return the ID of the mesh buffer to draw, which is 'bufferId' itself if no LOD is coarse enough.
+        */
+        int SelectLod(int bufferId, float pixelsPerUnit) const {
+            int selected = bufferId;
+            for (const JEMeshLod& lod : m_lodChains[bufferId]) {
+                if (lod.geometricError * pixelsPerUnit > JE_LOD_MAX_SCREEN_SPACE_ERROR) {
+                    break;
+                }
+                selected = lod.bufferId;
+            }
+            return selected;
+        }
+
+        //! Get the LOD chain of a mesh.
+        /*!
+          \param bufferId the ID of the full-detail mesh buffer.
+          \return the mesh's LODs, from finest to coarsest, not including the full-detail mesh.
+        */
+        const std::vector<JEMeshLod>& GetLodChain(int bufferId) const {
+            return m_lodChains[bufferId];
+        }
+
         //! Update a mesh buffer to a new list of vertices and indices.
         /*!
           \param bufferId the ID of the mesh buffer to update.
@@ -211,6 +285,16 @@ namespace JoeEngine {
             return m_indexBuffers[index];
         }
 
+        //! Get vertex list at index.
+        /*!
+          Returns the triangle mesh vertex list corresponding to the given index / mesh buffer ID.
+          \param index the mesh ID whose vertex list to return.
+          \return the vertex list corresponding to the index.
+        */
+        const std::vector<JEMeshVertex>& GetVertexListAt(int index) const {
+            return m_vertexLists[index];
+        }
+
         //! Get index list at index.
         /*!
           Returns the index list corresponding to the given index / mesh buffer ID.
@@ -234,6 +318,15 @@ namespace JoeEngine {
             return m_boundingBoxes;
         }
 
+        //! Get all bounding sphere data.
+        /*!
+          Returns the member list of all bounding sphere data, parallel to the bounding box data.
+          \return const-reference to the list of all bounding sphere data.
+        */
+        const std::vector<BoundingSphereData>& GetBoundingSphereData() const {
+            return m_boundingSpheres;
+        }
+
         //! Get the single-instance screen-space triangle mesh struct data.
         const JESingleMesh& GetScreenSpaceTriMesh() const {
             return m_screenSpaceTriangle;
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+#include "MeshSimplification.h"
+#include "../Utils/ParallelFor.h"
+
+namespace JoeEngine {
+    namespace MeshSimplificationUtils {
+        //! Weight of the planes that keep open borders in place, relative to the surface planes.
+        static constexpr double BORDER_WEIGHT = 10.0;
+
+        //! Symmetric quadric: the error of a point p is p^T A p + 2 b^T p + c.
+        typedef struct quadric_t {
+            double a00, a01, a02, a11, a12, a22;
+            double b0, b1, b2;
+            double c;
+
+            //! Sum of the weights of the planes added to the quadric.
+            double weight;
+        } Quadric;
+
+        //! Candidate edge collapse.
+        typedef struct collapse_t {
+            //! Quadric error of the collapse.
+            double cost;
+
+            //! The welded vertex that is removed.
+            uint32_t from;
+
+            //! The welded vertex it is moved onto.
+            uint32_t to;
+
+            //! Versions of both vertices when the cost was computed. The collapse is stale if either vertex changed since.
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            bool operator>(const collapse_t& other) const {
+                return cost > other.cost;
+            }
+        } Collapse;
+
+        static void AddPlane(Quadric& q, const double n[3], double d, double weight) {
+            q.a00 += weight * n[0] * n[0];
+            q.a01 += weight * n[0] * n[1];
+            q.a02 += weight * n[0] * n[2];
+            q.a11 += weight * n[1] * n[1];
+            q.a12 += weight * n[1] * n[2];
+            q.a22 += weight * n[2] * n[2];
+            q.b0 += weight * n[0] * d;
+            q.b1 += weight * n[1] * d;
+            q.b2 += weight * n[2] * d;
+            q.c += weight * d * d;
+            q.weight += weight;
+        }
+
+        static void AddQuadric(Quadric& q, const Quadric& r) {
+            q.a00 += r.a00;
+            q.a01 += r.a01;
+            q.a02 += r.a02;
+            q.a11 += r.a11;
+            q.a12 += r.a12;
+            q.a22 += r.a22;
+            q.b0 += r.b0;
+            q.b1 += r.b1;
+            q.b2 += r.b2;
+            q.c += r.c;
+            q.weight += r.weight;
+        }
+
+        static double Evaluate(const Quadric& q, const double p[3]) {
+            const double x = p[0];
+            const double y = p[1];
+            const double z = p[2];
+            return q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+                   2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+        }
+
+        static void Sub(const double a[3], const double b[3], double out[3]) {
+            out[0] = a[0] - b[0];
+            out[1] = a[1] - b[1];
+            out[2] = a[2] - b[2];
+        }
+
+        static void Cross(const double a[3], const double b[3], double out[3]) {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        static double Dot(const double a[3], const double b[3]) {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        // Unnormalized normal of the triangle (p0, p1, p2)
+        static void TriangleNormal(const double* p0, const double* p1, const double* p2, double out[3]) {
+            double e1[3];
+            double e2[3];
+            Sub(p1, p0, e1);
+            Sub(p2, p0, e2);
+            Cross(e1, e2, out);
+        }
+
+        std::vector<uint32_t> SimplifyMesh(const std::vector<JEMeshVertex>& vertices, const std::vector<uint32_t>& indices,
+                                           uint32_t targetIndexCount, float* resultError) {
+            *resultError = 0.0f;
+            if (targetIndexCount >= indices.size() || vertices.empty()) {
+                return indices;
+            }
+
+            // Weld vertices with equal positions, e.g. the copies along UV seams. Vertices of each welded position are
+            // contiguous in 'sortedVertices', starting at 'weldStarts'.
+            const uint32_t numVertices = (uint32_t)vertices.size();
+            std::vector<uint32_t> sortedVertices(numVertices);
+            std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+            std::sort(sortedVertices.begin(), sortedVertices.end(), [&vertices](uint32_t a, uint32_t b) {
+                const glm::vec3& pa = vertices[a].pos;
+                const glm::vec3& pb = vertices[b].pos;
+                if (pa.x != pb.x) {
+                    return pa.x < pb.x;
+                }
+                if (pa.y != pb.y) {
+                    return pa.y < pb.y;
+                }
+                return pa.z < pb.z;
+            });
+
+            std::vector<uint32_t> weldIds(numVertices);
+            std::vector<uint32_t> weldStarts;
+            std::vector<double> positions;
+            for (uint32_t i = 0; i < numVertices; ++i) {
+                const glm::vec3& pos = vertices[sortedVertices[i]].pos;
+                if (i == 0 || !(pos == vertices[sortedVertices[i - 1]].pos)) {
+                    weldStarts.push_back(i);
+                    positions.push_back(pos.x);
+                    positions.push_back(pos.y);
+                    positions.push_back(pos.z);
+                }
+                weldIds[sortedVertices[i]] = (uint32_t)weldStarts.size() - 1;
+            }
+            const uint32_t numWelded = (uint32_t)weldStarts.size();
+            weldStarts.push_back(numVertices);
+
+            // Welded triangles, and the triangles around each welded vertex
+            const uint32_t numTriangles = (uint32_t)indices.size() / 3;
+            std::vector<uint32_t> triangles(numTriangles * 3);
+            std::vector<uint8_t> triangleAlive(numTriangles);
+            std::vector<std::vector<uint32_t>> vertexTriangles(numWelded);
+            uint32_t numAlive = 0;
+            for (uint32_t t = 0; t < numTriangles; ++t) {
+                const uint32_t v0 = weldIds[indices[3 * t + 0]];
+                const uint32_t v1 = weldIds[indices[3 * t + 1]];
+                const uint32_t v2 = weldIds[indices[3 * t + 2]];
+                triangles[3 * t + 0] = v0;
+                triangles[3 * t + 1] = v1;
+                triangles[3 * t + 2] = v2;
+                triangleAlive[t] = v0 != v1 && v1 != v2 && v0 != v2;
+                if (triangleAlive[t]) {
+                    ++numAlive;
+                    vertexTriangles[v0].push_back(t);
+                    vertexTriangles[v1].push_back(t);
+                    vertexTriangles[v2].push_back(t);
+                }
+            }
+
+            const auto position = [&positions](uint32_t v) {
+                return &positions[3 * v];
+            };
+
+            // Area-weighted plane quadrics of the triangles around each vertex
+            std::vector<Quadric> quadrics(numWelded, Quadric {});
+            std::vector<uint64_t> edges;
+            edges.reserve(numAlive * 3);
+            for (uint32_t t = 0; t < numTriangles; ++t) {
+                if (!triangleAlive[t]) {
+                    continue;
+                }
+
+                double normal[3];
+                TriangleNormal(position(triangles[3 * t]), position(triangles[3 * t + 1]), position(triangles[3 * t + 2]), normal);
+                const double length = std::sqrt(Dot(normal, normal));
+                if (length > 0.0) {
+                    normal[0] /= length;
+                    normal[1] /= length;
+                    normal[2] /= length;
+                    const double d = -Dot(normal, position(triangles[3 * t]));
+                    for (uint32_t k = 0; k < 3; ++k) {
+                        AddPlane(quadrics[triangles[3 * t + k]], normal, d, length * 0.5);
+                    }
+                }
+
+                for (uint32_t k = 0; k < 3; ++k) {
+                    const uint32_t a = triangles[3 * t + k];
+                    const uint32_t b = triangles[3 * t + (k + 1) % 3];
+                    edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+                }
+            }
+
+            // Open border edges belong to a single triangle. Keep them in place with a plane through the edge, perpendicular
+            // to the triangle.
+            std::sort(edges.begin(), edges.end());
+            for (size_t i = 0; i < edges.size();) {
+                size_t j = i + 1;
+                while (j < edges.size() && edges[j] == edges[i]) {
+                    ++j;
+                }
+
+                if (j - i == 1) {
+                    const uint32_t a = (uint32_t)(edges[i] >> 32);
+                    const uint32_t b = (uint32_t)edges[i];
+                    for (uint32_t t : vertexTriangles[a]) {
+                        const uint32_t* tri = &triangles[3 * t];
+                        if (tri[0] != b && tri[1] != b && tri[2] != b) {
+                            continue;
+                        }
+
+                        double normal[3];
+                        double edge[3];
+                        double borderNormal[3];
+                        TriangleNormal(position(tri[0]), position(tri[1]), position(tri[2]), normal);
+                        Sub(position(b), position(a), edge);
+                        Cross(edge, normal, borderNormal);
+                        const double length = std::sqrt(Dot(borderNormal, borderNormal));
+                        if (length > 0.0) {
+                            borderNormal[0] /= length;
+                            borderNormal[1] /= length;
+                            borderNormal[2] /= length;
+                            const double d = -Dot(borderNormal, position(a));
+                            const double weight = Dot(edge, edge) * BORDER_WEIGHT;
+                            AddPlane(quadrics[a], borderNormal, d, weight);
+                            AddPlane(quadrics[b], borderNormal, d, weight);
+                        }
+                        break;
+                    }
+                }
+                i = j;
+            }
+
+            // Candidate collapses of both directions of every edge, cheapest first
+            std::vector<uint32_t> versions(numWelded, 0);
+            std::vector<uint8_t> removed(numWelded, 0);
+            const auto makeCollapse = [&](uint32_t from, uint32_t to) {
+                Quadric q = quadrics[from];
+                AddQuadric(q, quadrics[to]);
+                const double cost = std::max(Evaluate(q, position(to)), 0.0) / std::max(q.weight, 1e-30);
+                return Collapse { cost, from, to, versions[from], versions[to] };
+            };
+
+            // The initial costs are independent, so evaluate them in parallel and heapify them at once
+            std::vector<Collapse> initialCollapses(edges.size() * 2);
+            ParallelUtils::ParallelFor(0, (uint32_t)edges.size(), 0, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t e = begin; e < end; ++e) {
+                    initialCollapses[2 * e + 0] = makeCollapse((uint32_t)(edges[e] >> 32), (uint32_t)edges[e]);
+                    initialCollapses[2 * e + 1] = makeCollapse((uint32_t)edges[e], (uint32_t)(edges[e] >> 32));
+                }
+            });
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses(std::greater<Collapse>(),
+                                                                                                   std::move(initialCollapses));
+            const auto pushCollapse = [&](uint32_t from, uint32_t to) {
+                collapses.push(makeCollapse(from, to));
+            };
+
+            std::vector<uint32_t> fromNeighbors;
+            std::vector<uint32_t> toNeighbors;
+            const auto collectNeighbors = [&](uint32_t v, std::vector<uint32_t>& neighbors) {
+                neighbors.clear();
+                for (uint32_t t : vertexTriangles[v]) {
+                    if (triangleAlive[t]) {
+                        for (uint32_t k = 0; k < 3; ++k) {
+                            if (triangles[3 * t + k] != v) {
+                                neighbors.push_back(triangles[3 * t + k]);
+                            }
+                        }
+                    }
+                }
+                std::sort(neighbors.begin(), neighbors.end());
+                neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            };
+
+            const auto canCollapse = [&](uint32_t from, uint32_t to) {
+                // The vertices shared by both one-rings must be exactly the ones opposite the edge, otherwise the collapse
+                // would make the mesh non-manifold
+                uint32_t numShared = 0;
+                for (uint32_t t : vertexTriangles[from]) {
+                    const uint32_t* tri = &triangles[3 * t];
+                    if (triangleAlive[t] && (tri[0] == to || tri[1] == to || tri[2] == to)) {
+                        ++numShared;
+                    }
+                }
+                if (numShared == 0) {
+                    return false;
+                }
+
+                collectNeighbors(from, fromNeighbors);
+                collectNeighbors(to, toNeighbors);
+                uint32_t numCommon = 0;
+                for (uint32_t i = 0, j = 0; i < fromNeighbors.size() && j < toNeighbors.size();) {
+                    if (fromNeighbors[i] < toNeighbors[j]) {
+                        ++i;
+                    } else if (fromNeighbors[i] > toNeighbors[j]) {
+                        ++j;
+                    } else {
+                        ++numCommon;
+                        ++i;
+                        ++j;
+                    }
+                }
+                if (numCommon > numShared) {
+                    return false;
+                }
+
+                // No remaining triangle may flip over
+                for (uint32_t t : vertexTriangles[from]) {
+                    const uint32_t* tri = &triangles[3 * t];
+                    if (!triangleAlive[t] || tri[0] == to || tri[1] == to || tri[2] == to) {
+                        continue;
+                    }
+
+                    const double* p[3];
+                    const double* q[3];
+                    for (uint32_t k = 0; k < 3; ++k) {
+                        p[k] = position(tri[k]);
+                        q[k] = tri[k] == from ? position(to) : p[k];
+                    }
+                    double oldNormal[3];
+                    double newNormal[3];
+                    TriangleNormal(p[0], p[1], p[2], oldNormal);
+                    TriangleNormal(q[0], q[1], q[2], newNormal);
+                    if (Dot(oldNormal, newNormal) <= 0.0) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            double maxCost = 0.0;
+            while (numAlive * 3 > targetIndexCount && !collapses.empty()) {
+                const Collapse collapse = collapses.top();
+                collapses.pop();
+
+                const uint32_t from = collapse.from;
+                const uint32_t to = collapse.to;
+                if (removed[from] || removed[to] || collapse.fromVersion != versions[from] || collapse.toVersion != versions[to] ||
+                    !canCollapse(from, to)) {
+                    continue;
+                }
+
+                // Move 'from' onto 'to': the triangles on the edge disappear, the others are reattached to 'to'
+                for (uint32_t t : vertexTriangles[from]) {
+                    if (!triangleAlive[t]) {
+                        continue;
+                    }
+
+                    uint32_t* tri = &triangles[3 * t];
+                    if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                        triangleAlive[t] = 0;
+                        --numAlive;
+                    } else {
+                        for (uint32_t k = 0; k < 3; ++k) {
+                            if (tri[k] == from) {
+                                tri[k] = to;
+                            }
+                        }
+                        vertexTriangles[to].push_back(t);
+                    }
+                }
+                vertexTriangles[from].clear();
+                AddQuadric(quadrics[to], quadrics[from]);
+                removed[from] = 1;
+                ++versions[to];
+                maxCost = std::max(maxCost, collapse.cost);
+
+                // Drop dead triangles from the vertex, then re-queue the collapses of its edges with the merged quadric
+                std::vector<uint32_t>& toTriangles = vertexTriangles[to];
+                toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+                                                 [&triangleAlive](uint32_t t) { return !triangleAlive[t]; }),
+                                  toTriangles.end());
+                collectNeighbors(to, toNeighbors);
+                for (uint32_t neighbor : toNeighbors) {
+                    pushCollapse(to, neighbor);
+                    pushCollapse(neighbor, to);
+                }
+            }
+            *resultError = (float)std::sqrt(maxCost);
+
+            // Map each corner back to a vertex at its (possibly new) welded position: the original vertex if it was not moved,
+            // otherwise the vertex there with the closest normal and UV
+            std::vector<uint32_t> result;
+            result.reserve(numAlive * 3);
+            for (uint32_t t = 0; t < numTriangles; ++t) {
+                if (!triangleAlive[t]) {
+                    continue;
+                }
+
+                for (uint32_t k = 0; k < 3; ++k) {
+                    const uint32_t original = indices[3 * t + k];
+                    const uint32_t welded = triangles[3 * t + k];
+                    if (weldIds[original] == welded) {
+                        result.push_back(original);
+                        continue;
+                    }
+
+                    const JEMeshVertex& originalVertex = vertices[original];
+                    uint32_t best = sortedVertices[weldStarts[welded]];
+                    float bestDistance = FLT_MAX;
+                    for (uint32_t i = weldStarts[welded]; i < weldStarts[welded + 1]; ++i) {
+                        const JEMeshVertex& candidate = vertices[sortedVertices[i]];
+                        const glm::vec3 normalOffset = candidate.normal - originalVertex.normal;
+                        const glm::vec2 uvOffset = candidate.uv - originalVertex.uv;
+                        const float distance = glm::dot(normalOffset, normalOffset) + glm::dot(uvOffset, uvOffset);
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = sortedVertices[i];
+                        }
+                    }
+                    result.push_back(best);
+                }
+            }
+            return result;
+        }
+    }
+}
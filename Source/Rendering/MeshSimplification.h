@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "VulkanRenderingTypes.h"
+
+namespace JoeEngine {
+    namespace MeshSimplificationUtils {
+        //! Simplify a triangle mesh.
+        /*!
+          Quadric error metric simplification (Garland and Heckbert): vertices sharing a position are welded, each welded
+          vertex accumulates the area-weighted plane quadrics of its triangles (plus perpendicular planes along open borders),
+          and the edge collapse that moves a vertex onto a neighbor with the lowest quadric error is applied until the target
+          is reached. Collapses that would flip a triangle or make the mesh non-manifold are skipped.
+          Vertices are only ever moved onto other existing vertices, so the result indexes the input vertex list. Where a welded
+          position has several vertices (e.g. along a UV seam), each triangle corner keeps the one with the closest attributes.
+          \param vertices the triangle mesh vertices.
+          \param indices the triangle mesh indices, three per triangle.
+          \param targetIndexCount the number of indices to simplify down to. The result may be larger if no further collapses
+          are possible.
+          \param resultError output for the simplified mesh's error: the square root of the largest applied collapse's quadric
+          error, approximately the largest distance between the simplified and the original surface, in mesh units.
+          \return the indices of the simplified mesh.
+        */
+        std::vector<uint32_t> SimplifyMesh(const std::vector<JEMeshVertex>& vertices, const std::vector<uint32_t>& indices,
+                                           uint32_t targetIndexCount, float* resultError);
+    }
+}
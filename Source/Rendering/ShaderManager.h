@@ -176,13 +176,13 @@ namespace JoeEngine {
           \param device the Vulkan logical device.
           \param descriptorID the ID of the descriptor object to update.
           \param imageIndex the currently active swap chain image index.
-          \param buffers list of uniform data buffers
-          \param bufferSizes list of uniform data buffer sizes
-          \param ssboBuffers list of shader storage data buffers
-          \param ssboSizes list of shader storage data buffer sizes
+          \param buffers array of uniform data buffers
+          \param bufferSizes array of uniform data buffer sizes
+          \param ssboBuffers array of shader storage data buffers
+          \param ssboSizes array of shader storage data buffer sizes
         */
-        void UpdateBuffers(VkDevice device, uint32_t descriptorID, uint32_t imageIndex, const std::vector<const void*>& buffers, const std::vector<uint32_t>& bufferSizes,
-            const std::vector<const void*>& ssboBuffers, const std::vector<uint32_t>& ssboSizes) {
+        void UpdateBuffers(VkDevice device, uint32_t descriptorID, uint32_t imageIndex, const void* const* buffers, const uint32_t* bufferSizes,
+            const void* const* ssboBuffers, const uint32_t* ssboSizes) {
             if (descriptorID < 0 || descriptorID >= m_numDescriptors) {
                 // TODO: return some default/debug material
                 throw std::runtime_error("Invalid descriptor ID");
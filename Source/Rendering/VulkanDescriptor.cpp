@@ -206,8 +206,8 @@ namespace JoeEngine {
         }
     }
 
-    void JEVulkanDescriptor::UpdateDescriptorSets(VkDevice device, uint32_t imageIndex, const std::vector<const void*>& buffers, const std::vector<uint32_t>& bufferSizes,
-        const std::vector<const void*>& ssboBuffers, const std::vector<uint32_t>& ssboSizes) {
+    void JEVulkanDescriptor::UpdateDescriptorSets(VkDevice device, uint32_t imageIndex, const void* const* buffers, const uint32_t* bufferSizes,
+        const void* const* ssboBuffers, const uint32_t* ssboSizes) {
 
         // Uniform buffers
         for (uint32_t i = 0; i < m_uniformBuffers.size(); ++i) {
@@ -132,12 +132,13 @@ namespace JoeEngine {
           Updates all descriptor set uniform and shader storage memory buffers to the data provided.
           \param device the Vulkan logical device.
           \param imageIndex the currently active swap chain image index.
-          \param buffers list of new uniform buffer data to copy to the GPU.
+          Takes plain arrays, one element per uniform buffer/SSBO of this descriptor, so that per-frame callers can pass stack arrays.
+          \param buffers array of new uniform buffer data to copy to the GPU (may be nullptr if there are no uniform buffers).
           \param bufferSizes size of each element in the parameter 'buffers'.
-          \param ssboBuffers list of new shader storage buffer data to copy to the GPU.
+          \param ssboBuffers array of new shader storage buffer data to copy to the GPU (may be nullptr if there are no SSBOs).
           \param ssboSizes size of each element in the parameter 'ssboBuffers'.
         */
-        void UpdateDescriptorSets(VkDevice device, uint32_t imageIndex, const std::vector<const void*>& buffers, const std::vector<uint32_t>& bufferSizes,
-            const std::vector<const void*>& ssboBuffers, const std::vector<uint32_t>& ssboSizes);
+        void UpdateDescriptorSets(VkDevice device, uint32_t imageIndex, const void* const* buffers, const uint32_t* bufferSizes,
+            const void* const* ssboBuffers, const uint32_t* ssboSizes);
     };
 }
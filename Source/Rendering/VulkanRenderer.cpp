@@ -1,6 +1,7 @@
 #include <map>
 #include <vector>
 #include <iostream>
+#include <limits>
 
 #include "JoeEngineConfig.h"
 #include "../EngineInstance.h"
@@ -19,10 +20,22 @@ namespace JoeEngine {
     void JEVulkanRenderer::Initialize(RendererSettings rendererSettings, JESceneManager* sceneManager, JEEngineInstance* engineInstance) {
         m_enableDeferred = rendererSettings & RendererSettings::EnableDeferred;
         m_enableOIT = rendererSettings & RendererSettings::EnableOIT;
+        m_headless = rendererSettings & RendererSettings::Headless;
+        m_pipelinedFrames = rendererSettings & RendererSettings::PipelinedFrames;
 
         m_engineInstance = engineInstance;
         m_sceneManager = sceneManager;
 
+        if (m_headless) {
+            // Null backend: no window and no Vulkan objects. Mesh data is still kept CPU-side for bounds and culling.
+            m_instance = VK_NULL_HANDLE;
+            m_physicalDevice = VK_NULL_HANDLE;
+            m_device = VK_NULL_HANDLE;
+            m_commandPool = VK_NULL_HANDLE;
+            m_meshBufferManager.Initialize(m_physicalDevice, m_device, m_commandPool, m_graphicsQueue);
+            return;
+        }
+
         // Window (GLFW)
         m_vulkanWindow.Initialize(m_width, m_height, "VulkanWindow");
 
@@ -160,9 +173,22 @@ namespace JoeEngine {
 
         // Sync objects
         CreateSemaphoresAndFences();
+        InvalidateUploadedShaderBuffers();
+    }
+
+    void JEVulkanRenderer::InvalidateUploadedShaderBuffers() {
+        m_uploadedShadowTransformsVersions.assign(m_vulkanSwapChain.GetImageViews().size(), std::numeric_limits<uint64_t>::max());
+        m_uploadedSortedTransformsVersions.assign(m_vulkanSwapChain.GetImageViews().size(), std::numeric_limits<uint64_t>::max());
+        // The number of swap chain images may have changed, so drop the material entries entirely. They grow back on demand.
+        m_uploadedMaterialUniformsVersions.clear();
     }
 
     void JEVulkanRenderer::Cleanup() {
+        if (m_headless) {
+            m_meshBufferManager.Cleanup();
+            return;
+        }
+
         CleanupWindowDependentResources();
         m_meshBufferManager.Cleanup();
         m_textureLibraryGlobal.Cleanup(m_device);
@@ -512,63 +538,86 @@ namespace JoeEngine {
     /// Renderer Functions
 
     void JEVulkanRenderer::UpdateShaderBuffers(const std::vector<MaterialComponent>& materialComponents,
-        const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted, uint32_t imageIndex) {
+        const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted,
+        uint64_t transformsVersion, uint64_t transformsSortedVersion, const JECamera& camera, const JECamera& shadowCamera,
+        uint32_t imageIndex) {
         
-        m_shaderManager.UpdateBuffers(m_device, m_shadowModelMatrixDescriptorID, imageIndex, {}, {},
-            { transforms.data() }, { (uint32_t)(transforms.size() * sizeof(glm::mat4)) });
-        m_shaderManager.UpdateBuffers(m_device, m_deferredGeometryModelMatrixDescriptorID, imageIndex, {}, {},
-            { transformsSorted.data() }, { (uint32_t)(transformsSorted.size() * sizeof(glm::mat4)) });
-        m_shaderManager.UpdateBuffers(m_device, m_forwardModelMatrixDescriptorID, imageIndex, {}, {},
-            { transformsSorted.data() }, { (uint32_t)(transformsSorted.size() * sizeof(glm::mat4)) });
+        // Model matrices only need re-uploading when this swap chain image holds an older version of the list
+        // Note: buffer lists are plain stack arrays, so none of this allocates per frame
+        if (m_uploadedShadowTransformsVersions[imageIndex] != transformsVersion) {
+            const void* ssboBuffers[] = { transforms.data() };
+            const uint32_t ssboSizes[] = { (uint32_t)(transforms.size() * sizeof(glm::mat4)) };
+            m_shaderManager.UpdateBuffers(m_device, m_shadowModelMatrixDescriptorID, imageIndex, nullptr, nullptr, ssboBuffers, ssboSizes);
+            m_uploadedShadowTransformsVersions[imageIndex] = transformsVersion;
+        }
+        if (m_uploadedSortedTransformsVersions[imageIndex] != transformsSortedVersion) {
+            const void* ssboBuffers[] = { transformsSorted.data() };
+            const uint32_t ssboSizes[] = { (uint32_t)(transformsSorted.size() * sizeof(glm::mat4)) };
+            m_shaderManager.UpdateBuffers(m_device, m_deferredGeometryModelMatrixDescriptorID, imageIndex, nullptr, nullptr, ssboBuffers, ssboSizes);
+            m_shaderManager.UpdateBuffers(m_device, m_forwardModelMatrixDescriptorID, imageIndex, nullptr, nullptr, ssboBuffers, ssboSizes);
+            m_uploadedSortedTransformsVersions[imageIndex] = transformsSortedVersion;
+        }
 
         if (m_enableOIT) {
             const std::array<uint32_t, 4> atomicCounterData = { 0, JE_NUM_OIT_FRAGSPP * m_width * m_height, m_width, 0 };
-            m_shaderManager.UpdateBuffers(m_device, m_oitLLDescriptor, imageIndex, {}, {},
-                { nullptr, nullptr, nullptr, atomicCounterData.data() },
-                { JE_NUM_OIT_FRAGSPP * m_width * m_height, JE_NUM_OIT_FRAGSPP * m_width * m_height, (uint32_t)sizeof(uint32_t) * m_width * m_height, sizeof(uint32_t) * 4 });
+            const void* ssboBuffers[] = { nullptr, nullptr, nullptr, atomicCounterData.data() };
+            const uint32_t ssboSizes[] = { JE_NUM_OIT_FRAGSPP * m_width * m_height, JE_NUM_OIT_FRAGSPP * m_width * m_height,
+                                           (uint32_t)sizeof(uint32_t) * m_width * m_height, sizeof(uint32_t) * 4 };
+            m_shaderManager.UpdateBuffers(m_device, m_oitLLDescriptor, imageIndex, nullptr, nullptr, ssboBuffers, ssboSizes);
         }
 
         if (m_enableDeferred) {
             // Add camera inv view/proj matrices as uniforms
-            //std::array<glm::mat4, 2> uniformInvViewProjData = { m_sceneManager->m_camera.GetInvProj(), m_sceneManager->m_camera.GetInvView() };
-            const std::array<glm::mat4, 2> uniformInvViewProjData = { glm::inverse(m_sceneManager->m_camera.GetProj()), glm::inverse(m_sceneManager->m_camera.GetView()) };
+            //std::array<glm::mat4, 2> uniformInvViewProjData = { camera.GetInvProj(), camera.GetInvView() };
+            const std::array<glm::mat4, 2> uniformInvViewProjData = { glm::inverse(camera.GetProj()), glm::inverse(camera.GetView()) };
 
             // Add light viewProj matrix as uniforms
-            const std::array<glm::mat4, 1> uniformLightData = { m_sceneManager->m_shadowCamera.GetOrthoViewProj() };
+            const std::array<glm::mat4, 1> uniformLightData = { shadowCamera.GetOrthoViewProj() };
 
-            std::vector<const void*> buffers;
-            std::vector<uint32_t> sizes;
-
-            buffers.push_back(uniformInvViewProjData.data());
-            buffers.push_back(uniformLightData.data());
+            const void* buffers[] = { uniformInvViewProjData.data(), uniformLightData.data() };
+            const uint32_t sizes[] = { (uint32_t)(sizeof(glm::mat4) * uniformInvViewProjData.size()),
+                                       (uint32_t)(sizeof(glm::mat4) * uniformLightData.size()) };
             //buffers.insert(buffers.end(), materialComponents[i].m_uniformData.begin(), materialComponents[i].m_uniformData.end());
-
-            sizes.push_back(sizeof(glm::mat4) * uniformInvViewProjData.size());
-            sizes.push_back(sizeof(glm::mat4) * uniformLightData.size());
             //sizes.insert(sizes.end(), materialComponents[i].m_uniformDataSizes.begin(), materialComponents[i].m_uniformDataSizes.end());
             //m_shaderManager.UpdateUniformBuffers(materialComponents[i].m_descriptorID, imageIndex, buffers, sizes);
-            m_shaderManager.UpdateBuffers(m_device, m_deferredLightingDescriptorID, imageIndex, buffers, sizes, {}, {});
+            m_shaderManager.UpdateBuffers(m_device, m_deferredLightingDescriptorID, imageIndex, buffers, sizes, nullptr, nullptr);
         }
 
-        for (uint32_t i = 0; i < materialComponents.size(); ++i) {
-            // TODO: Don't do this for every material, ignore duplicates
+        if (m_enableDeferred) {
+            // Every material's uniform data is the light viewProj matrix, so it only needs writing once per material descriptor,
+            // and only again once the matrix changed
+            const std::array<glm::mat4, 1> uniformLightData = { shadowCamera.GetOrthoViewProj() };
+            if (uniformLightData[0] != m_materialUniformsLightViewProj) {
+                m_materialUniformsLightViewProj = uniformLightData[0];
+                ++m_materialUniformsVersion;
+            }
 
-            if (m_enableDeferred) {
-                // Add light viewProj matrix as uniforms
-                const std::array<glm::mat4, 1> uniformLightData = { m_sceneManager->m_shadowCamera.GetOrthoViewProj() };
+            const void* buffers[] = { uniformLightData.data() };
+            const uint32_t sizes[] = { (uint32_t)(sizeof(glm::mat4) * uniformLightData.size()) };
+            const uint32_t numImages = (uint32_t)m_vulkanSwapChain.GetImageViews().size();
+            for (uint32_t i = 0; i < materialComponents.size(); ++i) {
+                // The list holds one material per draw, sorted by descriptor within each shader, so most lookups repeat the
+                // previous draw's descriptor
+                const uint32_t descriptorID = materialComponents[i].m_descriptorID;
+                if (i > 0 && descriptorID == materialComponents[i - 1].m_descriptorID) {
+                    continue;
+                }
 
-                std::vector<const void*> buffers;
-                std::vector<uint32_t> sizes;
+                const size_t uploadedIdx = (size_t)descriptorID * numImages + imageIndex;
+                if (uploadedIdx >= m_uploadedMaterialUniformsVersions.size()) {
+                    m_uploadedMaterialUniformsVersions.resize(((size_t)descriptorID + 1) * numImages, std::numeric_limits<uint64_t>::max());
+                }
+                if (m_uploadedMaterialUniformsVersions[uploadedIdx] == m_materialUniformsVersion) {
+                    continue;
+                }
 
-                buffers.push_back(uniformLightData.data());
                 //buffers.insert(buffers.end(), materialComponents[i].m_uniformData.begin(), materialComponents[i].m_uniformData.end());
-
-                sizes.push_back(sizeof(glm::mat4) * uniformLightData.size());
                 //sizes.insert(sizes.end(), materialComponents[i].m_uniformDataSizes.begin(), materialComponents[i].m_uniformDataSizes.end());
-                m_shaderManager.UpdateBuffers(m_device, materialComponents[i].m_descriptorID, imageIndex, buffers, sizes, {}, {});
-            } else {
-                // TODO
+                m_shaderManager.UpdateBuffers(m_device, descriptorID, imageIndex, buffers, sizes, nullptr, nullptr);
+                m_uploadedMaterialUniformsVersions[uploadedIdx] = m_materialUniformsVersion;
             }
+        } else {
+            // TODO
         }
     }
     
@@ -576,11 +625,21 @@ namespace JoeEngine {
         return m_meshBufferManager.GetBoundingBoxData();
     }
 
-    MeshComponent JEVulkanRenderer::CreateMesh(const std::string& filepath) {
-        return m_meshBufferManager.CreateMeshComponent(filepath);
+    const std::vector<BoundingSphereData>& JEVulkanRenderer::GetBoundingSphereData() const {
+        return m_meshBufferManager.GetBoundingSphereData();
+    }
+
+    MeshComponent JEVulkanRenderer::CreateMesh(const std::string& filepath, uint32_t numLods) {
+        const MeshComponent meshComponent = m_meshBufferManager.CreateMeshComponent(filepath);
+        m_meshBufferManager.GenerateLodChain(meshComponent.GetVertexHandle(), numLods);
+        return meshComponent;
     }
 
     uint32_t JEVulkanRenderer::CreateTexture(const std::string& filepath) {
+        if (m_headless) {
+            return m_headlessResourceCounter++;
+        }
+
         // TODO: specify global/level/etc
         const uint32_t textureID = m_textureLibraryGlobal.CreateTexture(m_device, m_physicalDevice, m_graphicsQueue, m_commandPool, filepath);
         return textureID;
@@ -588,6 +647,11 @@ namespace JoeEngine {
 
     void JEVulkanRenderer::CreateShader(MaterialComponent& materialComponent, const std::string& vertFilepath,
         const std::string& fragFilepath) {
+        if (m_headless) {
+            materialComponent.m_shaderID = m_headlessResourceCounter++;
+            return;
+        }
+
         VkRenderPass renderPass;
         PipelineType type;
         if (m_enableDeferred) {
@@ -639,6 +703,10 @@ namespace JoeEngine {
     }
 
     uint32_t JEVulkanRenderer::CreateDescriptor(const MaterialComponent& materialComponent) {
+        if (m_headless) {
+            return m_headlessResourceCounter++;
+        }
+
         std::vector<std::vector<VkImageView>> imageViews;
         std::vector<VkSampler> samplers;
 
@@ -837,9 +905,46 @@ namespace JoeEngine {
         }
     }
 
-    void JEVulkanRenderer::DrawMeshes(const std::vector<MeshComponent>& meshComponents,
+    void JEVulkanRenderer::DrawForwardBatches(VkCommandBuffer commandBuffer, const std::vector<MeshComponent>& meshComponents,
                                               const std::vector<MaterialComponent>& materialComponents,
-                                              const JECamera& camera, const std::vector<JEParticleSystem>& particleSystems) {
+                                              const std::vector<JEDrawBatch>& batches, uint32_t firstBatch, const JECamera& camera,
+                                              const VkViewport& viewport, const VkRect2D& scissor, bool bindOITDescriptor) {
+        // Bind each batch's shader and descriptor when they change
+        JEForwardShader* forwardShader = nullptr;
+        uint32_t currShaderID = 0;
+        uint32_t currDescriptorID = 0;
+        for (uint32_t b = firstBatch; b < batches.size(); ++b) {
+            const JEDrawBatch& batch = batches[b];
+            const MaterialComponent& material = materialComponents[batch.firstInstance];
+
+            const bool shaderChanged = forwardShader == nullptr || material.m_shaderID != currShaderID;
+            if (shaderChanged) {
+                currShaderID = material.m_shaderID;
+                forwardShader = (JEForwardShader*)m_shaderManager.GetShaderAt(currShaderID);
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, forwardShader->GetPipeline());
+                vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+                forwardShader->BindPushConstants_ViewProj(commandBuffer, camera.GetViewProj());
+                m_shaderManager.GetDescriptorAt(m_forwardModelMatrixDescriptorID).BindDescriptorSets(commandBuffer, forwardShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
+                if (bindOITDescriptor) {
+                    m_shaderManager.GetDescriptorAt(m_oitLLDescriptor).BindDescriptorSets(commandBuffer, forwardShader->GetPipelineLayout(), 2, m_currSwapChainImageIndex);
+                }
+            }
+            if (shaderChanged || material.m_descriptorID != currDescriptorID) {
+                currDescriptorID = material.m_descriptorID;
+                m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(commandBuffer, forwardShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
+            }
+
+            // Draw instanced mesh using curr material resources
+            forwardShader->BindPushConstants_InstancedData(commandBuffer, { batch.firstInstance, 0, 0, 0 });
+            DrawMeshInstanced(commandBuffer, batch.instanceCount, { meshComponents[batch.firstInstance].GetVertexHandle(), MESH_TRIANGLES });
+        }
+    }
+
+    void JEVulkanRenderer::DrawMeshes(const std::vector<MeshComponent>& meshComponents,
+                                      const std::vector<MaterialComponent>& materialComponents,
+                                      const std::vector<JEDrawBatch>& batches,
+                                      const JECamera& camera, const std::vector<JEParticleSystem>& particleSystems) {
         if (m_enableDeferred) {
             /// Construct deferred geometry render pass
             VkCommandBufferBeginInfo beginInfo = {};
@@ -879,45 +984,23 @@ namespace JoeEngine {
             deferredGeomShader->BindPushConstants_ViewProj(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], camera.GetViewProj());
             m_shaderManager.GetDescriptorAt(m_deferredGeometryModelMatrixDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], deferredGeomShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
             
-            // for every opaque material component, bind its descriptor each time it changes
-            uint32_t idx = 1;
-            uint32_t currStartIdx = 0;
+            // Opaque batches come first in the draw list. Bind each batch's descriptor when it changes.
+            uint32_t firstTranslucentBatch = 0;
             uint32_t currDescriptorID = 0;
-
-            if (materialComponents.size() > 0 && materialComponents[0].m_renderLayer < TRANSLUCENT) {
-                currDescriptorID = materialComponents[0].m_descriptorID;
-                m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], deferredGeomShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                int currMesh = meshComponents[currStartIdx].GetVertexHandle();
-
-                while (idx <= materialComponents.size()) {
-                    if (idx == materialComponents.size()) {
-                        deferredGeomShader->BindPushConstants_InstancedData(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                        DrawMeshInstanced(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], idx - currStartIdx, { currMesh, MESH_TRIANGLES });
-                        break;
-                    }
-                    if (materialComponents[idx].m_renderLayer < TRANSLUCENT &&
-                        materialComponents[idx].m_descriptorID == currDescriptorID &&
-                        meshComponents[idx].GetVertexHandle() == currMesh) {
-                        ++idx;
-                    } else {
-                        // Draw instanced mesh using curr material resources
-                        deferredGeomShader->BindPushConstants_InstancedData(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                        DrawMeshInstanced(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], idx - currStartIdx, { currMesh, MESH_TRIANGLES });
-
-                        if (materialComponents[idx].m_renderLayer >= TRANSLUCENT) {
-                            currStartIdx = idx;
-                            break;
-                        }
-                        if (materialComponents[idx].m_descriptorID != currDescriptorID) {
-                            m_shaderManager.GetDescriptorAt(materialComponents[idx].m_descriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], deferredGeomShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                            currDescriptorID = materialComponents[idx].m_descriptorID;
-                        }
-                        if (meshComponents[idx].GetVertexHandle() != currMesh) {
-                            currMesh = meshComponents[idx].GetVertexHandle();
-                        }
-                        currStartIdx = idx;
-                    }
+            for (; firstTranslucentBatch < batches.size(); ++firstTranslucentBatch) {
+                const JEDrawBatch& batch = batches[firstTranslucentBatch];
+                const MaterialComponent& material = materialComponents[batch.firstInstance];
+                if (material.m_renderLayer >= TRANSLUCENT) {
+                    break;
                 }
+                if (firstTranslucentBatch == 0 || material.m_descriptorID != currDescriptorID) {
+                    currDescriptorID = material.m_descriptorID;
+                    m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], deferredGeomShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
+                }
+
+                // Draw instanced mesh using curr material resources
+                deferredGeomShader->BindPushConstants_InstancedData(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], { batch.firstInstance, 0, 0, 0 });
+                DrawMeshInstanced(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], batch.instanceCount, { meshComponents[batch.firstInstance].GetVertexHandle(), MESH_TRIANGLES });
             }
 
             vkCmdEndRenderPass(m_deferredPass.commandBuffers[m_currSwapChainImageIndex]);
@@ -929,7 +1012,7 @@ namespace JoeEngine {
 
             /// Construct OIT first pass
 
-            if (m_enableOIT && materialComponents.size() > 0 && materialComponents[currStartIdx].m_renderLayer >= TRANSLUCENT) {
+            if (m_enableOIT && firstTranslucentBatch < batches.size()) {
                 // start a command buffer and render pass that renders all translucent geometry and assembles the linked list data
                 /*if (vkBeginCommandBuffer(m_oitCommandBuffers[m_currSwapChainImageIndex], &beginInfo) != VK_SUCCESS) {
                     throw std::runtime_error("failed to begin recording oit linked list pass command buffer!");
@@ -949,58 +1032,8 @@ namespace JoeEngine {
                 //vkCmdBeginRenderPass(m_oitCommandBuffers[m_currSwapChainImageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
                 vkCmdBeginRenderPass(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
                 
-                uint32_t materialIdx = currStartIdx;
-                if (materialIdx < materialComponents.size()) {
-                    ++materialIdx;
-                    currDescriptorID = materialComponents[currStartIdx].m_descriptorID;
-                    int currMesh = meshComponents[currStartIdx].GetVertexHandle();
-                    uint32_t currShaderID = materialComponents[currStartIdx].m_shaderID;
-
-                    JEForwardShader* forwardShader = (JEForwardShader*)m_shaderManager.GetShaderAt(currShaderID);
-                    vkCmdBindPipeline(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, forwardShader->GetPipeline());
-                    vkCmdSetViewport(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], 0, 1, &viewport);
-                    vkCmdSetScissor(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], 0, 1, &scissor);
-
-                    m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                    forwardShader->BindPushConstants_ViewProj(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], camera.GetViewProj());
-
-                    m_shaderManager.GetDescriptorAt(m_forwardModelMatrixDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
-                    m_shaderManager.GetDescriptorAt(m_oitLLDescriptor).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 2, m_currSwapChainImageIndex);
-
-                    while (materialIdx <= materialComponents.size()) {
-                        if (materialIdx == materialComponents.size()) {
-                            forwardShader->BindPushConstants_InstancedData(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                            DrawMeshInstanced(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], materialIdx - currStartIdx, { currMesh, MESH_TRIANGLES });
-                            break;
-                        }
-                        if (materialComponents[materialIdx].m_shaderID == currShaderID &&
-                            materialComponents[materialIdx].m_descriptorID == currDescriptorID &&
-                            meshComponents[materialIdx].GetVertexHandle() == currMesh) {
-                            ++materialIdx;
-                        } else {
-                            // Draw instanced mesh using curr material resources
-                            forwardShader->BindPushConstants_InstancedData(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                            DrawMeshInstanced(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], materialIdx - currStartIdx, { currMesh, MESH_TRIANGLES });
-
-                            if (materialComponents[materialIdx].m_shaderID != currShaderID) {
-                                currShaderID = materialComponents[materialIdx].m_shaderID;
-                                forwardShader = (JEForwardShader*)m_shaderManager.GetShaderAt(currShaderID);
-                                vkCmdBindPipeline(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, forwardShader->GetPipeline());
-                                vkCmdSetViewport(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], 0, 1, &viewport);
-                                vkCmdSetScissor(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], 0, 1, &scissor);
-                                m_shaderManager.GetDescriptorAt(m_forwardModelMatrixDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
-                            }
-                            if (materialComponents[materialIdx].m_descriptorID != currDescriptorID) {
-                                currDescriptorID = materialComponents[materialIdx].m_descriptorID;
-                                m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                            }
-                            if (meshComponents[materialIdx].GetVertexHandle() != currMesh) {
-                                currMesh = meshComponents[materialIdx].GetVertexHandle();
-                            }
-                            currStartIdx = materialIdx;
-                        }
-                    }
-                }
+                DrawForwardBatches(m_deferredPass.commandBuffers[m_currSwapChainImageIndex], meshComponents, materialComponents, batches,
+                                   firstTranslucentBatch, camera, viewport, scissor, true);
 
                 //vkCmdEndRenderPass(m_oitCommandBuffers[m_currSwapChainImageIndex]);
                 vkCmdEndRenderPass(m_deferredPass.commandBuffers[m_currSwapChainImageIndex]);
@@ -1064,57 +1097,8 @@ namespace JoeEngine {
 
                 if (!m_enableOIT) {
                     // Draw transluscent geometry
-                    uint32_t materialIdx = currStartIdx;
-                    if (materialIdx < materialComponents.size() && materialComponents[currStartIdx].m_renderLayer >= TRANSLUCENT) {
-                        ++materialIdx;
-                        currDescriptorID = materialComponents[currStartIdx].m_descriptorID;
-                        int currMesh = meshComponents[currStartIdx].GetVertexHandle();
-                        uint32_t currShaderID = materialComponents[currStartIdx].m_shaderID;
-
-                        JEForwardShader* forwardShader = (JEForwardShader*)m_shaderManager.GetShaderAt(currShaderID);
-                        vkCmdBindPipeline(m_commandBuffers[m_currSwapChainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, forwardShader->GetPipeline());
-                        vkCmdSetViewport(m_commandBuffers[m_currSwapChainImageIndex], 0, 1, &viewport);
-                        vkCmdSetScissor(m_commandBuffers[m_currSwapChainImageIndex], 0, 1, &scissor);
-
-                        m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                        forwardShader->BindPushConstants_ViewProj(m_commandBuffers[m_currSwapChainImageIndex], camera.GetViewProj());
-
-                        m_shaderManager.GetDescriptorAt(m_forwardModelMatrixDescriptorID).BindDescriptorSets(m_commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
-
-                        while (materialIdx <= materialComponents.size()) {
-                            if (materialIdx == materialComponents.size()) {
-                                forwardShader->BindPushConstants_InstancedData(m_commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                                DrawMeshInstanced(m_commandBuffers[m_currSwapChainImageIndex], materialIdx - currStartIdx, { currMesh, MESH_TRIANGLES });
-                                break;
-                            }
-                            if (materialComponents[materialIdx].m_shaderID == currShaderID &&
-                                materialComponents[materialIdx].m_descriptorID == currDescriptorID &&
-                                meshComponents[materialIdx].GetVertexHandle() == currMesh) {
-                                ++materialIdx;
-                            } else {
-                                // Draw instanced mesh using curr material resources
-                                forwardShader->BindPushConstants_InstancedData(m_commandBuffers[m_currSwapChainImageIndex], { currStartIdx, 0, 0, 0 });
-                                DrawMeshInstanced(m_commandBuffers[m_currSwapChainImageIndex], materialIdx - currStartIdx, { currMesh, MESH_TRIANGLES });
-
-                                if (materialComponents[materialIdx].m_shaderID != currShaderID) {
-                                    currShaderID = materialComponents[materialIdx].m_shaderID;
-                                    forwardShader = (JEForwardShader*)m_shaderManager.GetShaderAt(currShaderID);
-                                    vkCmdBindPipeline(m_commandBuffers[m_currSwapChainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, forwardShader->GetPipeline());
-                                    vkCmdSetViewport(m_commandBuffers[m_currSwapChainImageIndex], 0, 1, &viewport);
-                                    vkCmdSetScissor(m_commandBuffers[m_currSwapChainImageIndex], 0, 1, &scissor);
-                                    m_shaderManager.GetDescriptorAt(m_forwardModelMatrixDescriptorID).BindDescriptorSets(m_commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 1, m_currSwapChainImageIndex);
-                                }
-                                if (materialComponents[materialIdx].m_descriptorID != currDescriptorID) {
-                                    currDescriptorID = materialComponents[materialIdx].m_descriptorID;
-                                    m_shaderManager.GetDescriptorAt(currDescriptorID).BindDescriptorSets(m_commandBuffers[m_currSwapChainImageIndex], forwardShader->GetPipelineLayout(), 0, m_currSwapChainImageIndex);
-                                }
-                                if (meshComponents[materialIdx].GetVertexHandle() != currMesh) {
-                                    currMesh = meshComponents[materialIdx].GetVertexHandle();
-                                }
-                                currStartIdx = materialIdx;
-                            }
-                        }
-                    }
+                    DrawForwardBatches(m_commandBuffers[m_currSwapChainImageIndex], meshComponents, materialComponents, batches,
+                                       firstTranslucentBatch, camera, viewport, scissor, false);
                 } else {
                     JEOITSortShader* oitSortShader = (JEOITSortShader*)m_shaderManager.GetShaderAt(m_oitSortShader);
                     vkCmdBindPipeline(m_commandBuffers[m_currSwapChainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, oitSortShader->GetPipeline());
@@ -1897,23 +1881,26 @@ namespace JoeEngine {
         }
     }
 
-    void JEVulkanRenderer::StartFrame() {
+    bool JEVulkanRenderer::StartFrame() {
         vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
 
         VkResult result = vkAcquireNextImageKHR(m_device, m_vulkanSwapChain.GetSwapChain(), std::numeric_limits<uint64_t>::max(),
             m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_currSwapChainImageIndex);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            RecreateWindowDependentResources();
-            return;
+            OnWindowResourcesOutOfDate();
+            return false;
         } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
             throw std::runtime_error("failed to acquire swap chain image!");
         }
+        return true;
     }
 
     void JEVulkanRenderer::SubmitFrame(const std::vector<MaterialComponent>& materialComponents,
-        const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted) {
-        UpdateShaderBuffers(materialComponents, transforms, transformsSorted, m_currSwapChainImageIndex);
+        const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted,
+        uint64_t transformsVersion, uint64_t transformsSortedVersion, const JECamera& camera, const JECamera& shadowCamera) {
+        UpdateShaderBuffers(materialComponents, transforms, transformsSorted, transformsVersion, transformsSortedVersion, camera, shadowCamera,
+                            m_currSwapChainImageIndex);
 
         // Submit shadow pass command buffer
 
@@ -1995,7 +1982,7 @@ namespace JoeEngine {
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_didFramebufferResize) {
             m_didFramebufferResize = false;
-            RecreateWindowDependentResources();
+            OnWindowResourcesOutOfDate();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
         }
@@ -2003,6 +1990,21 @@ namespace JoeEngine {
         m_currentFrame = (m_currentFrame + 1) % m_MAX_FRAMES_IN_FLIGHT;
     }
 
+    void JEVulkanRenderer::OnWindowResourcesOutOfDate() {
+        if (m_pipelinedFrames) {
+            m_windowResourcesOutOfDate = true;
+        } else {
+            RecreateWindowDependentResources();
+        }
+    }
+
+    void JEVulkanRenderer::RecreateOutOfDateWindowResources() {
+        if (m_windowResourcesOutOfDate) {
+            m_windowResourcesOutOfDate = false;
+            RecreateWindowDependentResources();
+        }
+    }
+
     void JEVulkanRenderer::CleanupWindowDependentResources() {
         // Swap Chain Framebuffers
         for (auto framebuffer : m_swapChainFramebuffers) {
@@ -2087,6 +2089,7 @@ namespace JoeEngine {
 
         CleanupWindowDependentResources();
         m_vulkanSwapChain.Create(m_physicalDevice, m_device, m_vulkanWindow, newWidth, newHeight);
+        InvalidateUploadedShaderBuffers();
 
         // Forward Pass
         m_forwardPass.width = newWidth;
@@ -16,6 +16,7 @@
 #include "../Components/Mesh/MeshComponent.h"
 #include "../Components/Transform/TransformComponent.h"
 #include "../Physics/ParticleSystem.h"
+#include "../Scene/DrawListCache.h"
 
 namespace JoeEngine {
     class JESceneManager;
@@ -57,6 +58,15 @@ namespace JoeEngine {
         //! Renderer settings - enable order-independent translucency
         bool m_enableOIT;
 
+        //! Renderer settings - run without a window or Vulkan device (null backend).
+        bool m_headless;
+
+        //! Renderer settings - frames are pipelined with the simulation, see RendererSettings::PipelinedFrames.
+        bool m_pipelinedFrames;
+
+        //! Counter used to hand out texture/shader/descriptor IDs when running headless.
+        uint32_t m_headlessResourceCounter;
+
         //! Currently active swap chain image index.
         uint32_t m_currSwapChainImageIndex;
         
@@ -92,6 +102,9 @@ namespace JoeEngine {
         //! Flag indicating that the framebuffer has resized and relevant Vulkan resources need to be recreated.
         bool m_didFramebufferResize;
 
+        //! Flag indicating that the window-dependent resources are out of date and their recreation was deferred.
+        bool m_windowResourcesOutOfDate;
+
         //! Vulkan swap-chain framebuffer objects.
         std::vector<VkFramebuffer> m_swapChainFramebuffers;
 
@@ -104,6 +117,28 @@ namespace JoeEngine {
         //! Current frame to record (and then submit to GPU).
         uint32_t m_currentFrame;
 
+        //! Per swap chain image, the version of the shadow caster model matrices last uploaded to that image's SSBO.
+        std::vector<uint64_t> m_uploadedShadowTransformsVersions;
+
+        //! Per swap chain image, the version of the sorted model matrices last uploaded to that image's SSBOs.
+        std::vector<uint64_t> m_uploadedSortedTransformsVersions;
+
+        //! Version of the material uniform data, i.e. of the light view-projection matrix. Bumped whenever the matrix changes.
+        uint64_t m_materialUniformsVersion;
+
+        //! Light view-projection matrix of the current material uniform data version.
+        glm::mat4 m_materialUniformsLightViewProj;
+
+        //! Per material descriptor and swap chain image, the version of the material uniform data last uploaded to it.
+        /*!
+          Indexed by descriptor ID * number of swap chain images + image index. Also serves as the registry of the unique material
+          descriptors drawn in a frame: a descriptor shared by many draws is only written for the first of them.
+        */
+        std::vector<uint64_t> m_uploadedMaterialUniformsVersions;
+
+        //! Mark every swap chain image's model matrix SSBOs and material uniform buffers as needing a re-upload.
+        void InvalidateUploadedShaderBuffers();
+
         //! Maximum number of GPU frames in flight.
         const int m_MAX_FRAMES_IN_FLIGHT;
 
@@ -152,6 +187,11 @@ namespace JoeEngine {
         //! Recreate window-dependent resources (called upon window resize).
         void RecreateWindowDependentResources();
 
+        //! Handle out of date window-dependent resources: recreate them right away, or flag them for
+        //! RecreateOutOfDateWindowResources() when frames are pipelined, as recreation reads scene state that the simulation may
+        //! be writing to.
+        void OnWindowResourcesOutOfDate();
+
         /// Rendering variables and functions
 
         // Shader objects
@@ -334,6 +374,24 @@ namespace JoeEngine {
         */
         void DrawMeshInstanced(VkCommandBuffer commandBuffer, uint32_t numInstances, const MeshComponent& meshComponent);
 
+        //! Issue the instanced draw calls of forward-shaded draw batches.
+        /*!
+          Binds each batch's shader and descriptor when they change.
+          \param commandBuffer the command buffer to record draw commands to.
+          \param meshComponents the list of all mesh components, in draw list order.
+          \param materialComponents the list of all material components, in draw list order.
+          \param batches the instanced draw batches over the mesh and material component lists.
+          \param firstBatch the index of the first batch to draw. All batches from this one to the end are drawn.
+          \param camera the rendering camera object.
+          \param viewport the viewport to set with each shader.
+          \param scissor the scissor rectangle to set with each shader.
+          \param bindOITDescriptor whether to bind the OIT linked list descriptor to set 2.
+        */
+        void DrawForwardBatches(VkCommandBuffer commandBuffer, const std::vector<MeshComponent>& meshComponents,
+                                const std::vector<MaterialComponent>& materialComponents, const std::vector<JEDrawBatch>& batches,
+                                uint32_t firstBatch, const JECamera& camera, const VkViewport& viewport, const VkRect2D& scissor,
+                                bool bindOITDescriptor);
+
         //! Issue a mesh draw call for the screen-space triangle mesh.
         /*!
           \param commandBuffer the command buffer to record a draw command to.
@@ -351,15 +409,22 @@ namespace JoeEngine {
           \param materialComponents list of material components (shader and descriptor indices) to update buffers for.
           \param transforms list of all transformation matrices.
           \param transformsSorted list of all transform matrices, sorted by material/mesh properties.
+          \param transformsVersion version of 'transforms'. The upload is skipped if this image already holds this version.
+          \param transformsSortedVersion version of 'transformsSorted'. The upload is skipped if this image already holds this version.
+          \param camera the rendering camera object.
+          \param shadowCamera the light source shadow map camera.
           \param imageIndex the currently active swap chain image.
         */
         void UpdateShaderBuffers(const std::vector<MaterialComponent>& materialComponents,
-            const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted, uint32_t imageIndex);
+            const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted,
+            uint64_t transformsVersion, uint64_t transformsSortedVersion, const JECamera& camera, const JECamera& shadowCamera,
+            uint32_t imageIndex);
 
     public:
         //! Default constructor.
         JEVulkanRenderer() : m_width(JE_DEFAULT_SCREEN_WIDTH), m_height(JE_DEFAULT_SCREEN_HEIGHT), m_MAX_FRAMES_IN_FLIGHT(JE_DEFAULT_MAX_FRAMES_IN_FLIGHT),
-            m_enableDeferred(false), m_enableOIT(false), m_currSwapChainImageIndex(0), m_engineInstance(nullptr), m_sceneManager(nullptr), m_didFramebufferResize(false), m_currentFrame(0) {}
+            m_enableDeferred(false), m_enableOIT(false), m_headless(false), m_pipelinedFrames(false), m_headlessResourceCounter(0), m_currSwapChainImageIndex(0), m_engineInstance(nullptr), m_sceneManager(nullptr), m_didFramebufferResize(false), m_windowResourcesOutOfDate(false), m_currentFrame(0),
+            m_materialUniformsVersion(0), m_materialUniformsLightViewProj(0.0f) {}
         
         //! Destructor (default).
         ~JEVulkanRenderer() = default;
@@ -384,23 +449,47 @@ namespace JoeEngine {
         void FramebufferResized() { m_didFramebufferResize = true; }
 
         //! Perform necessary commands for the beginning of a frame, before draw calls are issued.
-        void StartFrame();
+        /*!
+          \return false if no swap chain image could be acquired because the swap chain is out of date, in which case the frame
+          must be skipped.
+        */
+        bool StartFrame();
 
         //! Submit work to GPU.
+        /*!
+          Reads no scene state other than its arguments, so the simulation can run concurrently when frames are pipelined.
+          \param materialComponents the list of all material components, sorted for optimal resource binding frequency.
+          \param transforms the shadow caster model matrices.
+          \param transformsSorted the model matrices of all drawn meshes, sorted for optimal resource binding frequency.
+          \param transformsVersion version of 'transforms', used to skip redundant SSBO uploads.
+          \param transformsSortedVersion version of 'transformsSorted', used to skip redundant SSBO uploads.
+          \param camera the rendering camera object.
+          \param shadowCamera the light source shadow map camera.
+        */
         void SubmitFrame(const std::vector<MaterialComponent>& materialComponents,
-            const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted);
+            const std::vector<glm::mat4>& transforms, const std::vector<glm::mat4>& transformsSorted,
+            uint64_t transformsVersion, uint64_t transformsSortedVersion, const JECamera& camera, const JECamera& shadowCamera);
+
+        //! Recreate the window-dependent resources if their recreation was deferred because frames are pipelined.
+        /*! Must not be called while the simulation is running. */
+        void RecreateOutOfDateWindowResources();
 
         // Mesh Buffer Manager Functions
         //! Get the bounding box data for every entity in the scene.
         //! \return list of all bounding box data.
         const std::vector<BoundingBoxData>& GetBoundingBoxData() const;
 
-        //! Creates a new Mesh component given a file source path. Simple wrapper around the equivalent JEMeshBufferManager function.
+        //! Get the bounding sphere data for every entity in the scene.
+        //! \return list of all bounding sphere data.
+        const std::vector<BoundingSphereData>& GetBoundingSphereData() const;
+
+        //! Creates a new Mesh component given a file source path. Simple wrapper around the equivalent JEMeshBufferManager functions.
         /*!
           \param filepath the file source path for the mesh.
+          \param numLods the maximum number of LODs to generate for the mesh.
           \return a new Mesh Component.
         */
-        MeshComponent CreateMesh(const std::string& filepath);
+        MeshComponent CreateMesh(const std::string& filepath, uint32_t numLods = 0);
 
         //! Creates a new texture given a file source path. Simple wrapper around the equivalent JETextureLibrary function.
         /*!
@@ -452,15 +541,31 @@ namespace JoeEngine {
         /*!
           \param meshComponents the list of all mesh components, sorted for optimal resource binding frequency.
           \param materialComponents the list of all material components, sorted for optimal resource binding frequency.
+          \param batches the instanced draw batches over the mesh and material component lists, opaque batches first.
           \param camera the rendering camera object.
           \param particleSystems the list of all particle systems to draw.
         */
         void DrawMeshes(const std::vector<MeshComponent>& meshComponents, const std::vector<MaterialComponent>& materialComponents,
-                                const JECamera& camera, const std::vector<JEParticleSystem>& particleSystems);
+                        const std::vector<JEDrawBatch>& batches, const JECamera& camera,
+                        const std::vector<JEParticleSystem>& particleSystems);
 
         //! Wrapper for Vulkan API call to wait for the logical device to be idle.
         void WaitForIdleDevice() {
-            vkDeviceWaitIdle(m_device);
+            if (!m_headless) {
+                vkDeviceWaitIdle(m_device);
+            }
+        }
+
+        //! Whether the renderer is running as a null backend (no window, no Vulkan device).
+        //! \return true if headless, false otherwise.
+        bool IsHeadless() const {
+            return m_headless;
+        }
+
+        //! Whether frames are pipelined with the simulation, see RendererSettings::PipelinedFrames.
+        //! \return true if pipelined, false otherwise.
+        bool IsPipelined() const {
+            return m_pipelinedFrames;
         }
 
         //! Get the Vulkan window object.
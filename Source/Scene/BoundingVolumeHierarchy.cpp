@@ -0,0 +1,281 @@
+#include "BoundingVolumeHierarchy.h"
+
+namespace JoeEngine {
+    int JEBoundingVolumeHierarchy::AllocateNode() {
+        int node;
+        if (m_freeList == JE_BVH_NULL_NODE) {
+            node = (int)m_nodes.size();
+            m_nodes.emplace_back();
+        } else {
+            node = m_freeList;
+            m_freeList = m_nodes[node].parent;
+        }
+
+        JEBVHNode& newNode = m_nodes[node];
+        newNode.parent = JE_BVH_NULL_NODE;
+        newNode.child1 = JE_BVH_NULL_NODE;
+        newNode.child2 = JE_BVH_NULL_NODE;
+        newNode.height = 0;
+        newNode.entityID = 0;
+        return node;
+    }
+
+    void JEBoundingVolumeHierarchy::FreeNode(int node) {
+        m_nodes[node].parent = m_freeList;
+        m_nodes[node].height = -1;
+        m_freeList = node;
+    }
+
+    void JEBoundingVolumeHierarchy::InsertLeaf(int leaf) {
+        if (m_root == JE_BVH_NULL_NODE) {
+            m_root = leaf;
+            m_nodes[leaf].parent = JE_BVH_NULL_NODE;
+            return;
+        }
+
+        // Find the best sibling: descend while pushing the leaf further down costs less surface area than pairing it here
+        const glm::vec3 leafMin = m_nodes[leaf].minPos;
+        const glm::vec3 leafMax = m_nodes[leaf].maxPos;
+        int sibling = m_root;
+        while (!m_nodes[sibling].IsLeaf()) {
+            const JEBVHNode& node = m_nodes[sibling];
+            const float area = SurfaceArea(node.minPos, node.maxPos);
+            const float combinedArea = SurfaceArea(glm::min(node.minPos, leafMin), glm::max(node.maxPos, leafMax));
+
+            // Cost of pairing the leaf with this node, and the growth every ancestor below this point inherits otherwise
+            const float cost = 2.0f * combinedArea;
+            const float inheritanceCost = 2.0f * (combinedArea - area);
+
+            const auto descendCost = [&](int child) {
+                const JEBVHNode& childNode = m_nodes[child];
+                const float childCombinedArea = SurfaceArea(glm::min(childNode.minPos, leafMin), glm::max(childNode.maxPos, leafMax));
+                if (childNode.IsLeaf()) {
+                    return childCombinedArea + inheritanceCost;
+                }
+                return childCombinedArea - SurfaceArea(childNode.minPos, childNode.maxPos) + inheritanceCost;
+            };
+            const float cost1 = descendCost(node.child1);
+            const float cost2 = descendCost(node.child2);
+
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            sibling = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        // Replace the sibling with a new parent of the sibling and the leaf
+        const int newParent = AllocateNode();
+        const int oldParent = m_nodes[sibling].parent;
+        JEBVHNode& parentNode = m_nodes[newParent];
+        parentNode.parent = oldParent;
+        parentNode.minPos = glm::min(m_nodes[sibling].minPos, leafMin);
+        parentNode.maxPos = glm::max(m_nodes[sibling].maxPos, leafMax);
+        parentNode.height = m_nodes[sibling].height + 1;
+        parentNode.child1 = sibling;
+        parentNode.child2 = leaf;
+
+        if (oldParent == JE_BVH_NULL_NODE) {
+            m_root = newParent;
+        } else if (m_nodes[oldParent].child1 == sibling) {
+            m_nodes[oldParent].child1 = newParent;
+        } else {
+            m_nodes[oldParent].child2 = newParent;
+        }
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        RefitAncestors(m_nodes[leaf].parent);
+    }
+
+    void JEBoundingVolumeHierarchy::RemoveLeaf(int leaf) {
+        if (leaf == m_root) {
+            m_root = JE_BVH_NULL_NODE;
+            return;
+        }
+
+        // Replace the leaf's parent with the leaf's sibling
+        const int parent = m_nodes[leaf].parent;
+        const int grandParent = m_nodes[parent].parent;
+        const int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+        if (grandParent == JE_BVH_NULL_NODE) {
+            m_root = sibling;
+            m_nodes[sibling].parent = JE_BVH_NULL_NODE;
+            FreeNode(parent);
+        } else {
+            if (m_nodes[grandParent].child1 == parent) {
+                m_nodes[grandParent].child1 = sibling;
+            } else {
+                m_nodes[grandParent].child2 = sibling;
+            }
+            m_nodes[sibling].parent = grandParent;
+            FreeNode(parent);
+            RefitAncestors(grandParent);
+        }
+    }
+
+    void JEBoundingVolumeHierarchy::RefitAncestors(int node) {
+        while (node != JE_BVH_NULL_NODE) {
+            node = Balance(node);
+
+            JEBVHNode& n = m_nodes[node];
+            const JEBVHNode& child1 = m_nodes[n.child1];
+            const JEBVHNode& child2 = m_nodes[n.child2];
+            n.height = 1 + std::max(child1.height, child2.height);
+            n.minPos = glm::min(child1.minPos, child2.minPos);
+            n.maxPos = glm::max(child1.maxPos, child2.maxPos);
+
+            node = n.parent;
+        }
+    }
+
+    int JEBoundingVolumeHierarchy::Balance(int iA) {
+        JEBVHNode& A = m_nodes[iA];
+        if (A.IsLeaf() || A.height < 2) {
+            return iA;
+        }
+
+        const int iB = A.child1;
+        const int iC = A.child2;
+        JEBVHNode& B = m_nodes[iB];
+        JEBVHNode& C = m_nodes[iC];
+        const int balance = C.height - B.height;
+
+        // Rotate the taller child up to A's place, and hand A the shorter of that child's children
+        if (balance > 1) {
+            const int iF = C.child1;
+            const int iG = C.child2;
+            JEBVHNode& F = m_nodes[iF];
+            JEBVHNode& G = m_nodes[iG];
+
+            C.child1 = iA;
+            C.parent = A.parent;
+            A.parent = iC;
+            if (C.parent == JE_BVH_NULL_NODE) {
+                m_root = iC;
+            } else if (m_nodes[C.parent].child1 == iA) {
+                m_nodes[C.parent].child1 = iC;
+            } else {
+                m_nodes[C.parent].child2 = iC;
+            }
+
+            if (F.height > G.height) {
+                C.child2 = iF;
+                A.child2 = iG;
+                G.parent = iA;
+                A.minPos = glm::min(B.minPos, G.minPos);
+                A.maxPos = glm::max(B.maxPos, G.maxPos);
+                C.minPos = glm::min(A.minPos, F.minPos);
+                C.maxPos = glm::max(A.maxPos, F.maxPos);
+                A.height = 1 + std::max(B.height, G.height);
+                C.height = 1 + std::max(A.height, F.height);
+            } else {
+                C.child2 = iG;
+                A.child2 = iF;
+                F.parent = iA;
+                A.minPos = glm::min(B.minPos, F.minPos);
+                A.maxPos = glm::max(B.maxPos, F.maxPos);
+                C.minPos = glm::min(A.minPos, G.minPos);
+                C.maxPos = glm::max(A.maxPos, G.maxPos);
+                A.height = 1 + std::max(B.height, F.height);
+                C.height = 1 + std::max(A.height, G.height);
+            }
+            return iC;
+        }
+
+        if (balance < -1) {
+            const int iD = B.child1;
+            const int iE = B.child2;
+            JEBVHNode& D = m_nodes[iD];
+            JEBVHNode& E = m_nodes[iE];
+
+            B.child1 = iA;
+            B.parent = A.parent;
+            A.parent = iB;
+            if (B.parent == JE_BVH_NULL_NODE) {
+                m_root = iB;
+            } else if (m_nodes[B.parent].child1 == iA) {
+                m_nodes[B.parent].child1 = iB;
+            } else {
+                m_nodes[B.parent].child2 = iB;
+            }
+
+            if (D.height > E.height) {
+                B.child2 = iD;
+                A.child1 = iE;
+                E.parent = iA;
+                A.minPos = glm::min(C.minPos, E.minPos);
+                A.maxPos = glm::max(C.maxPos, E.maxPos);
+                B.minPos = glm::min(A.minPos, D.minPos);
+                B.maxPos = glm::max(A.maxPos, D.maxPos);
+                A.height = 1 + std::max(C.height, E.height);
+                B.height = 1 + std::max(A.height, D.height);
+            } else {
+                B.child2 = iE;
+                A.child1 = iD;
+                D.parent = iA;
+                A.minPos = glm::min(C.minPos, D.minPos);
+                A.maxPos = glm::max(C.maxPos, D.maxPos);
+                B.minPos = glm::min(A.minPos, E.minPos);
+                B.maxPos = glm::max(A.maxPos, E.maxPos);
+                A.height = 1 + std::max(C.height, D.height);
+                B.height = 1 + std::max(A.height, E.height);
+            }
+            return iB;
+        }
+
+        return iA;
+    }
+
+    bool JEBoundingVolumeHierarchy::Update(uint32_t entityID, const glm::vec3& minPos, const glm::vec3& maxPos) {
+        if (entityID >= m_leafNodes.size()) {
+            m_leafNodes.resize(entityID + 1, JE_BVH_NULL_NODE);
+        }
+
+        const glm::vec3 margin = (maxPos - minPos) * JE_BVH_FAT_MARGIN;
+        const glm::vec3 fatMin = minPos - margin;
+        const glm::vec3 fatMax = maxPos + margin;
+
+        int leaf = m_leafNodes[entityID];
+        if (leaf == JE_BVH_NULL_NODE) {
+            leaf = AllocateNode();
+            m_nodes[leaf].entityID = entityID;
+            m_leafNodes[entityID] = leaf;
+            ++m_numLeaves;
+        } else {
+            // Keep the leaf where it is while the entity stays inside its fat box, unless the entity shrank well below it
+            const JEBVHNode& node = m_nodes[leaf];
+            const bool contained = node.minPos.x <= minPos.x && node.minPos.y <= minPos.y && node.minPos.z <= minPos.z &&
+                                   node.maxPos.x >= maxPos.x && node.maxPos.y >= maxPos.y && node.maxPos.z >= maxPos.z;
+            if (contained && SurfaceArea(node.minPos, node.maxPos) <= 4.0f * SurfaceArea(fatMin, fatMax)) {
+                return false;
+            }
+            RemoveLeaf(leaf);
+        }
+
+        m_nodes[leaf].minPos = fatMin;
+        m_nodes[leaf].maxPos = fatMax;
+        InsertLeaf(leaf);
+        return true;
+    }
+
+    void JEBoundingVolumeHierarchy::Remove(uint32_t entityID) {
+        if (!Contains(entityID)) {
+            return;
+        }
+
+        const int leaf = m_leafNodes[entityID];
+        RemoveLeaf(leaf);
+        FreeNode(leaf);
+        m_leafNodes[entityID] = JE_BVH_NULL_NODE;
+        --m_numLeaves;
+    }
+
+    void JEBoundingVolumeHierarchy::Clear() {
+        m_nodes.clear();
+        m_root = JE_BVH_NULL_NODE;
+        m_freeList = JE_BVH_NULL_NODE;
+        m_numLeaves = 0;
+        std::fill(m_leafNodes.begin(), m_leafNodes.end(), JE_BVH_NULL_NODE);
+    }
+}
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "glm/glm.hpp"
+
+#include "Frustum.h"
+
+namespace JoeEngine {
+    //! Fraction of a leaf's extents added on each side of its bounds, so that small movements do not touch the tree.
+    constexpr float JE_BVH_FAT_MARGIN = 0.1f;
+
+    //! Maximum traversal stack depth of BVH queries.
+    constexpr uint32_t JE_BVH_MAX_QUERY_DEPTH = 256;
+
+    //! The Bounding Volume Hierarchy class
+    /*!
+      Dynamic AABB tree over entity world-space bounds, for scene-level broad-phase culling and spatial queries.
+      Each entity is a leaf whose box is its tight world-space box grown by JE_BVH_FAT_MARGIN. Update() leaves the tree alone
+      while the tight box stays inside the fat box, and otherwise moves the leaf: it is removed and reinserted next to the
+      sibling that grows the tree's surface area the least. Tree rotations on the way back up keep the tree balanced.
+      Queries walk the tree and skip entire subtrees whose box misses the query volume. They report entity IDs whose fat box
+      passes, so results are conservative and callers run any exact per-object tests themselves.
+      Queries only read the tree and may run concurrently with each other, but not with Update() or Remove().
+      \sa JEFrustum, JEEngineInstance
+    */
+    class JEBoundingVolumeHierarchy {
+    private:
+        //! Null node index.
+        static constexpr int JE_BVH_NULL_NODE = -1;
+
+        //! Tree node.
+        typedef struct je_bvh_node_t {
+            //! Box min corner.
+            glm::vec3 minPos;
+
+            //! Box max corner.
+            glm::vec3 maxPos;
+
+            //! Parent node index, or the next free node while on the free list.
+            int parent;
+
+            //! First child node index, JE_BVH_NULL_NODE for leaves.
+            int child1;
+
+            //! Second child node index, JE_BVH_NULL_NODE for leaves.
+            int child2;
+
+            //! Height of the subtree. 0 for leaves, -1 for free nodes.
+            int height;
+
+            //! Entity ID of a leaf.
+            uint32_t entityID;
+
+            //! Whether the node is a leaf.
+            bool IsLeaf() const {
+                return child1 == JE_BVH_NULL_NODE;
+            }
+        } JEBVHNode;
+
+        //! Node pool.
+        std::vector<JEBVHNode> m_nodes;
+
+        //! Root node index.
+        int m_root;
+
+        //! First node of the free list.
+        int m_freeList;
+
+        //! Number of leaves.
+        uint32_t m_numLeaves;
+
+        //! Leaf node index of each entity ID, -1 if the entity is not in the tree.
+        std::vector<int> m_leafNodes;
+
+        //! Take a node from the free list (or grow the pool).
+        int AllocateNode();
+
+        //! Return a node to the free list.
+        void FreeNode(int node);
+
+        //! Insert a leaf next to its best sibling, then refit and rebalance its ancestors.
+        void InsertLeaf(int leaf);
+
+        //! Unlink a leaf from the tree, then refit and rebalance its former ancestors.
+        void RemoveLeaf(int leaf);
+
+        //! Refit and rebalance from a node up to the root.
+        void RefitAncestors(int node);
+
+        //! Rotate a node's subtree if it is imbalanced.
+        //! \return the index of the node now at the subtree root.
+        int Balance(int node);
+
+        //! Surface area of a box.
+        static float SurfaceArea(const glm::vec3& minPos, const glm::vec3& maxPos) {
+            const glm::vec3 d = maxPos - minPos;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        //! Walk the tree, descending into nodes accepted by 'visitNode' and reporting accepted leaves.
+        template <typename NodeTest, typename Callback>
+        void Traverse(NodeTest&& visitNode, Callback&& callback) const {
+            if (m_root == JE_BVH_NULL_NODE) {
+                return;
+            }
+
+            int stack[JE_BVH_MAX_QUERY_DEPTH];
+            uint32_t stackSize = 0;
+            stack[stackSize++] = m_root;
+            while (stackSize > 0) {
+                const JEBVHNode& node = m_nodes[stack[--stackSize]];
+                if (!visitNode(node.minPos, node.maxPos)) {
+                    continue;
+                }
+
+                if (node.IsLeaf()) {
+                    callback(node.entityID);
+                } else {
+                    if (stackSize + 2 > JE_BVH_MAX_QUERY_DEPTH) {
+                        throw std::runtime_error("BVH query stack overflow");
+                    }
+                    stack[stackSize++] = node.child2;
+                    stack[stackSize++] = node.child1;
+                }
+            }
+        }
+
+        //! Report every leaf below a node.
+        template <typename Callback>
+        void ReportSubtree(int subtreeRoot, Callback&& callback) const {
+            int stack[JE_BVH_MAX_QUERY_DEPTH];
+            uint32_t stackSize = 0;
+            stack[stackSize++] = subtreeRoot;
+            while (stackSize > 0) {
+                const JEBVHNode& node = m_nodes[stack[--stackSize]];
+                if (node.IsLeaf()) {
+                    callback(node.entityID);
+                } else {
+                    if (stackSize + 2 > JE_BVH_MAX_QUERY_DEPTH) {
+                        throw std::runtime_error("BVH query stack overflow");
+                    }
+                    stack[stackSize++] = node.child2;
+                    stack[stackSize++] = node.child1;
+                }
+            }
+        }
+
+    public:
+        //! Default constructor.
+        /*! Creates an empty tree. */
+        JEBoundingVolumeHierarchy() : m_root(JE_BVH_NULL_NODE), m_freeList(JE_BVH_NULL_NODE), m_numLeaves(0) {}
+
+        //! Destructor (default).
+        ~JEBoundingVolumeHierarchy() = default;
+
+        //! Insert or move an entity.
+        /*!
+          Inserts the entity if it is not in the tree yet. Otherwise only touches the tree if the new bounds leave the entity's
+          fat box.
+          \param entityID the entity ID.
+          \param minPos the entity's world-space box min corner.
+          \param maxPos the entity's world-space box max corner.
+          \return true if the tree changed, false otherwise.
+        */
+        bool Update(uint32_t entityID, const glm::vec3& minPos, const glm::vec3& maxPos);
+
+        //! Remove an entity.
+        /*!
+          Does nothing if the entity is not in the tree.
+          \param entityID the entity ID.
+        */
+        void Remove(uint32_t entityID);
+
+        //! Remove all entities.
+        void Clear();
+
+        //! Whether an entity is in the tree.
+        bool Contains(uint32_t entityID) const {
+            return entityID < m_leafNodes.size() && m_leafNodes[entityID] != JE_BVH_NULL_NODE;
+        }
+
+        //! Get the number of entities in the tree.
+        uint32_t Size() const {
+            return m_numLeaves;
+        }
+
+        //! Get the height of the tree (0 for a single leaf, -1 if empty).
+        int GetHeight() const {
+            return m_root == JE_BVH_NULL_NODE ? -1 : m_nodes[m_root].height;
+        }
+
+        //! Frustum query.
+        /*!
+          Reports every entity whose fat box is not entirely behind one of the frustum planes. Subtrees entirely inside the
+          frustum are reported without testing any further boxes.
+          \param frustum the frustum to test against.
+          \param callback invoked with the entity ID of each reported entity.
+        */
+        template <typename Callback>
+        void QueryFrustum(const JEFrustum& frustum, Callback&& callback) const {
+            if (m_root == JE_BVH_NULL_NODE) {
+                return;
+            }
+
+            // Each stack entry carries a mask of the planes its parent was not fully inside of
+            constexpr uint32_t allPlanes = 0x3F;
+            const std::array<glm::vec4, 6>& planes = frustum.GetPlanes();
+            int stack[JE_BVH_MAX_QUERY_DEPTH];
+            uint32_t masks[JE_BVH_MAX_QUERY_DEPTH];
+            uint32_t stackSize = 0;
+            stack[stackSize] = m_root;
+            masks[stackSize++] = allPlanes;
+            while (stackSize > 0) {
+                --stackSize;
+                const int nodeIdx = stack[stackSize];
+                uint32_t mask = masks[stackSize];
+                const JEBVHNode& node = m_nodes[nodeIdx];
+                const glm::vec3 center = (node.minPos + node.maxPos) * 0.5f;
+                const glm::vec3 extents = (node.maxPos - node.minPos) * 0.5f;
+
+                bool outside = false;
+                for (uint32_t p = 0; p < 6; ++p) {
+                    if (!(mask & (1u << p))) {
+                        continue;
+                    }
+                    const glm::vec3 normal = glm::vec3(planes[p]);
+                    const float dist = glm::dot(normal, center) + planes[p].w;
+                    const float radius = glm::dot(glm::abs(normal), extents);
+                    if (dist + radius < 0.0f) {
+                        outside = true;
+                        break;
+                    }
+                    if (dist - radius >= 0.0f) {
+                        // Entirely in front of this plane, and so is everything below
+                        mask &= ~(1u << p);
+                    }
+                }
+                if (outside) {
+                    continue;
+                }
+
+                if (mask == 0 || node.IsLeaf()) {
+                    ReportSubtree(nodeIdx, callback);
+                } else {
+                    if (stackSize + 2 > JE_BVH_MAX_QUERY_DEPTH) {
+                        throw std::runtime_error("BVH query stack overflow");
+                    }
+                    stack[stackSize] = node.child2;
+                    masks[stackSize++] = mask;
+                    stack[stackSize] = node.child1;
+                    masks[stackSize++] = mask;
+                }
+            }
+        }
+
+        //! Box query.
+        /*!
+          Reports every entity whose fat box overlaps the query box.
+          \param minPos the query box min corner.
+          \param maxPos the query box max corner.
+          \param callback invoked with the entity ID of each reported entity.
+        */
+        template <typename Callback>
+        void QueryAABB(const glm::vec3& minPos, const glm::vec3& maxPos, Callback&& callback) const {
+            Traverse([&](const glm::vec3& nodeMin, const glm::vec3& nodeMax) {
+                return nodeMin.x <= maxPos.x && nodeMin.y <= maxPos.y && nodeMin.z <= maxPos.z &&
+                       nodeMax.x >= minPos.x && nodeMax.y >= minPos.y && nodeMax.z >= minPos.z;
+            }, callback);
+        }
+
+        //! Sphere query.
+        /*!
+          Reports every entity whose fat box overlaps the query sphere.
+          \param center the sphere center.
+          \param radius the sphere radius.
+          \param callback invoked with the entity ID of each reported entity.
+        */
+        template <typename Callback>
+        void QuerySphere(const glm::vec3& center, float radius, Callback&& callback) const {
+            const float radius2 = radius * radius;
+            Traverse([&](const glm::vec3& nodeMin, const glm::vec3& nodeMax) {
+                const glm::vec3 closest = glm::max(nodeMin, glm::min(center, nodeMax));
+                const glm::vec3 offset = closest - center;
+                return glm::dot(offset, offset) <= radius2;
+            }, callback);
+        }
+
+        //! Ray query.
+        /*!
+          Reports every entity whose fat box is hit by the ray within the maximum distance, roughly front to back. The callback
+          returns the distance along the ray to keep searching up to, e.g. the distance of an exact hit against the entity to
+          only find closer hits from then on, or the current maximum distance to ignore the entity. Returning 0 ends the query.
+          \param origin the ray origin.
+          \param direction the ray direction (need not be normalized; distances are in multiples of it).
+          \param maxDistance the maximum distance along the ray.
+          \param callback invoked with the entity ID of each reported entity, returns the new maximum distance.
+        */
+        template <typename Callback>
+        void Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const {
+            if (m_root == JE_BVH_NULL_NODE) {
+                return;
+            }
+
+            // Zero direction components use a huge inverse instead of infinity, so that the slab test never computes 0 * inf
+            const glm::vec3 invDirection = glm::vec3(direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+                                                     direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+                                                     direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+            const auto hitDistance = [&](const JEBVHNode& node) {
+                // Slab test, returns the entry distance or -1 on a miss
+                const glm::vec3 t0 = (node.minPos - origin) * invDirection;
+                const glm::vec3 t1 = (node.maxPos - origin) * invDirection;
+                const glm::vec3 tMin = glm::min(t0, t1);
+                const glm::vec3 tMax = glm::max(t0, t1);
+                const float tEnter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+                const float tExit = std::min(std::min(tMax.x, tMax.y), tMax.z);
+                return tEnter <= tExit ? tEnter : -1.0f;
+            };
+
+            int stack[JE_BVH_MAX_QUERY_DEPTH];
+            uint32_t stackSize = 0;
+            stack[stackSize++] = m_root;
+            while (stackSize > 0) {
+                const JEBVHNode& node = m_nodes[stack[--stackSize]];
+                const float t = hitDistance(node);
+                if (t < 0.0f || t > maxDistance) {
+                    continue;
+                }
+
+                if (node.IsLeaf()) {
+                    maxDistance = std::min(maxDistance, (float)callback(node.entityID));
+                    if (maxDistance <= 0.0f) {
+                        return;
+                    }
+                } else {
+                    if (stackSize + 2 > JE_BVH_MAX_QUERY_DEPTH) {
+                        throw std::runtime_error("BVH query stack overflow");
+                    }
+                    // Visit the nearer child first so that hits found there clip the ray for the other one
+                    const float t1 = hitDistance(m_nodes[node.child1]);
+                    const float t2 = hitDistance(m_nodes[node.child2]);
+                    const bool child1First = t2 < 0.0f || (t1 >= 0.0f && t1 <= t2);
+                    stack[stackSize++] = child1First ? node.child2 : node.child1;
+                    stack[stackSize++] = child1First ? node.child1 : node.child2;
+                }
+            }
+        }
+    };
+}
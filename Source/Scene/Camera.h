@@ -7,6 +7,7 @@
 #include "../Components/Mesh/MeshComponent.h"
 #include "../Components/Transform/TransformComponent.h"
 #include "../Rendering/MeshBufferManager.h"
+#include "Frustum.h"
 
 namespace JoeEngine {
     //! The JECamera class.
@@ -166,6 +167,16 @@ namespace JoeEngine {
             UpdateView();
         }
 
+        //! Get eye position.
+        const glm::vec3& GetEye() const {
+            return m_eye;
+        }
+
+        //! Get look vector.
+        const glm::vec3& GetLook() const {
+            return m_look;
+        }
+
         //! Get view matrix.
         const glm::mat4& GetView() const {
             return m_viewMatrix;
@@ -209,70 +220,41 @@ namespace JoeEngine {
             return m_farPlane;
         }
 
+        //! Get the world-space view frustum.
+        JEFrustum GetFrustum() const {
+            return JEFrustum(GetViewProj());
+        }
+
+        //! Get the world-space view volume of the orthographic projection.
+        //! \sa GetOrthoViewProj()
+        JEFrustum GetOrthoFrustum() const {
+            return JEFrustum(GetOrthoViewProj());
+        }
+
         //! Frustum cull.
         /*!
           Given a bounding box and transformation, check whether it should be culled due to being outside of the
-          view frustum.
-          \param transformComponent the world transformation of the bounding box.
+          view frustum. Never culls a box that intersects the frustum.
+          \param worldMatrix the world transformation of the bounding box.
           \param boundingBox the bounding box data
           \return true if the bounding box passed culling (was NOT culled), false otherwise.
+          \sa JEFrustum
+        */
+        bool Cull(const glm::mat4& worldMatrix, const BoundingBoxData& boundingBox) const {
+            return GetFrustum().TestBox(worldMatrix, boundingBox);
+        }
+
+        //! Frustum cull.
+        /*!
+          Given a bounding sphere and transformation, check whether it should be culled due to being outside of the
+          view frustum. Never culls a sphere that intersects the frustum.
+          \param worldMatrix the world transformation of the bounding sphere.
+          \param boundingSphere the bounding sphere data
+          \return true if the bounding sphere passed culling (was NOT culled), false otherwise.
+          \sa JEFrustum
         */
-        bool Cull(const TransformComponent& transformComponent, const BoundingBoxData& boundingBox) const {
-            const glm::mat4 transVS = GetViewProj() * transformComponent.GetTransform();
-            
-            BoundingBoxData bbData;
-            //bool inside = false;
-            for (uint8_t i = 0; i < boundingBox.size(); ++i) {
-                glm::vec4 bbPointCS = transVS * glm::vec4(boundingBox[i], 1.0f);
-                bbPointCS /= bbPointCS.w;
-                /*inside |= bbPointCS.x > -1.0f &&
-                          bbPointCS.y > -1.0f &&
-                          bbPointCS.z > 0.0f &&
-                          bbPointCS.x < 1.0f &&
-                          bbPointCS.y < 1.0f &&
-                          bbPointCS.z < 1.0f;*/
-                
-                int inside = 0;
-                inside += (int)(bbPointCS.x > -1.0f);
-                inside += (int)(bbPointCS.y > -1.0f);
-                inside += (int)(bbPointCS.z > 0.0f);
-                inside += (int)(bbPointCS.x < 1.0f);
-                inside += (int)(bbPointCS.y < 1.0f);
-                inside += (int)(bbPointCS.z < 1.0f);
-                if (inside == 6) {
-                    return true;
-                }
-
-                bbData[i] = bbPointCS;
-            }
-
-            // Resolve false negatives (e.g. - large plane where all four corners are outside the view frustum)
-            bool intersecting = false;
-
-            const int maxIdx = boundingBox.size() - 1;
-            // if the x-coord of the obb's min/max points are on opposite sides of the left view frustum plane
-            intersecting |= std::signbit(bbData[0].x + 1.0f) != std::signbit(bbData[maxIdx].x + 1.0f);
-            // if the x-coord of the obb's min/max points are on opposite sides of the right view frustum plane
-            intersecting |= std::signbit(bbData[0].x - 1.0f) != std::signbit(bbData[maxIdx].x - 1.0f);
-            
-            // if the y-coord of the obb's min/max points are on opposite sides of the bottom view frustum plane
-            intersecting |= std::signbit(bbData[0].y + 1.0f) != std::signbit(bbData[maxIdx].y + 1.0f);
-            // if the y-coord of the obb's min/max points are on opposite sides of the top view frustum plane
-            intersecting |= std::signbit(bbData[0].y - 1.0f) != std::signbit(bbData[maxIdx].y - 1.0f);
-            
-            // if the x-coord of the obb's min/max points are on opposite sides of the near clip view frustum plane
-            intersecting |= std::signbit(bbData[0].z) != std::signbit(bbData[maxIdx].z);
-            // if the x-coord of the obb's min/max points are on opposite sides of the far clip view frustum plane
-            intersecting |= std::signbit(bbData[0].z - 1.0f) != std::signbit(bbData[maxIdx].z - 1.0f);
-            // Note: depth lies on [0, 1] in this engine!
-
-            if (intersecting) {
-                return true;
-            }
-
-            // TODO: resolve false positives?
-
-            return false;
+        bool Cull(const glm::mat4& worldMatrix, const BoundingSphereData& boundingSphere) const {
+            return GetFrustum().TestSphere(worldMatrix, boundingSphere);
         }
     };
 }
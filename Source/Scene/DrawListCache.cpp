@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "DrawListCache.h"
+#include "../Utils/RadixSort.h"
+
+namespace JoeEngine {
+    void JEDrawListCache::Reserve(uint32_t entityID) {
+        if (entityID >= m_listedKeys.size()) {
+            const size_t size = std::max((size_t)entityID + 1, m_listedKeys.size() * 2);
+            m_keys.resize(size, NOT_LISTED);
+            m_listedKeys.resize(size, NOT_LISTED);
+            m_visibleFrames.resize(size, 0);
+            // Entities not seen before have no key yet
+            m_dirtyFlags.resize(size, 1);
+        }
+    }
+
+    uint64_t JEDrawListCache::ComputeKey(uint32_t entityID, const PackedArray<MeshComponent>& meshComponents,
+                                         const PackedArray<MaterialComponent>& materialComponents) {
+        const int meshIdx = meshComponents.FindDataIndex(entityID);
+        const int materialIdx = materialComponents.FindDataIndex(entityID);
+        if (meshIdx < 0 || materialIdx < 0) {
+            return NOT_LISTED;
+        }
+
+        const MeshComponent& mesh = meshComponents.GetData()[meshIdx];
+        const MaterialComponent& material = materialComponents.GetData()[materialIdx];
+        if (mesh.GetVertexHandle() == -1 || mesh.GetIndexHandle() == -1) {
+            return NOT_LISTED;
+        }
+        if (material.m_renderLayer > 0xFFFF || material.m_shaderID > 0xFFFF || material.m_descriptorID > 0xFFFF ||
+            mesh.GetVertexHandle() > 0xFFFF) {
+            throw std::runtime_error("Draw sort key fields do not fit in 16 bits");
+        }
+
+        return ((uint64_t)material.m_renderLayer << 48) | ((uint64_t)material.m_shaderID << 32) |
+               ((uint64_t)material.m_descriptorID << 16) | (uint64_t)mesh.GetVertexHandle();
+    }
+
+    bool JEDrawListCache::IsBackToFront(uint64_t key) {
+        return (key >> 48) >= TRANSLUCENT;
+    }
+
+    bool JEDrawListCache::SortRunsByDepth() {
+        bool moved = false;
+
+        uint32_t runStart = 0;
+        while (runStart < m_entries.size()) {
+            uint32_t runEnd = runStart + 1;
+            while (runEnd < m_entries.size() && m_entries[runEnd].key == m_entries[runStart].key) {
+                ++runEnd;
+            }
+
+            // Opaque geometry front to back, translucent geometry back to front. Ties are broken by entity ID so that the order
+            // is stable from frame to frame.
+            const bool backToFront = IsBackToFront(m_entries[runStart].key);
+            const auto inOrder = [backToFront](const JEDrawListEntry& a, const JEDrawListEntry& b) {
+                if (a.depth != b.depth) {
+                    return backToFront ? a.depth > b.depth : a.depth < b.depth;
+                }
+                return a.entityID < b.entityID;
+            };
+
+            uint32_t numDescents = 0;
+            for (uint32_t i = runStart + 1; i < runEnd; ++i) {
+                numDescents += inOrder(m_entries[i], m_entries[i - 1]) ? 1 : 0;
+            }
+
+            if (numDescents > 0) {
+                moved = true;
+                if (numDescents <= JE_DRAW_LIST_MAX_INSERTIONS) {
+                    // Close to last frame's order
+                    for (uint32_t i = runStart + 1; i < runEnd; ++i) {
+                        const JEDrawListEntry entry = m_entries[i];
+                        uint32_t j = i;
+                        while (j > runStart && inOrder(entry, m_entries[j - 1])) {
+                            m_entries[j] = m_entries[j - 1];
+                            --j;
+                        }
+                        m_entries[j] = entry;
+                    }
+                } else {
+                    std::sort(m_entries.begin() + runStart, m_entries.begin() + runEnd, inOrder);
+                }
+            }
+
+            runStart = runEnd;
+        }
+
+        return moved;
+    }
+
+    void JEDrawListCache::BuildBatches() {
+        m_batches.clear();
+        for (uint32_t i = 0; i < m_entries.size(); ++i) {
+            if (i == 0 || m_entries[i].key != m_entries[i - 1].key) {
+                m_batches.push_back({ i, 1 });
+            } else {
+                ++m_batches.back().instanceCount;
+            }
+        }
+    }
+
+    void JEDrawListCache::Invalidate(uint32_t entityID) {
+        // Entities beyond the per-entity lists are already dirty once the lists grow to hold them
+        if (entityID < m_dirtyFlags.size()) {
+            m_dirtyFlags[entityID] = 1;
+        }
+    }
+
+    void JEDrawListCache::Invalidate(const std::vector<uint32_t>& entityIDs) {
+        for (uint32_t entityID : entityIDs) {
+            Invalidate(entityID);
+        }
+    }
+
+    bool JEDrawListCache::Update(const uint32_t* visibleIDs, const uint32_t* meshHandles, uint32_t count,
+                                 const PackedArray<MeshComponent>& meshComponents, const PackedArray<MaterialComponent>& materialComponents,
+                                 const JETransformStore& transformStore, const glm::mat4& viewMatrix, bool refreshDepths) {
+        ++m_frame;
+        bool changed = false;
+
+        // Stamp the visible entities, recompute the keys of the dirty ones and collect the entities that need a new entry
+        m_insertions.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t entityID = visibleIDs[i];
+            Reserve(entityID);
+            m_visibleFrames[entityID] = m_frame;
+
+            if (m_dirtyFlags[entityID]) {
+                m_dirtyFlags[entityID] = 0;
+                m_keys[entityID] = ComputeKey(entityID, meshComponents, materialComponents);
+                // Even with an unchanged key, the entity's components may differ
+                changed |= m_listedKeys[entityID] != NOT_LISTED;
+            }
+
+            if (meshHandles[i] > 0xFFFF) {
+                throw std::runtime_error("Draw sort key fields do not fit in 16 bits");
+            }
+
+            // Swap in the selected LOD for the full-detail mesh
+            const uint64_t key = m_keys[entityID] == NOT_LISTED ? NOT_LISTED : (m_keys[entityID] & ~0xFFFFull) | meshHandles[i];
+            if (key != m_listedKeys[entityID]) {
+                // Any old entry no longer matches the entity's key and is dropped below
+                m_listedKeys[entityID] = key;
+                if (key != NOT_LISTED) {
+                    m_insertions.push_back(entityID);
+                }
+            }
+        }
+
+        // Drop the entries of entities that are no longer visible or whose key (or LOD) changed
+        uint32_t numKept = 0;
+        for (uint32_t i = 0; i < m_entries.size(); ++i) {
+            const JEDrawListEntry& entry = m_entries[i];
+            if (m_visibleFrames[entry.entityID] != m_frame) {
+                m_listedKeys[entry.entityID] = NOT_LISTED;
+            } else if (entry.key == m_listedKeys[entry.entityID]) {
+                m_entries[numKept++] = entry;
+            }
+        }
+        changed |= numKept != m_entries.size();
+        m_entries.resize(numKept);
+
+        const auto viewDepth = [&](uint32_t entityID) {
+            return (viewMatrix * transformStore.GetWorldMatrix(entityID)[3]).z;
+        };
+
+        if (refreshDepths) {
+            for (JEDrawListEntry& entry : m_entries) {
+                entry.depth = viewDepth(entry.entityID);
+            }
+        }
+
+        if (!m_insertions.empty()) {
+            changed = true;
+            if (m_insertions.size() <= JE_DRAW_LIST_MAX_INSERTIONS) {
+                // Few new entries: insert each one after the existing entries with the same key
+                for (uint32_t entityID : m_insertions) {
+                    const JEDrawListEntry entry = { m_listedKeys[entityID], viewDepth(entityID), entityID };
+                    const auto pos = std::upper_bound(m_entries.begin(), m_entries.end(), entry.key,
+                                                      [](uint64_t key, const JEDrawListEntry& e) { return key < e.key; });
+                    m_entries.insert(pos, entry);
+                }
+            } else {
+                // Many new entries: append them and radix sort the whole list by key, which keeps equal keys in list order
+                for (uint32_t entityID : m_insertions) {
+                    m_entries.push_back({ m_listedKeys[entityID], viewDepth(entityID), entityID });
+                }
+
+                const uint32_t n = (uint32_t)m_entries.size();
+                m_sortKeys.resize(n);
+                m_sortValues.resize(n);
+                m_sortKeysTmp.resize(n);
+                m_sortValuesTmp.resize(n);
+                uint64_t maxKey = 0;
+                for (uint32_t i = 0; i < n; ++i) {
+                    m_sortKeys[i] = m_entries[i].key;
+                    m_sortValues[i] = i;
+                    maxKey = std::max(maxKey, m_entries[i].key);
+                }
+                RadixSortUtils::SortKeyValuePairs(m_sortKeys.data(), m_sortValues.data(), m_sortKeysTmp.data(), m_sortValuesTmp.data(),
+                                                  n, RadixSortUtils::NumBitsNeeded(maxKey));
+
+                m_sortedEntries.resize(n);
+                for (uint32_t i = 0; i < n; ++i) {
+                    m_sortedEntries[i] = m_entries[m_sortValues[i]];
+                }
+                m_entries.swap(m_sortedEntries);
+            }
+        }
+
+        if (refreshDepths || !m_insertions.empty()) {
+            changed |= SortRunsByDepth();
+        }
+
+        if (changed) {
+            BuildBatches();
+            ++m_version;
+        }
+        return changed;
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "../Components/Mesh/MeshComponent.h"
+#include "../Components/Material/MaterialComponent.h"
+#include "../Components/Transform/TransformStore.h"
+#include "../Containers/PackedArray.h"
+
+namespace JoeEngine {
+    //! Largest number of entities inserted into the draw list one by one. Larger deltas append and re-sort the whole list.
+    constexpr uint32_t JE_DRAW_LIST_MAX_INSERTIONS = 64;
+
+    //! Instanced draw batch.
+    /*! A run of consecutive draw list entries that share the same render layer, shader, descriptor and mesh. */
+    typedef struct je_draw_batch_t {
+        //! Index of the batch's first entry in the draw list, which is also its first instance in the transform list.
+        uint32_t firstInstance;
+
+        //! Number of entries in the batch.
+        uint32_t instanceCount;
+    } JEDrawBatch;
+
+    //! The Draw List Cache class
+    /*!
+      Persistent, sorted list of the visible meshes, kept between frames so that the draw order does not need to be rebuilt and
+      re-sorted from scratch every frame.
+      Each entry is keyed by its entity's material and mesh: render layer | shader | descriptor | mesh, 16 bits each. An entity's
+      key is only recomputed after it was passed to Invalidate(), i.e. after its mesh or material component was added, set or
+      removed, except for the mesh field, which holds the mesh LOD selected for the current frame so that instances drawn with
+      the same LOD are batched together. Every frame, entries that are no longer visible (or whose key changed) are dropped and newly visible entities are
+      inserted, with a binary search when there are few of them or by appending and radix sorting the whole list otherwise.
+      Within each run of equal keys, entries are ordered by view depth - opaque front to back, translucent back to front - and
+      re-ordered with an insertion sort whenever the view or the transforms change, which is cheap as the order is usually
+      close to the previous frame's.
+      Runs of equal keys are emitted directly as instanced draw batches.
+      \sa JEEngineInstance, JEDrawBatch
+    */
+    class JEDrawListCache {
+    private:
+        //! Draw list entry.
+        typedef struct je_draw_list_entry_t {
+            //! Material and mesh sort key.
+            uint64_t key;
+
+            //! View-space z of the entity's origin, which grows away from the (left-handed) camera.
+            float depth;
+
+            //! Entity ID.
+            uint32_t entityID;
+        } JEDrawListEntry;
+
+        //! Key value of entities that are not in the draw list.
+        static constexpr uint64_t NOT_LISTED = ~0ull;
+
+        //! Sorted draw list.
+        std::vector<JEDrawListEntry> m_entries;
+
+        //! Instanced draw batches of the draw list.
+        std::vector<JEDrawBatch> m_batches;
+
+        //! Key of each entity with its full-detail mesh, or NOT_LISTED if it has nothing to draw. Only valid if the entity is not
+        //! dirty. Indexed by entity ID.
+        std::vector<uint64_t> m_keys;
+
+        //! Key of each entity's draw list entry, or NOT_LISTED if it has none. Indexed by entity ID.
+        std::vector<uint64_t> m_listedKeys;
+
+        //! Frame number of the last Update() in which each entity was visible. Indexed by entity ID.
+        std::vector<uint32_t> m_visibleFrames;
+
+        //! Whether each entity's key must be recomputed. Indexed by entity ID.
+        std::vector<uint8_t> m_dirtyFlags;
+
+        //! Entity IDs to insert during the current Update().
+        std::vector<uint32_t> m_insertions;
+
+        //! Radix sort scratch lists.
+        std::vector<uint64_t> m_sortKeys;
+        std::vector<uint32_t> m_sortValues;
+        std::vector<uint64_t> m_sortKeysTmp;
+        std::vector<uint32_t> m_sortValuesTmp;
+        std::vector<JEDrawListEntry> m_sortedEntries;
+
+        //! Number of calls to Update().
+        uint32_t m_frame;
+
+        //! Version number. Incremented whenever the draw list changes.
+        uint64_t m_version;
+
+        //! Grow the per-entity lists to hold the specified entity ID.
+        void Reserve(uint32_t entityID);
+
+        //! Compute the sort key of an entity, or NOT_LISTED if it has nothing to draw.
+        static uint64_t ComputeKey(uint32_t entityID, const PackedArray<MeshComponent>& meshComponents,
+                                   const PackedArray<MaterialComponent>& materialComponents);
+
+        //! Whether an entry with the specified key is drawn back to front.
+        static bool IsBackToFront(uint64_t key);
+
+        //! Sort each run of equal keys by view depth.
+        /*! \return true if any entry moved. */
+        bool SortRunsByDepth();
+
+        //! Rebuild the instanced draw batches from the runs of equal keys.
+        void BuildBatches();
+
+    public:
+        //! Default constructor.
+        JEDrawListCache() : m_frame(0), m_version(0) {}
+
+        //! Destructor (default).
+        ~JEDrawListCache() = default;
+
+        JEDrawListCache(const JEDrawListCache& cache) = delete;
+        JEDrawListCache& operator=(const JEDrawListCache& cache) = delete;
+
+        //! Mark an entity's sort key as out of date.
+        /*! \param entityID the entity whose mesh or material component was added, set or removed. */
+        void Invalidate(uint32_t entityID);
+
+        //! Mark the sort keys of a list of entities as out of date.
+        /*! \param entityIDs the entities whose mesh or material component was added, set or removed. May contain duplicates. */
+        void Invalidate(const std::vector<uint32_t>& entityIDs);
+
+        //! Update the draw list for the current frame's visible entities.
+        /*!
+          \param visibleIDs the IDs of the entities that passed culling, in any order.
+          \param meshHandles the handle of the mesh LOD to draw each visible entity with, parallel to 'visibleIDs'.
+          \param count the number of entries in 'visibleIDs'.
+          \param meshComponents the mesh components of all entities.
+          \param materialComponents the material components of all entities.
+          \param transformStore the transforms of all entities.
+          \param viewMatrix the camera view matrix.
+          \param refreshDepths whether the view matrix or any transform changed since the last update. The depths of entries
+          that were not just inserted are only recomputed if this is set.
+          \return true if the draw list (its entries, their order, or the components of any entry) changed.
+        */
+        bool Update(const uint32_t* visibleIDs, const uint32_t* meshHandles, uint32_t count,
+                    const PackedArray<MeshComponent>& meshComponents, const PackedArray<MaterialComponent>& materialComponents,
+                    const JETransformStore& transformStore, const glm::mat4& viewMatrix, bool refreshDepths);
+
+        //! Get the number of entries in the draw list.
+        uint32_t Size() const {
+            return (uint32_t)m_entries.size();
+        }
+
+        //! Get the entity ID of a draw list entry.
+        uint32_t GetEntityAt(uint32_t index) const {
+            return m_entries[index].entityID;
+        }
+
+        //! Get the handle of the mesh LOD a draw list entry is drawn with.
+        uint32_t GetMeshAt(uint32_t index) const {
+            return (uint32_t)(m_entries[index].key & 0xFFFF);
+        }
+
+        //! Get the instanced draw batches, in draw list order.
+        const std::vector<JEDrawBatch>& GetBatches() const {
+            return m_batches;
+        }
+
+        //! Get the version number, incremented whenever Update() returns true.
+        uint64_t GetVersion() const {
+            return m_version;
+        }
+    };
+}
@@ -6,20 +6,28 @@ namespace JoeEngine {
     //! The Entity class.
     /*!
       Conceptually, an entity is just an index. This is the crux of the data-oriented design of the entity-component
-      system of the Joe Engine. There is no other information stored within an Entity.
+      system of the Joe Engine. There is no other information stored within an Entity, other than a generation number.
+      Entity indices are recycled once an entity is destroyed, so the generation number is used to tell a handle to a live
+      entity apart from a stale handle to a previously destroyed entity that used the same index.
+      \sa JEEntityManager
     */
     class Entity {
     private:
         //! Entity id.
+        /*! The index used to look up the entity's components. */
         uint32_t m_id;
 
+        //! Entity generation.
+        /*! The number of times the index had been recycled when this entity was spawned. */
+        uint32_t m_generation;
+
     public:
         //! Default constructor (deleted).
         Entity() = delete;
 
         //! Constructor.
-        /*! Requires an id. */
-        Entity(uint32_t id) : m_id(id) {}
+        /*! Requires an id and generation. */
+        Entity(uint32_t id, uint32_t generation) : m_id(id), m_generation(generation) {}
 
         //! Destructor (default).
         ~Entity() = default;
@@ -28,5 +36,20 @@ namespace JoeEngine {
         uint32_t GetId() const {
             return m_id;
         }
+
+        //! Get entity generation.
+        uint32_t GetGeneration() const {
+            return m_generation;
+        }
+
+        //! Check whether two handles refer to the same entity.
+        bool operator==(const Entity& other) const {
+            return m_id == other.m_id && m_generation == other.m_generation;
+        }
+
+        //! Check whether two handles refer to different entities.
+        bool operator!=(const Entity& other) const {
+            return !(*this == other);
+        }
     };
 }
@@ -1,13 +1,52 @@
+#include <algorithm>
+
 #include "EntityManager.h"
 
 namespace JoeEngine {
     Entity JEEntityManager::SpawnEntity() {
-        Entity newEntity(m_idCounter++);
+        uint32_t id;
+        if (m_freeIndices.empty()) {
+            id = (uint32_t)m_generations.size();
+            m_generations.push_back(0);
+        } else {
+            id = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        }
+
+        Entity newEntity(id, m_generations[id]);
         m_entities.AddElement(newEntity.GetId(), newEntity);
         return newEntity;
     }
 
-    void JEEntityManager::DestroyEntity(Entity e) {
+    void JEEntityManager::SpawnEntities(uint32_t count, std::vector<Entity>& entities) {
+        const uint32_t numRecycled = std::min(count, (uint32_t)m_freeIndices.size());
+        const uint32_t numNew = count - numRecycled;
+        m_entities.Reserve(m_entities.Size() + count, (uint32_t)m_generations.size() + numNew);
+        entities.reserve(entities.size() + count);
+
+        for (uint32_t i = 0; i < numRecycled; ++i) {
+            const uint32_t id = m_freeIndices.back();
+            m_freeIndices.pop_back();
+            entities.emplace_back(id, m_generations[id]);
+            m_entities.AddElement(id, entities.back());
+        }
+
+        const uint32_t firstNewID = (uint32_t)m_generations.size();
+        m_generations.resize(firstNewID + numNew, 0);
+        for (uint32_t id = firstNewID; id < firstNewID + numNew; ++id) {
+            entities.emplace_back(id, 0);
+            m_entities.AddElement(id, entities.back());
+        }
+    }
+
+    bool JEEntityManager::DestroyEntity(Entity e) {
+        if (!IsAlive(e)) {
+            return false;
+        }
+
         m_entities.RemoveElement(e.GetId());
+        ++m_generations[e.GetId()];
+        m_freeIndices.push_back(e.GetId());
+        return true;
     }
 }
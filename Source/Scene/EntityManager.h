@@ -1,25 +1,34 @@
 #pragma once
 
+#include <vector>
+
 #include "Entity.h"
 #include "../Containers/PackedArray.h"
 
 namespace JoeEngine {
     //! The Entity Manager class.
     /*!
-      Class that manages the list of active entities in the scene. Currently, this class is not actually vital.
+      Class that manages the list of active entities in the scene. Hands out generational entity handles and recycles the
+      indices of destroyed entities, so that the indirection maps of every packed array stay at the size of the peak live
+      population rather than growing with every entity ever spawned.
     */
     class JEEntityManager {
     private:
-        //! Counts the number of entities to know the next valid entity id to use upon spawning.
-        uint32_t m_idCounter;
+        //! Generation of each entity index.
+        /*! Incremented every time the entity at that index is destroyed, which invalidates any handles still referring to it. */
+        std::vector<uint32_t> m_generations;
+
+        //! Free list of entity indices.
+        /*! Indices of destroyed entities, ready to be reused by the next spawned entities. */
+        std::vector<uint32_t> m_freeIndices;
 
         //! List of entities.
         PackedArray<Entity> m_entities;
 
     public:
         //! Constructor.
-        /*! Initializes counter to zero. */
-        JEEntityManager() : m_idCounter(0), m_entities() {}
+        /*! No specific behavior. */
+        JEEntityManager() : m_generations(), m_freeIndices(), m_entities() {}
 
         //! Destructor (default).
         ~JEEntityManager() = default;
@@ -30,15 +39,35 @@ namespace JoeEngine {
         JEEntityManager& operator=(JEEntityManager&& mgr) = delete;*/
 
         //! Spawn entity.
-        /*! Adds an entity to the list and increments the id counter. */
+        /*! Adds an entity to the list, reusing a previously destroyed entity's index if one is available. */
         Entity SpawnEntity();
 
+        //! Spawn entities.
+        /*!
+          Spawns a batch of entities, reserving storage once. Recycled indices are used first.
+          \param count the number of entities to spawn.
+          \param entities the list to append the new entities to.
+        */
+        void SpawnEntities(uint32_t count, std::vector<Entity>& entities);
+
         //! Destroy entity.
-        /*! Removes a specific entity from the list. */
-        void DestroyEntity(Entity e);
+        /*!
+          Removes a specific entity from the list and recycles its index. Stale handles (already destroyed entities) are ignored.
+          \return true if the entity was alive and has been destroyed, false otherwise.
+        */
+        bool DestroyEntity(Entity e);
+
+        //! Check whether an entity handle refers to a live entity.
+        /*!
+          \param e the entity handle to check.
+          \return true if the entity has been spawned and not destroyed since, false otherwise.
+        */
+        bool IsAlive(const Entity& e) const {
+            return e.GetId() < m_generations.size() && m_generations[e.GetId()] == e.GetGeneration();
+        }
 
         //! Get current number of entities.
-        uint32_t NumEntities() {
+        uint32_t NumEntities() const {
             return m_entities.Size();
         }
     };
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+#include "glm/glm.hpp"
+
+#include "../Rendering/MeshBufferManager.h"
+
+namespace JoeEngine {
+    //! The JEFrustum class.
+    /*!
+      World-space view frustum, stored as six planes extracted from a view-projection matrix, plus its corners and edges.
+      No test rejects a volume that intersects the frustum. Box tests are exact separating axis tests: the frustum planes
+      first, then the box faces and edge cross products, which reject boxes near a frustum edge or corner that are outside the
+      frustum but not fully behind any single plane. Sphere tests only test the planes, so they can still accept such spheres.
+      \sa JECamera, JEFrustumCuller
+    */
+    class JEFrustum {
+    private:
+        //! Frustum planes in the order left, right, bottom, top, near, far.
+        /*! Stored as (normal, distance) with normalized normals pointing into the frustum. */
+        std::array<glm::vec4, 6> m_planes;
+
+        //! Frustum corners in world space.
+        /*! Bit 0 of the index selects the right side, bit 1 the top and bit 2 the far plane. */
+        std::array<glm::vec3, 8> m_corners;
+
+        //! Frustum edge directions: horizontal, vertical and the four edges from the near to the far plane.
+        std::array<glm::vec3, 6> m_edges;
+
+    public:
+        //! Default constructor (deleted).
+        JEFrustum() = delete;
+
+        //! Constructor.
+        /*!
+          Extracts the frustum planes and corners from a view-projection matrix. Clip space is expected to be -w <= x, y <= w
+          and 0 <= z <= w, as in the rest of the engine.
+          \param viewProj the view-projection matrix.
+        */
+        explicit JEFrustum(const glm::mat4& viewProj) {
+            const glm::vec4 row0 = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+            const glm::vec4 row1 = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+            const glm::vec4 row2 = glm::vec4(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+            const glm::vec4 row3 = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+            m_planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+            for (glm::vec4& plane : m_planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+
+            const glm::mat4 invViewProj = glm::inverse(viewProj);
+            for (uint32_t i = 0; i < 8; ++i) {
+                const glm::vec4 cornerCS = glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f);
+                const glm::vec4 corner = invViewProj * cornerCS;
+                m_corners[i] = glm::vec3(corner) / corner.w;
+            }
+            m_edges = { m_corners[1] - m_corners[0], m_corners[2] - m_corners[0], m_corners[4] - m_corners[0],
+                        m_corners[5] - m_corners[1], m_corners[6] - m_corners[2], m_corners[7] - m_corners[3] };
+        }
+
+        //! Destructor (default).
+        ~JEFrustum() = default;
+
+        //! Get the frustum planes.
+        /*!
+          Planes are in the order left, right, bottom, top, near, far, stored as (normal, distance) with normalized normals
+          pointing into the frustum, so a point p is inside a plane if dot(normal, p) + distance >= 0.
+        */
+        const std::array<glm::vec4, 6>& GetPlanes() const {
+            return m_planes;
+        }
+
+        //! Get the frustum corners in world space.
+        const std::array<glm::vec3, 8>& GetCorners() const {
+            return m_corners;
+        }
+
+        //! Test a sphere against the frustum.
+        /*!
+          \param center the world-space sphere center.
+          \param radius the sphere radius.
+          \return false if the sphere is entirely behind one of the frustum planes, true otherwise.
+        */
+        bool TestSphere(const glm::vec3& center, float radius) const {
+            for (const glm::vec4& plane : m_planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //! Test an axis-aligned box against the frustum.
+        /*!
+          \param center the world-space box center.
+          \param extents the box half extents.
+          \return false if the box does not intersect the frustum, true otherwise.
+        */
+        bool TestAABB(const glm::vec3& center, const glm::vec3& extents) const {
+            for (const glm::vec4& plane : m_planes) {
+                const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+
+            // The box may still be outside the frustum near one of its edges
+            return TestBoxAxes(center, glm::vec3(extents.x, 0.0f, 0.0f), glm::vec3(0.0f, extents.y, 0.0f), glm::vec3(0.0f, 0.0f, extents.z));
+        }
+
+        //! Test a box against the frustum along the box face normals and the box/frustum edge cross products.
+        /*!
+          The remaining separating axes after the frustum planes: together with the plane tests, this is a complete separating
+          axis test, so a box that passes both intersects the frustum. The box may be any parallelepiped, e.g. a bounding box
+          under an affine world transformation.
+          \param center the world-space box center.
+          \param axisX the box half axis along its local x axis (world-space, scaled by the half extent).
+          \param axisY the box half axis along its local y axis.
+          \param axisZ the box half axis along its local z axis.
+          \return false if one of the axes separates the box from the frustum, true otherwise.
+        */
+        bool TestBoxAxes(const glm::vec3& center, const glm::vec3& axisX, const glm::vec3& axisY, const glm::vec3& axisZ) const {
+            const glm::vec3 axes[3] = { axisX, axisY, axisZ };
+            const auto separates = [&](const glm::vec3& axis) {
+                const float boxCenter = glm::dot(center, axis);
+                const float boxRadius = std::abs(glm::dot(axisX, axis)) + std::abs(glm::dot(axisY, axis)) + std::abs(glm::dot(axisZ, axis));
+                float frustumMin = FLT_MAX;
+                float frustumMax = -FLT_MAX;
+                for (const glm::vec3& corner : m_corners) {
+                    const float dist = glm::dot(corner, axis);
+                    frustumMin = std::min(frustumMin, dist);
+                    frustumMax = std::max(frustumMax, dist);
+                }
+                return boxCenter + boxRadius < frustumMin || boxCenter - boxRadius > frustumMax;
+            };
+
+            for (int a = 0; a < 3; ++a) {
+                // Box face normal
+                if (separates(glm::cross(axes[(a + 1) % 3], axes[(a + 2) % 3]))) {
+                    return false;
+                }
+                for (const glm::vec3& edge : m_edges) {
+                    if (separates(glm::cross(axes[a], edge))) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        //! Test a transformed bounding box against the frustum.
+        /*!
+          The box is tested as the oriented box it becomes under the world transformation, not as its world-space
+          axis-aligned bounds.
+          \param worldMatrix the world transformation of the bounding box.
+          \param boundingBox the bounding box data.
+          \return false if the box does not intersect the frustum, true otherwise.
+        */
+        bool TestBox(const glm::mat4& worldMatrix, const BoundingBoxData& boundingBox) const {
+            const glm::vec3 localCenter = (boundingBox[0] + boundingBox[7]) * 0.5f;
+            const glm::vec3 localExtents = (boundingBox[7] - boundingBox[0]) * 0.5f;
+            const glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(localCenter, 1.0f));
+            const glm::vec3 axisX = glm::vec3(worldMatrix[0]) * localExtents.x;
+            const glm::vec3 axisY = glm::vec3(worldMatrix[1]) * localExtents.y;
+            const glm::vec3 axisZ = glm::vec3(worldMatrix[2]) * localExtents.z;
+
+            for (const glm::vec4& plane : m_planes) {
+                const glm::vec3 normal = glm::vec3(plane);
+                const float radius = std::abs(glm::dot(normal, axisX)) + std::abs(glm::dot(normal, axisY)) + std::abs(glm::dot(normal, axisZ));
+                if (glm::dot(normal, center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return TestBoxAxes(center, axisX, axisY, axisZ);
+        }
+
+        //! Test a box swept along a direction against the frustum planes.
+        /*!
+          The box is extruded without bound along the direction, as the shadow volume of a shadow caster under a directional
+          light. Only the frustum planes are tested, so the test never rejects a swept box that intersects the frustum but may
+          accept one that passes close to a frustum edge.
+          \param center the world-space box center.
+          \param axisX the box half axis along its local x axis (world-space, scaled by the half extent).
+          \param axisY the box half axis along its local y axis.
+          \param axisZ the box half axis along its local z axis.
+          \param direction the sweep direction.
+          \return false if the swept box is entirely behind one of the frustum planes, true otherwise.
+        */
+        bool TestSweptBox(const glm::vec3& center, const glm::vec3& axisX, const glm::vec3& axisY, const glm::vec3& axisZ,
+                          const glm::vec3& direction) const {
+            for (const glm::vec4& plane : m_planes) {
+                const glm::vec3 normal = glm::vec3(plane);
+
+                // Sweeping towards the inside of a plane eventually crosses it
+                if (glm::dot(normal, direction) > 0.0f) {
+                    continue;
+                }
+                const float radius = std::abs(glm::dot(normal, axisX)) + std::abs(glm::dot(normal, axisY)) + std::abs(glm::dot(normal, axisZ));
+                if (glm::dot(normal, center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //! Test a transformed bounding sphere against the frustum.
+        /*!
+          Non-uniform scales grow the sphere by the largest axis scale.
+          \param worldMatrix the world transformation of the bounding sphere.
+          \param boundingSphere the bounding sphere data.
+          \return false if the sphere is entirely behind one of the frustum planes, true otherwise.
+        */
+        bool TestSphere(const glm::mat4& worldMatrix, const BoundingSphereData& boundingSphere) const {
+            const float maxScale = std::sqrt(std::max(glm::dot(glm::vec3(worldMatrix[0]), glm::vec3(worldMatrix[0])),
+                                             std::max(glm::dot(glm::vec3(worldMatrix[1]), glm::vec3(worldMatrix[1])),
+                                                      glm::dot(glm::vec3(worldMatrix[2]), glm::vec3(worldMatrix[2])))));
+            return TestSphere(glm::vec3(worldMatrix * glm::vec4(boundingSphere.center, 1.0f)), boundingSphere.radius * maxScale);
+        }
+    };
+}
@@ -0,0 +1,214 @@
+#include "JoeEngineConfig.h"
+
+#ifndef JOE_ENGINE_SIMD_NONE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "FrustumCuller.h"
+#include "../Utils/ParallelFor.h"
+
+namespace JoeEngine {
+    void JEFrustumCuller::CullRange(JECullingJobData* job) {
+        const JEFrustum& frustum = *job->frustum;
+        const std::array<glm::vec4, 6>& planes = frustum.GetPlanes();
+        std::vector<uint32_t>& survivors = *job->survivors;
+        survivors.clear();
+
+        for (uint32_t i = job->startIdx; i < job->endIdx; i += 8) {
+            const uint32_t n = std::min(8u, job->endIdx - i);
+
+            // World-space oriented box of each object, as center and half axes, and its world-space bounding sphere
+            alignas(32) float cx[8] = {};
+            alignas(32) float cy[8] = {};
+            alignas(32) float cz[8] = {};
+            alignas(32) float axisXx[8] = {};
+            alignas(32) float axisXy[8] = {};
+            alignas(32) float axisXz[8] = {};
+            alignas(32) float axisYx[8] = {};
+            alignas(32) float axisYy[8] = {};
+            alignas(32) float axisYz[8] = {};
+            alignas(32) float axisZx[8] = {};
+            alignas(32) float axisZy[8] = {};
+            alignas(32) float axisZz[8] = {};
+            alignas(32) float sx[8] = {};
+            alignas(32) float sy[8] = {};
+            alignas(32) float sz[8] = {};
+            alignas(32) float sr[8] = {};
+            uint32_t validMask = 0;
+            for (uint32_t l = 0; l < n; ++l) {
+                const MeshComponent& meshComp = job->meshComponents[i + l];
+                if (meshComp.GetVertexHandle() == -1 || meshComp.GetIndexHandle() == -1) {
+                    continue;
+                }
+                validMask |= 1u << l;
+
+                const BoundingBoxData& boundingBox = job->boundingBoxes[meshComp.GetVertexHandle()];
+                const BoundingSphereData& boundingSphere = job->boundingSpheres[meshComp.GetVertexHandle()];
+                const glm::vec3 localCenter = (boundingBox[0] + boundingBox[7]) * 0.5f;
+                const glm::vec3 localExtents = (boundingBox[7] - boundingBox[0]) * 0.5f;
+
+                const glm::mat4& m = *job->worldMatrices[i + l];
+                const glm::vec3 center = glm::vec3(m * glm::vec4(localCenter, 1.0f));
+                const glm::vec3 axisX = glm::vec3(m[0]) * localExtents.x;
+                const glm::vec3 axisY = glm::vec3(m[1]) * localExtents.y;
+                const glm::vec3 axisZ = glm::vec3(m[2]) * localExtents.z;
+                cx[l] = center.x;
+                cy[l] = center.y;
+                cz[l] = center.z;
+                axisXx[l] = axisX.x;
+                axisXy[l] = axisX.y;
+                axisXz[l] = axisX.z;
+                axisYx[l] = axisY.x;
+                axisYy[l] = axisY.y;
+                axisYz[l] = axisY.z;
+                axisZx[l] = axisZ.x;
+                axisZy[l] = axisZ.y;
+                axisZz[l] = axisZ.z;
+
+                const glm::vec3 sphereCenter = glm::vec3(m * glm::vec4(boundingSphere.center, 1.0f));
+                const float maxScale2 = std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                        std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))));
+                sx[l] = sphereCenter.x;
+                sy[l] = sphereCenter.y;
+                sz[l] = sphereCenter.z;
+                sr[l] = boundingSphere.radius * std::sqrt(maxScale2);
+            }
+
+            // An object is outside if its box or its sphere is entirely behind one of the planes. For the box, that means
+            // the box's projected radius onto the plane normal is less than the center's distance behind the plane.
+            uint32_t insideMask = 0;
+            #ifdef JOE_ENGINE_SIMD_AVX2
+            {
+                const __m256 centerX = _mm256_load_ps(cx);
+                const __m256 centerY = _mm256_load_ps(cy);
+                const __m256 centerZ = _mm256_load_ps(cz);
+                const __m256 aXx = _mm256_load_ps(axisXx);
+                const __m256 aXy = _mm256_load_ps(axisXy);
+                const __m256 aXz = _mm256_load_ps(axisXz);
+                const __m256 aYx = _mm256_load_ps(axisYx);
+                const __m256 aYy = _mm256_load_ps(axisYy);
+                const __m256 aYz = _mm256_load_ps(axisYz);
+                const __m256 aZx = _mm256_load_ps(axisZx);
+                const __m256 aZy = _mm256_load_ps(axisZy);
+                const __m256 aZz = _mm256_load_ps(axisZz);
+                const __m256 sphereX = _mm256_load_ps(sx);
+                const __m256 sphereY = _mm256_load_ps(sy);
+                const __m256 sphereZ = _mm256_load_ps(sz);
+                const __m256 sphereR = _mm256_load_ps(sr);
+                const __m256 zero = _mm256_setzero_ps();
+                const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+                __m256 outside = zero;
+                for (uint32_t p = 0; p < 6; ++p) {
+                    const __m256 nx = _mm256_set1_ps(planes[p].x);
+                    const __m256 ny = _mm256_set1_ps(planes[p].y);
+                    const __m256 nz = _mm256_set1_ps(planes[p].z);
+                    const __m256 d = _mm256_set1_ps(planes[p].w);
+
+                    const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, centerX), _mm256_mul_ps(ny, centerY)),
+                                                      _mm256_add_ps(_mm256_mul_ps(nz, centerZ), d));
+                    const __m256 projX = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, aXx), _mm256_mul_ps(ny, aXy)), _mm256_mul_ps(nz, aXz));
+                    const __m256 projY = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, aYx), _mm256_mul_ps(ny, aYy)), _mm256_mul_ps(nz, aYz));
+                    const __m256 projZ = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, aZx), _mm256_mul_ps(ny, aZy)), _mm256_mul_ps(nz, aZz));
+                    const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, projX), _mm256_andnot_ps(signMask, projY)),
+                                                        _mm256_andnot_ps(signMask, projZ));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero, _CMP_LT_OQ));
+
+                    const __m256 sphereDist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, sphereX), _mm256_mul_ps(ny, sphereY)),
+                                                            _mm256_add_ps(_mm256_mul_ps(nz, sphereZ), d));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(sphereDist, sphereR), zero, _CMP_LT_OQ));
+                }
+                insideMask = ~(uint32_t)_mm256_movemask_ps(outside) & validMask;
+            }
+            #else
+            for (uint32_t l = 0; l < n; ++l) {
+                bool outside = false;
+                for (uint32_t p = 0; p < 6 && !outside; ++p) {
+                    const glm::vec4& plane = planes[p];
+                    const float dist = plane.x * cx[l] + plane.y * cy[l] + plane.z * cz[l] + plane.w;
+                    const float radius = std::abs(plane.x * axisXx[l] + plane.y * axisXy[l] + plane.z * axisXz[l]) +
+                                         std::abs(plane.x * axisYx[l] + plane.y * axisYy[l] + plane.z * axisYz[l]) +
+                                         std::abs(plane.x * axisZx[l] + plane.y * axisZy[l] + plane.z * axisZz[l]);
+                    const float sphereDist = plane.x * sx[l] + plane.y * sy[l] + plane.z * sz[l] + plane.w;
+                    outside = dist + radius < 0.0f || sphereDist + sr[l] < 0.0f;
+                }
+                insideMask |= (uint32_t)!outside << l;
+            }
+            insideMask &= validMask;
+            #endif
+
+            // Boxes that pass every plane can still be outside near a frustum edge or corner
+            for (uint32_t l = 0; l < n; ++l) {
+                if (!(insideMask & (1u << l))) {
+                    continue;
+                }
+                const glm::vec3 center = glm::vec3(cx[l], cy[l], cz[l]);
+                const glm::vec3 axisX = glm::vec3(axisXx[l], axisXy[l], axisXz[l]);
+                const glm::vec3 axisY = glm::vec3(axisYx[l], axisYy[l], axisYz[l]);
+                const glm::vec3 axisZ = glm::vec3(axisZx[l], axisZy[l], axisZz[l]);
+                if (frustum.TestBoxAxes(center, axisX, axisY, axisZ) &&
+                    (!job->receiverFrustum || job->receiverFrustum->TestSweptBox(center, axisX, axisY, axisZ, job->sweepDirection))) {
+                    survivors.push_back(i + l);
+                }
+            }
+        }
+    }
+
+    uint32_t JEFrustumCuller::RunJobs(const JEFrustum& frustum, const JEFrustum* receiverFrustum, const glm::vec3& sweepDirection,
+                                      const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, uint32_t count,
+                                      const std::vector<BoundingBoxData>& boundingBoxes,
+                                      const std::vector<BoundingSphereData>& boundingSpheres, uint32_t* survivors) {
+        if (count == 0) {
+            return 0;
+        }
+
+        const uint32_t numJobs = (count + JE_CULLING_JOB_SIZE - 1) / JE_CULLING_JOB_SIZE;
+        if (numJobs > m_jobSurvivors.size()) {
+            m_jobSurvivors.resize(numJobs);
+        }
+
+        ParallelUtils::ParallelFor(0, count, JE_CULLING_JOB_SIZE, [&](uint32_t startIdx, uint32_t endIdx) {
+            JECullingJobData job;
+            job.frustum = &frustum;
+            job.receiverFrustum = receiverFrustum;
+            job.sweepDirection = sweepDirection;
+            job.meshComponents = meshComponents;
+            job.worldMatrices = worldMatrices;
+            job.boundingBoxes = boundingBoxes.data();
+            job.boundingSpheres = boundingSpheres.data();
+            job.startIdx = startIdx;
+            job.endIdx = endIdx;
+            job.survivors = &m_jobSurvivors[startIdx / JE_CULLING_JOB_SIZE];
+            CullRange(&job);
+        });
+
+        // Merge the jobs' output in job order
+        uint32_t numSurvivors = 0;
+        for (uint32_t j = 0; j < numJobs; ++j) {
+            const std::vector<uint32_t>& jobSurvivors = m_jobSurvivors[j];
+            if (!jobSurvivors.empty()) {
+                std::memcpy(survivors + numSurvivors, jobSurvivors.data(), jobSurvivors.size() * sizeof(uint32_t));
+            }
+            numSurvivors += (uint32_t)jobSurvivors.size();
+        }
+        return numSurvivors;
+    }
+
+    uint32_t JEFrustumCuller::Cull(const JEFrustum& frustum, const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices,
+                                   uint32_t count, const std::vector<BoundingBoxData>& boundingBoxes,
+                                   const std::vector<BoundingSphereData>& boundingSpheres, uint32_t* survivors) {
+        return RunJobs(frustum, nullptr, glm::vec3(0.0f), meshComponents, worldMatrices, count, boundingBoxes, boundingSpheres, survivors);
+    }
+
+    uint32_t JEFrustumCuller::CullShadowCasters(const JEFrustum& lightFrustum, const JEFrustum& cameraFrustum, const glm::vec3& lightDirection,
+                                                const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, uint32_t count,
+                                                const std::vector<BoundingBoxData>& boundingBoxes,
+                                                const std::vector<BoundingSphereData>& boundingSpheres, uint32_t* survivors) {
+        return RunJobs(lightFrustum, &cameraFrustum, lightDirection, meshComponents, worldMatrices, count, boundingBoxes,
+                       boundingSpheres, survivors);
+    }
+}
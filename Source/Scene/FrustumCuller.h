@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "Frustum.h"
+
+namespace JoeEngine {
+    //! Number of objects per frustum culling thread job.
+    constexpr uint32_t JE_CULLING_JOB_SIZE = 4096;
+
+    //! The Frustum Culler class
+    /*!
+      Frustum culling stage for the frame's drawable objects. The object range is split into jobs of JE_CULLING_JOB_SIZE objects
+      with ParallelUtils::ParallelFor(). Each job transforms every object's mesh bounding box and bounding sphere to world space
+      and tests 8 objects at a time against the six frustum planes (with AVX2 if available). Objects that pass finish the
+      separating axis test of JEFrustum, which rejects boxes near frustum edges, so culling is exact for the bounding boxes.
+      Shadow casters are culled the same way against the light's view volume, and additionally by whether their bounding box
+      swept along the light direction reaches the camera frustum.
+      Each job writes its survivors into its own output list. The lists are then merged in job order, so survivors come out in
+      input order.
+      Output lists are kept between frames, so culling does not allocate in steady state.
+      \sa JEFrustum, JEEngineInstance
+    */
+    class JEFrustumCuller {
+    private:
+        //! Culling job data.
+        typedef struct je_culling_job_data_t {
+            //! Frustum to test against.
+            const JEFrustum* frustum;
+
+            //! Optional frustum the objects' swept boxes must also reach, or nullptr.
+            const JEFrustum* receiverFrustum;
+
+            //! Sweep direction of the boxes tested against 'receiverFrustum'.
+            glm::vec3 sweepDirection;
+
+            //! Mesh of each object.
+            const MeshComponent* meshComponents;
+
+            //! World matrix of each object.
+            const glm::mat4* const* worldMatrices;
+
+            //! Mesh bounding boxes, indexed by vertex buffer handle.
+            const BoundingBoxData* boundingBoxes;
+
+            //! Mesh bounding spheres, indexed by vertex buffer handle.
+            const BoundingSphereData* boundingSpheres;
+
+            //! First object of this job.
+            uint32_t startIdx;
+
+            //! One past the last object of this job.
+            uint32_t endIdx;
+
+            //! Output list of the indices of objects that passed culling.
+            std::vector<uint32_t>* survivors;
+        } JECullingJobData;
+
+        //! Per-job survivor lists.
+        std::vector<std::vector<uint32_t>> m_jobSurvivors;
+
+        //! Cull a range of objects.
+        static void CullRange(JECullingJobData* job);
+
+        //! Split the objects into jobs, run them and merge their survivors.
+        uint32_t RunJobs(const JEFrustum& frustum, const JEFrustum* receiverFrustum, const glm::vec3& sweepDirection,
+                         const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, uint32_t count,
+                         const std::vector<BoundingBoxData>& boundingBoxes, const std::vector<BoundingSphereData>& boundingSpheres,
+                         uint32_t* survivors);
+
+    public:
+        //! Default constructor.
+        /*! No specific behavior. */
+        JEFrustumCuller() = default;
+
+        //! Destructor (default).
+        ~JEFrustumCuller() = default;
+
+        JEFrustumCuller(const JEFrustumCuller& culler) = delete;
+        JEFrustumCuller& operator=(const JEFrustumCuller& culler) = delete;
+
+        //! Frustum cull.
+        /*!
+          Objects whose mesh has no vertex or index buffer are always culled.
+          \param frustum the frustum to cull against.
+          \param meshComponents the mesh of each object.
+          \param worldMatrices the world matrix of each object.
+          \param count the number of objects.
+          \param boundingBoxes the mesh bounding boxes, indexed by vertex buffer handle.
+          \param boundingSpheres the mesh bounding spheres, indexed by vertex buffer handle.
+          \param survivors output array with room for 'count' object indices.
+          \return the number of objects that passed culling, whose indices were written to the front of 'survivors'.
+        */
+        uint32_t Cull(const JEFrustum& frustum, const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices,
+                      uint32_t count, const std::vector<BoundingBoxData>& boundingBoxes,
+                      const std::vector<BoundingSphereData>& boundingSpheres, uint32_t* survivors);
+
+        //! Shadow caster cull.
+        /*!
+          Objects must intersect the light's view volume, like in Cull(), and their bounding box swept along the light
+          direction must also reach the camera frustum: casters whose shadow cannot fall on anything the camera sees are culled.
+          Objects whose mesh has no vertex or index buffer are always culled.
+          \param lightFrustum the light's view volume, e.g. the orthographic frustum of the shadow camera.
+          \param cameraFrustum the camera frustum that receives the shadows.
+          \param lightDirection the direction the light travels in.
+          \param meshComponents the mesh of each object.
+          \param worldMatrices the world matrix of each object.
+          \param count the number of objects.
+          \param boundingBoxes the mesh bounding boxes, indexed by vertex buffer handle.
+          \param boundingSpheres the mesh bounding spheres, indexed by vertex buffer handle.
+          \param survivors output array with room for 'count' object indices.
+          \return the number of objects that passed culling, whose indices were written to the front of 'survivors'.
+        */
+        uint32_t CullShadowCasters(const JEFrustum& lightFrustum, const JEFrustum& cameraFrustum, const glm::vec3& lightDirection,
+                                   const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, uint32_t count,
+                                   const std::vector<BoundingBoxData>& boundingBoxes,
+                                   const std::vector<BoundingSphereData>& boundingSpheres, uint32_t* survivors);
+    };
+}
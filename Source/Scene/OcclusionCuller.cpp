@@ -0,0 +1,449 @@
+#include "JoeEngineConfig.h"
+
+#ifndef JOE_ENGINE_SIMD_NONE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "OcclusionCuller.h"
+#include "../Utils/ParallelFor.h"
+
+namespace JoeEngine {
+    //! Occluder triangles are clipped to this many times the normalized device extents, which keeps buffer-space coordinates
+    //! small enough for float edge functions while clipping triangles against the screen borders only rarely.
+    static constexpr float JE_OCCLUSION_GUARD_BAND = 2.0f;
+
+    //! Number of tiles per row of the occlusion depth buffer.
+    static constexpr uint32_t JE_OCCLUSION_TILES_X = JE_OCCLUSION_BUFFER_WIDTH / JE_OCCLUSION_TILE_SIZE;
+
+    //! Number of tile rows of the occlusion depth buffer.
+    static constexpr uint32_t JE_OCCLUSION_TILES_Y = JE_OCCLUSION_BUFFER_HEIGHT / JE_OCCLUSION_TILE_SIZE;
+
+    static_assert(JE_OCCLUSION_BUFFER_WIDTH % JE_OCCLUSION_TILE_SIZE == 0, "Occlusion buffer width must be a whole number of tiles");
+    static_assert(JE_OCCLUSION_BUFFER_HEIGHT % JE_OCCLUSION_BAND_HEIGHT == 0, "Occlusion buffer height must be a whole number of bands");
+    static_assert(JE_OCCLUSION_BAND_HEIGHT % JE_OCCLUSION_TILE_SIZE == 0, "Occlusion band height must be a whole number of tiles");
+    static_assert(JE_OCCLUSION_TILE_SIZE == 8, "Occlusion tile rows are rasterized and reduced as one 8-wide vector");
+
+    JEOcclusionCuller::JEOcclusionCuller() : m_depthBuffer(JE_OCCLUSION_BUFFER_WIDTH * JE_OCCLUSION_BUFFER_HEIGHT, 1.0f),
+        m_tileMaxDepth(JE_OCCLUSION_TILES_X * JE_OCCLUSION_TILES_Y, 1.0f), m_viewProj(1.0f), m_hasOccluders(false),
+        m_numSetupJobs(0) {
+        for (uint32_t b = 0; b < (uint32_t)m_rasterJobData.size(); ++b) {
+            m_rasterJobData[b].culler = this;
+            m_rasterJobData[b].startRow = b * JE_OCCLUSION_BAND_HEIGHT;
+        }
+    }
+
+    void JEOcclusionCuller::SetupOccluders(JEOcclusionSetupJobData* job) {
+        // Clip planes in clip space, inside if dot(plane, v) >= 0: the near plane, then the guard band
+        const glm::vec4 clipPlanes[5] = { glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+                                          glm::vec4(1.0f, 0.0f, 0.0f, JE_OCCLUSION_GUARD_BAND),
+                                          glm::vec4(-1.0f, 0.0f, 0.0f, JE_OCCLUSION_GUARD_BAND),
+                                          glm::vec4(0.0f, 1.0f, 0.0f, JE_OCCLUSION_GUARD_BAND),
+                                          glm::vec4(0.0f, -1.0f, 0.0f, JE_OCCLUSION_GUARD_BAND) };
+        const auto outCode = [&](const glm::vec4& v) {
+            uint32_t code = 0;
+            for (uint32_t p = 0; p < 5; ++p) {
+                code |= (uint32_t)(glm::dot(clipPlanes[p], v) < 0.0f) << p;
+            }
+            return code;
+        };
+
+        std::vector<JEOcclusionTriangle>& triangles = *job->triangles;
+        std::vector<glm::vec4>& clipVertices = *job->clipVertices;
+        triangles.clear();
+
+        const auto emitTriangle = [&](const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+            JEOcclusionTriangle triangle;
+            const glm::vec4* v[3] = { &a, &b, &c };
+            for (uint32_t k = 0; k < 3; ++k) {
+                const float invW = 1.0f / v[k]->w;
+                triangle.v[k] = glm::vec3((v[k]->x * invW * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_WIDTH,
+                                          (v[k]->y * invW * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_HEIGHT,
+                                          v[k]->z * invW);
+            }
+            triangles.push_back(triangle);
+        };
+
+        for (uint32_t i = job->startIdx; i < job->endIdx; ++i) {
+            const MeshComponent& meshComp = job->meshComponents[i];
+            if (meshComp.GetVertexHandle() == -1 || meshComp.GetIndexHandle() == -1) {
+                continue;
+            }
+
+            const std::vector<JEMeshVertex>& vertices = job->meshBufferManager->GetVertexListAt(meshComp.GetVertexHandle());
+            const std::vector<uint32_t>& indices = job->meshBufferManager->GetIndexListAt(meshComp.GetIndexHandle());
+            const glm::mat4 mvp = *job->viewProj * *job->worldMatrices[i];
+            clipVertices.resize(vertices.size());
+            for (size_t k = 0; k < vertices.size(); ++k) {
+                clipVertices[k] = mvp * glm::vec4(vertices[k].pos, 1.0f);
+            }
+
+            for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                const glm::vec4& a = clipVertices[indices[t]];
+                const glm::vec4& b = clipVertices[indices[t + 1]];
+                const glm::vec4& c = clipVertices[indices[t + 2]];
+                const uint32_t codeA = outCode(a);
+                const uint32_t codeB = outCode(b);
+                const uint32_t codeC = outCode(c);
+                if (codeA & codeB & codeC) {
+                    continue;
+                }
+                if ((codeA | codeB | codeC) == 0) {
+                    emitTriangle(a, b, c);
+                    continue;
+                }
+
+                // Sutherland-Hodgman against the planes the triangle crosses. A triangle clipped by five planes has at most
+                // eight vertices.
+                glm::vec4 polygon[2][8] = { { a, b, c } };
+                uint32_t numVertices = 3;
+                uint32_t src = 0;
+                const uint32_t crossed = codeA | codeB | codeC;
+                for (uint32_t p = 0; p < 5 && numVertices >= 3; ++p) {
+                    if (!(crossed & (1u << p))) {
+                        continue;
+                    }
+                    uint32_t numOut = 0;
+                    for (uint32_t k = 0; k < numVertices; ++k) {
+                        const glm::vec4& curr = polygon[src][k];
+                        const glm::vec4& next = polygon[src][(k + 1) % numVertices];
+                        const float dCurr = glm::dot(clipPlanes[p], curr);
+                        const float dNext = glm::dot(clipPlanes[p], next);
+                        if (dCurr >= 0.0f) {
+                            polygon[1 - src][numOut++] = curr;
+                        }
+                        if ((dCurr >= 0.0f) != (dNext >= 0.0f)) {
+                            polygon[1 - src][numOut++] = curr + (next - curr) * (dCurr / (dCurr - dNext));
+                        }
+                    }
+                    numVertices = numOut;
+                    src = 1 - src;
+                }
+                for (uint32_t k = 1; k + 1 < numVertices; ++k) {
+                    emitTriangle(polygon[src][0], polygon[src][k], polygon[src][k + 1]);
+                }
+            }
+        }
+    }
+
+    void JEOcclusionCuller::RasterizeTriangle(const JEOcclusionTriangle& triangle, uint32_t startRow, uint32_t endRow) {
+        glm::vec3 v0 = triangle.v[0];
+        glm::vec3 v1 = triangle.v[1];
+        glm::vec3 v2 = triangle.v[2];
+
+        // Pixels whose center is inside the triangle's bounds, within this band
+        const float minY = std::min(v0.y, std::min(v1.y, v2.y));
+        const float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+        const int yStart = std::max((int)startRow, (int)std::ceil(minY - 0.5f));
+        const int yEnd = std::min((int)endRow - 1, (int)std::floor(maxY - 0.5f));
+        if (yStart > yEnd) {
+            return;
+        }
+        const float minX = std::min(v0.x, std::min(v1.x, v2.x));
+        const float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+        const int xStart = std::max(0, (int)std::ceil(minX - 0.5f));
+        const int xEnd = std::min((int)JE_OCCLUSION_BUFFER_WIDTH - 1, (int)std::floor(maxX - 0.5f));
+        if (xStart > xEnd) {
+            return;
+        }
+
+        // Both windings are rasterized: make the triangle counter-clockwise so that inside means all edge functions >= 0
+        double area = ((double)v1.x - v0.x) * ((double)v2.y - v0.y) - ((double)v1.y - v0.y) * ((double)v2.x - v0.x);
+        if (area == 0.0) {
+            return;
+        }
+        if (area < 0.0) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // Edge functions E(x, y) = A * x + B * y + C of the edges opposite v0, v1 and v2
+        const glm::vec3* edgeStart[3] = { &v1, &v2, &v0 };
+        const glm::vec3* edgeEnd[3] = { &v2, &v0, &v1 };
+        double edgeA[3];
+        double edgeB[3];
+        double edgeC[3];
+        for (uint32_t e = 0; e < 3; ++e) {
+            edgeA[e] = -((double)edgeEnd[e]->y - edgeStart[e]->y);
+            edgeB[e] = (double)edgeEnd[e]->x - edgeStart[e]->x;
+            edgeC[e] = -(edgeA[e] * edgeStart[e]->x + edgeB[e] * edgeStart[e]->y);
+        }
+
+        // Depth plane from the barycentric coordinates of v1 and v2, offset to its farthest value over a pixel and capped at
+        // the triangle's farthest vertex so that slivers with steep gradients stay bounded
+        const double dz1 = (double)v1.z - v0.z;
+        const double dz2 = (double)v2.z - v0.z;
+        const double dzdx = (edgeA[1] * dz1 + edgeA[2] * dz2) / area;
+        const double dzdy = (edgeB[1] * dz1 + edgeB[2] * dz2) / area;
+        const double zC = v0.z - dzdx * v0.x - dzdy * v0.y + 0.5 * (std::abs(dzdx) + std::abs(dzdy));
+        const float zMax = std::max(v0.z, std::max(v1.z, v2.z));
+
+        #ifdef JOE_ENGINE_SIMD_AVX2
+        const __m256 pixelOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 a0 = _mm256_set1_ps((float)edgeA[0]);
+        const __m256 a1 = _mm256_set1_ps((float)edgeA[1]);
+        const __m256 a2 = _mm256_set1_ps((float)edgeA[2]);
+        const __m256 zdx = _mm256_set1_ps((float)dzdx);
+        const __m256 zMaxV = _mm256_set1_ps(zMax);
+        const __m256 zero = _mm256_setzero_ps();
+        const int xAlignedStart = xStart & ~7;
+        for (int y = yStart; y <= yEnd; ++y) {
+            const double py = y + 0.5;
+            const __m256 row0 = _mm256_set1_ps((float)(edgeB[0] * py + edgeC[0]));
+            const __m256 row1 = _mm256_set1_ps((float)(edgeB[1] * py + edgeC[1]));
+            const __m256 row2 = _mm256_set1_ps((float)(edgeB[2] * py + edgeC[2]));
+            const __m256 rowZ = _mm256_set1_ps((float)(dzdy * py + zC));
+            float* row = m_depthBuffer.data() + y * JE_OCCLUSION_BUFFER_WIDTH;
+            for (int x = xAlignedStart; x <= xEnd; x += 8) {
+                const __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), pixelOffsets);
+                const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), row0);
+                const __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), row1);
+                const __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), row2);
+                const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                                    _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                const __m256 z = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(zdx, px), rowZ), zMaxV);
+                const __m256 depth = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+            }
+        }
+        #else
+        for (int y = yStart; y <= yEnd; ++y) {
+            const double py = y + 0.5;
+            const float row0 = (float)(edgeB[0] * py + edgeC[0]);
+            const float row1 = (float)(edgeB[1] * py + edgeC[1]);
+            const float row2 = (float)(edgeB[2] * py + edgeC[2]);
+            const float rowZ = (float)(dzdy * py + zC);
+            float* row = m_depthBuffer.data() + y * JE_OCCLUSION_BUFFER_WIDTH;
+            for (int x = xStart; x <= xEnd; ++x) {
+                const float px = x + 0.5f;
+                if ((float)edgeA[0] * px + row0 >= 0.0f && (float)edgeA[1] * px + row1 >= 0.0f && (float)edgeA[2] * px + row2 >= 0.0f) {
+                    row[x] = std::min(row[x], std::min((float)dzdx * px + rowZ, zMax));
+                }
+            }
+        }
+        #endif
+    }
+
+    void JEOcclusionCuller::RasterizeBand(uint32_t startRow) {
+        const uint32_t endRow = startRow + JE_OCCLUSION_BAND_HEIGHT;
+        std::fill(m_depthBuffer.begin() + startRow * JE_OCCLUSION_BUFFER_WIDTH, m_depthBuffer.begin() + endRow * JE_OCCLUSION_BUFFER_WIDTH, 1.0f);
+
+        const float bandMinY = (float)startRow;
+        const float bandMaxY = (float)endRow;
+        for (uint32_t j = 0; j < m_numSetupJobs; ++j) {
+            for (const JEOcclusionTriangle& triangle : m_jobTriangles[j]) {
+                if (std::max(triangle.v[0].y, std::max(triangle.v[1].y, triangle.v[2].y)) < bandMinY ||
+                    std::min(triangle.v[0].y, std::min(triangle.v[1].y, triangle.v[2].y)) > bandMaxY) {
+                    continue;
+                }
+                RasterizeTriangle(triangle, startRow, endRow);
+            }
+        }
+
+        // Farthest depth of each tile in the band
+        for (uint32_t ty = startRow / JE_OCCLUSION_TILE_SIZE; ty < endRow / JE_OCCLUSION_TILE_SIZE; ++ty) {
+            for (uint32_t tx = 0; tx < JE_OCCLUSION_TILES_X; ++tx) {
+                const float* tile = m_depthBuffer.data() + ty * JE_OCCLUSION_TILE_SIZE * JE_OCCLUSION_BUFFER_WIDTH + tx * JE_OCCLUSION_TILE_SIZE;
+                #ifdef JOE_ENGINE_SIMD_AVX2
+                __m256 tileMax = _mm256_loadu_ps(tile);
+                for (uint32_t r = 1; r < JE_OCCLUSION_TILE_SIZE; ++r) {
+                    tileMax = _mm256_max_ps(tileMax, _mm256_loadu_ps(tile + r * JE_OCCLUSION_BUFFER_WIDTH));
+                }
+                __m128 m = _mm_max_ps(_mm256_castps256_ps128(tileMax), _mm256_extractf128_ps(tileMax, 1));
+                m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+                m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+                m_tileMaxDepth[ty * JE_OCCLUSION_TILES_X + tx] = _mm_cvtss_f32(m);
+                #else
+                float tileMax = 0.0f;
+                for (uint32_t r = 0; r < JE_OCCLUSION_TILE_SIZE; ++r) {
+                    for (uint32_t c = 0; c < JE_OCCLUSION_TILE_SIZE; ++c) {
+                        tileMax = std::max(tileMax, tile[r * JE_OCCLUSION_BUFFER_WIDTH + c]);
+                    }
+                }
+                m_tileMaxDepth[ty * JE_OCCLUSION_TILES_X + tx] = tileMax;
+                #endif
+            }
+        }
+    }
+
+    void JEOcclusionCuller::RasterizeBand_MT(void* data) {
+        JEOcclusionRasterJobData* job = (JEOcclusionRasterJobData*)data;
+        job->culler->RasterizeBand(job->startRow);
+    }
+
+    void JEOcclusionCuller::RenderOccluders(const glm::mat4& viewProj, const MeshComponent* meshComponents,
+                                            const glm::mat4* const* worldMatrices, uint32_t count,
+                                            const JEMeshBufferManager& meshBufferManager) {
+        m_viewProj = viewProj;
+
+        const uint32_t numJobs = (count + JE_OCCLUSION_SETUP_JOB_SIZE - 1) / JE_OCCLUSION_SETUP_JOB_SIZE;
+        if (numJobs > m_jobTriangles.size()) {
+            m_jobTriangles.resize(numJobs);
+            m_jobClipVertices.resize(numJobs);
+        }
+        m_numSetupJobs = numJobs;
+
+        ParallelUtils::ParallelFor(0, count, JE_OCCLUSION_SETUP_JOB_SIZE, [&](uint32_t startIdx, uint32_t endIdx) {
+            const uint32_t j = startIdx / JE_OCCLUSION_SETUP_JOB_SIZE;
+            JEOcclusionSetupJobData job;
+            job.viewProj = &m_viewProj;
+            job.meshComponents = meshComponents;
+            job.worldMatrices = worldMatrices;
+            job.meshBufferManager = &meshBufferManager;
+            job.startIdx = startIdx;
+            job.endIdx = endIdx;
+            job.triangles = &m_jobTriangles[j];
+            job.clipVertices = &m_jobClipVertices[j];
+            SetupOccluders(&job);
+        });
+
+        m_hasOccluders = false;
+        for (uint32_t j = 0; j < numJobs; ++j) {
+            m_hasOccluders |= !m_jobTriangles[j].empty();
+        }
+        if (!m_hasOccluders) {
+            std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), 1.0f);
+            std::fill(m_tileMaxDepth.begin(), m_tileMaxDepth.end(), 1.0f);
+            return;
+        }
+
+        // Every band job reads all triangles but only writes its own rows and tiles
+        // Bands are fixed by the buffer layout, so their job data is built once in the constructor and enqueued directly
+        const uint32_t numBands = (uint32_t)m_rasterJobData.size();
+        JEJobCounter jobCounter;
+        for (uint32_t b = 0; b < numBands - 1; ++b) {
+            JEThreadPoolInstance.EnqueueJob({ RasterizeBand_MT, &m_rasterJobData[b] }, &jobCounter);
+        }
+        RasterizeBand(m_rasterJobData[numBands - 1].startRow);
+        JEThreadPoolInstance.Wait(jobCounter);
+    }
+
+    bool JEOcclusionCuller::IsVisible(const glm::mat4& worldMatrix, const BoundingBoxData& boundingBox) const {
+        const glm::mat4 mvp = m_viewProj * worldMatrix;
+        const glm::vec3& localMin = boundingBox[0];
+        const glm::vec3& localMax = boundingBox[7];
+
+        // Screen-space rectangle and nearest depth of the box. Depth is monotonic in view depth, so the nearest point of the
+        // box is one of its corners.
+        float minX = FLT_MAX;
+        float minY = FLT_MAX;
+        float maxX = -FLT_MAX;
+        float maxY = -FLT_MAX;
+        float minZ = FLT_MAX;
+        for (uint32_t c = 0; c < 8; ++c) {
+            const glm::vec4 corner = mvp * glm::vec4((c & 1) ? localMax.x : localMin.x, (c & 2) ? localMax.y : localMin.y,
+                                                     (c & 4) ? localMax.z : localMin.z, 1.0f);
+            if (corner.z < 0.0f || corner.w <= 0.0f) {
+                // The box crosses the near plane
+                return true;
+            }
+            const float invW = 1.0f / corner.w;
+            minX = std::min(minX, corner.x * invW);
+            maxX = std::max(maxX, corner.x * invW);
+            minY = std::min(minY, corner.y * invW);
+            maxY = std::max(maxY, corner.y * invW);
+            minZ = std::min(minZ, corner.z * invW);
+        }
+
+        // Every pixel the rectangle touches, grown by one pixel: occluder coverage is sampled at pixel centers, so a box that
+        // peeks out less than a pixel past an occluder edge is still seen through the pixel next to it
+        minX = (minX * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_WIDTH - 1.0f;
+        maxX = (maxX * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_WIDTH + 1.0f;
+        minY = (minY * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_HEIGHT - 1.0f;
+        maxY = (maxY * 0.5f + 0.5f) * (float)JE_OCCLUSION_BUFFER_HEIGHT + 1.0f;
+        if (maxX < 0.0f || maxY < 0.0f || minX >= (float)JE_OCCLUSION_BUFFER_WIDTH || minY >= (float)JE_OCCLUSION_BUFFER_HEIGHT) {
+            return true;
+        }
+        const uint32_t x0 = (uint32_t)std::max(minX, 0.0f);
+        const uint32_t y0 = (uint32_t)std::max(minY, 0.0f);
+        const uint32_t x1 = (uint32_t)std::min(maxX, (float)(JE_OCCLUSION_BUFFER_WIDTH - 1));
+        const uint32_t y1 = (uint32_t)std::min(maxY, (float)(JE_OCCLUSION_BUFFER_HEIGHT - 1));
+
+        for (uint32_t ty = y0 / JE_OCCLUSION_TILE_SIZE; ty <= y1 / JE_OCCLUSION_TILE_SIZE; ++ty) {
+            for (uint32_t tx = x0 / JE_OCCLUSION_TILE_SIZE; tx <= x1 / JE_OCCLUSION_TILE_SIZE; ++tx) {
+                // Occluders cover the whole tile in front of the box
+                if (m_tileMaxDepth[ty * JE_OCCLUSION_TILES_X + tx] < minZ) {
+                    continue;
+                }
+
+                const uint32_t px0 = std::max(x0, tx * JE_OCCLUSION_TILE_SIZE);
+                const uint32_t px1 = std::min(x1, tx * JE_OCCLUSION_TILE_SIZE + JE_OCCLUSION_TILE_SIZE - 1);
+                const uint32_t py0 = std::max(y0, ty * JE_OCCLUSION_TILE_SIZE);
+                const uint32_t py1 = std::min(y1, ty * JE_OCCLUSION_TILE_SIZE + JE_OCCLUSION_TILE_SIZE - 1);
+                for (uint32_t y = py0; y <= py1; ++y) {
+                    const float* row = m_depthBuffer.data() + y * JE_OCCLUSION_BUFFER_WIDTH;
+                    for (uint32_t x = px0; x <= px1; ++x) {
+                        if (row[x] >= minZ) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    void JEOcclusionCuller::TestRange(JEOcclusionTestJobData* job) {
+        std::vector<uint32_t>& survivors = *job->survivors;
+        survivors.clear();
+
+        for (uint32_t i = job->startIdx; i < job->endIdx; ++i) {
+            const uint32_t objectIdx = job->indices[i];
+            const MeshComponent& meshComp = job->meshComponents[objectIdx];
+            if (meshComp.GetVertexHandle() == -1 ||
+                job->culler->IsVisible(*job->worldMatrices[objectIdx], job->boundingBoxes[meshComp.GetVertexHandle()])) {
+                survivors.push_back(objectIdx);
+            }
+        }
+    }
+
+    uint32_t JEOcclusionCuller::Cull(const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, const uint32_t* indices,
+                                     uint32_t count, const std::vector<BoundingBoxData>& boundingBoxes, uint32_t* survivors) {
+        if (count == 0) {
+            return 0;
+        }
+        if (!m_hasOccluders) {
+            if (survivors != indices) {
+                std::memmove(survivors, indices, count * sizeof(uint32_t));
+            }
+            return count;
+        }
+
+        const uint32_t numJobs = (count + JE_OCCLUSION_TEST_JOB_SIZE - 1) / JE_OCCLUSION_TEST_JOB_SIZE;
+        if (numJobs > m_jobSurvivors.size()) {
+            m_jobSurvivors.resize(numJobs);
+        }
+
+        ParallelUtils::ParallelFor(0, count, JE_OCCLUSION_TEST_JOB_SIZE, [&](uint32_t startIdx, uint32_t endIdx) {
+            JEOcclusionTestJobData job;
+            job.culler = this;
+            job.meshComponents = meshComponents;
+            job.worldMatrices = worldMatrices;
+            job.boundingBoxes = boundingBoxes.data();
+            job.indices = indices;
+            job.startIdx = startIdx;
+            job.endIdx = endIdx;
+            job.survivors = &m_jobSurvivors[startIdx / JE_OCCLUSION_TEST_JOB_SIZE];
+            TestRange(&job);
+        });
+
+        // Merge in job order. Job j's survivors never extend past its own input range, so merging in place is safe when
+        // 'survivors' and 'indices' are the same array.
+        uint32_t numSurvivors = 0;
+        for (uint32_t j = 0; j < numJobs; ++j) {
+            const std::vector<uint32_t>& jobSurvivors = m_jobSurvivors[j];
+            if (!jobSurvivors.empty()) {
+                std::memmove(survivors + numSurvivors, jobSurvivors.data(), jobSurvivors.size() * sizeof(uint32_t));
+            }
+            numSurvivors += (uint32_t)jobSurvivors.size();
+        }
+        return numSurvivors;
+    }
+}
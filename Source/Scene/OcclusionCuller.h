@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <array>
+
+#include "glm/glm.hpp"
+
+#include "../Rendering/MeshBufferManager.h"
+
+namespace JoeEngine {
+    //! Occlusion depth buffer width in pixels. Must be a multiple of JE_OCCLUSION_TILE_SIZE.
+    constexpr uint32_t JE_OCCLUSION_BUFFER_WIDTH = 320;
+
+    //! Occlusion depth buffer height in pixels. Must be a multiple of JE_OCCLUSION_BAND_HEIGHT.
+    constexpr uint32_t JE_OCCLUSION_BUFFER_HEIGHT = 192;
+
+    //! Width and height of an occlusion depth buffer tile, the unit of the hierarchical depth test.
+    /*! A tile row is one 8-wide AVX2 vector. */
+    constexpr uint32_t JE_OCCLUSION_TILE_SIZE = 8;
+
+    //! Number of pixel rows each occluder rasterization thread job owns. Must be a multiple of JE_OCCLUSION_TILE_SIZE.
+    constexpr uint32_t JE_OCCLUSION_BAND_HEIGHT = 16;
+
+    //! Number of occluders per occluder setup thread job.
+    constexpr uint32_t JE_OCCLUSION_SETUP_JOB_SIZE = 16;
+
+    //! Number of objects per occlusion test thread job.
+    constexpr uint32_t JE_OCCLUSION_TEST_JOB_SIZE = 1024;
+
+    //! The Occlusion Culler class
+    /*!
+      CPU occlusion culling stage that runs after frustum culling. The frame's occluders (meshes whose material has the OCCLUDER
+      setting) are rasterized into a low-resolution depth buffer, and objects are then tested against it by the screen-space
+      rectangle and nearest depth of their bounding box.
+      Rasterization runs in two parallel steps over JEThreadPoolInstance: occluder triangles are first transformed, clipped
+      against the near plane and a guard band and projected to the buffer, then each job rasterizes every triangle into its
+      own band of JE_OCCLUSION_BAND_HEIGHT rows, 8 pixels at a time with AVX2 if available, so no two jobs touch the same
+      pixels. Each band job finishes by computing the farthest depth of its JE_OCCLUSION_TILE_SIZE square tiles, which lets
+      the object test skip a whole tile with one comparison.
+      Occluder depth is conservative: each pixel stores the farthest depth of the triangle's plane over the pixel instead of the
+      depth at its center. Coverage is sampled at pixel centers, like the GPU rasterizer.
+      Buffers are kept between frames, so the stage does not allocate in steady state.
+      \sa JEFrustumCuller, JEEngineInstance
+    */
+    class JEOcclusionCuller {
+    private:
+        //! Occluder triangle in buffer space: x and y in pixels, z is the normalized device depth.
+        typedef struct je_occlusion_triangle_t {
+            glm::vec3 v[3];
+        } JEOcclusionTriangle;
+
+        //! Occluder setup job data.
+        typedef struct je_occlusion_setup_job_data_t {
+            //! View-projection matrix.
+            const glm::mat4* viewProj;
+
+            //! Mesh of each occluder.
+            const MeshComponent* meshComponents;
+
+            //! World matrix of each occluder.
+            const glm::mat4* const* worldMatrices;
+
+            //! Mesh buffer manager holding the occluder vertex and index lists.
+            const JEMeshBufferManager* meshBufferManager;
+
+            //! First occluder of this job.
+            uint32_t startIdx;
+
+            //! One past the last occluder of this job.
+            uint32_t endIdx;
+
+            //! Output list of projected triangles.
+            std::vector<JEOcclusionTriangle>* triangles;
+
+            //! Clip-space vertex scratch list.
+            std::vector<glm::vec4>* clipVertices;
+        } JEOcclusionSetupJobData;
+
+        //! Occluder rasterization job data.
+        typedef struct je_occlusion_raster_job_data_t {
+            //! The culler owning the depth buffer.
+            JEOcclusionCuller* culler;
+
+            //! First pixel row of this job's band.
+            uint32_t startRow;
+        } JEOcclusionRasterJobData;
+
+        //! Occlusion test job data.
+        typedef struct je_occlusion_test_job_data_t {
+            //! The culler owning the depth buffer.
+            const JEOcclusionCuller* culler;
+
+            //! Mesh of each object.
+            const MeshComponent* meshComponents;
+
+            //! World matrix of each object.
+            const glm::mat4* const* worldMatrices;
+
+            //! Mesh bounding boxes, indexed by vertex buffer handle.
+            const BoundingBoxData* boundingBoxes;
+
+            //! Indices of the objects to test.
+            const uint32_t* indices;
+
+            //! First entry of 'indices' of this job.
+            uint32_t startIdx;
+
+            //! One past the last entry of 'indices' of this job.
+            uint32_t endIdx;
+
+            //! Output list of the indices of objects that are not occluded.
+            std::vector<uint32_t>* survivors;
+        } JEOcclusionTestJobData;
+
+        //! Depth buffer, row-major, JE_OCCLUSION_BUFFER_WIDTH x JE_OCCLUSION_BUFFER_HEIGHT. Cleared to the far plane (1).
+        std::vector<float> m_depthBuffer;
+
+        //! Farthest depth of each tile of the depth buffer, row-major.
+        std::vector<float> m_tileMaxDepth;
+
+        //! View-projection matrix of the last call to RenderOccluders().
+        glm::mat4 m_viewProj;
+
+        //! Whether the last call to RenderOccluders() rasterized any triangles.
+        bool m_hasOccluders;
+
+        //! Per-setup-job projected triangle lists.
+        std::vector<std::vector<JEOcclusionTriangle>> m_jobTriangles;
+
+        //! Per-setup-job clip-space vertex scratch lists.
+        std::vector<std::vector<glm::vec4>> m_jobClipVertices;
+
+        //! Number of setup jobs of the last call to RenderOccluders().
+        uint32_t m_numSetupJobs;
+
+        //! Per-band rasterization job data.
+        std::array<JEOcclusionRasterJobData, JE_OCCLUSION_BUFFER_HEIGHT / JE_OCCLUSION_BAND_HEIGHT> m_rasterJobData;
+
+        //! Per-test-job survivor lists.
+        std::vector<std::vector<uint32_t>> m_jobSurvivors;
+
+        //! Transform, clip and project a range of occluders.
+        static void SetupOccluders(JEOcclusionSetupJobData* job);
+
+        //! Clear one band of the depth buffer, rasterize every triangle into it and compute its tile depths.
+        void RasterizeBand(uint32_t startRow);
+
+        //! Thread pool job function.
+        static void RasterizeBand_MT(void* data);
+
+        //! Rasterize one triangle into the rows [startRow, endRow) of the depth buffer.
+        void RasterizeTriangle(const JEOcclusionTriangle& triangle, uint32_t startRow, uint32_t endRow);
+
+        //! Test a range of objects.
+        static void TestRange(JEOcclusionTestJobData* job);
+
+        //! Test one object's bounding box against the depth buffer.
+        /*! \return true if any part of the box may be visible. */
+        bool IsVisible(const glm::mat4& worldMatrix, const BoundingBoxData& boundingBox) const;
+
+    public:
+        //! Default constructor.
+        /*! Allocates the depth buffer. */
+        JEOcclusionCuller();
+
+        //! Destructor (default).
+        ~JEOcclusionCuller() = default;
+
+        JEOcclusionCuller(const JEOcclusionCuller& culler) = delete;
+        JEOcclusionCuller& operator=(const JEOcclusionCuller& culler) = delete;
+
+        //! Rasterize the frame's occluders.
+        /*!
+          Clears the depth buffer and rasterizes the triangles of every occluder mesh. Occluders whose mesh has no vertex or index
+          buffer are skipped.
+          \param viewProj the view-projection matrix to rasterize and later test with.
+          \param meshComponents the mesh of each occluder.
+          \param worldMatrices the world matrix of each occluder.
+          \param count the number of occluders.
+          \param meshBufferManager the mesh buffer manager holding the occluder vertex and index lists.
+        */
+        void RenderOccluders(const glm::mat4& viewProj, const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices,
+                             uint32_t count, const JEMeshBufferManager& meshBufferManager);
+
+        //! Occlusion cull.
+        /*!
+          Tests objects against the depth buffer of the last call to RenderOccluders(). Objects whose bounding box crosses the
+          near plane are never culled. If no occluder triangles were rasterized, every object passes.
+          \param meshComponents the mesh of each object.
+          \param worldMatrices the world matrix of each object.
+          \param indices the indices of the objects to test, e.g. the frustum culling survivors.
+          \param count the number of entries in 'indices'.
+          \param boundingBoxes the mesh bounding boxes, indexed by vertex buffer handle.
+          \param survivors output array with room for 'count' object indices. May be the same array as 'indices'.
+          \return the number of objects that are not occluded, whose indices were written to the front of 'survivors' in input order.
+        */
+        uint32_t Cull(const MeshComponent* meshComponents, const glm::mat4* const* worldMatrices, const uint32_t* indices,
+                      uint32_t count, const std::vector<BoundingBoxData>& boundingBoxes, uint32_t* survivors);
+
+        //! Get the depth buffer of the last call to RenderOccluders().
+        /*! Row-major, JE_OCCLUSION_BUFFER_WIDTH x JE_OCCLUSION_BUFFER_HEIGHT, with row 0 at normalized device y = -1. */
+        const std::vector<float>& GetDepthBuffer() const {
+            return m_depthBuffer;
+        }
+    };
+}
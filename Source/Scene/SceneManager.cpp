@@ -18,8 +18,8 @@ namespace JoeEngine {
             m_shadowCamera = JECamera(glm::vec3(4.0f, 4.0f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), shadowPassExtent.width / (float)shadowPassExtent.height, JE_SHADOW_VIEW_NEAR_PLANE, JE_SHADOW_VIEW_FAR_PLANE);
 
             std::vector<Entity> entities;
-            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj");
-            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj");
+            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj", 3);
+            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj", 2);
             MeshComponent meshComp_cube = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "cube.obj");
 
             uint32_t tex1 = m_engineInstance->LoadTexture(JE_TEXTURES_DIR + "ducreux.jpg");
@@ -185,8 +185,8 @@ namespace JoeEngine {
             m_shadowCamera = JECamera(glm::vec3(4.0f, 4.0f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), shadowPassExtent.width / (float)shadowPassExtent.height, JE_SHADOW_VIEW_NEAR_PLANE, JE_SHADOW_VIEW_FAR_PLANE);
 
             std::vector<Entity> entities;
-            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj");
-            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj");
+            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj", 3);
+            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj", 2);
             MeshComponent meshComp_cube = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "cube.obj");
             uint32_t tex1 = m_engineInstance->LoadTexture(JE_TEXTURES_DIR + "ducreux.jpg");
 
@@ -246,8 +246,8 @@ namespace JoeEngine {
             m_shadowCamera = JECamera(glm::vec3(4.0f, 4.0f, 4.0f), glm::vec3(0.0f, 0.0f, 0.0f), shadowPassExtent.width / (float)shadowPassExtent.height, JE_SHADOW_VIEW_NEAR_PLANE, JE_SHADOW_VIEW_FAR_PLANE);
 
             std::vector<Entity> entities;
-            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj");
-            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj");
+            MeshComponent meshComp_alien = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "alienModel_Small.obj", 3);
+            MeshComponent meshComp_sphere = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "sphere.obj", 2);
             MeshComponent meshComp_cube = m_engineInstance->CreateMeshComponent(JE_MODELS_OBJ_DIR + "cube.obj");
 
             uint32_t tex1 = m_engineInstance->LoadTexture(JE_TEXTURES_DIR + "ducreux.jpg");
@@ -337,9 +337,10 @@ namespace JoeEngine {
             mat_translucent_forward_noshadows2.m_shaderID = mat_translucent_forward_noshadows.m_shaderID;
             m_engineInstance->CreateDescriptor(mat_translucent_forward_noshadows2);
 
+            std::vector<Entity> gridEntities = m_engineInstance->SpawnEntities(25);
             for (int i = 0; i < 5; ++i) {
                 for (int j = 0; j < 5; ++j) {
-                    Entity newEntity = m_engineInstance->SpawnEntity();
+                    Entity newEntity = gridEntities[i * 5 + j];
                     entities.push_back(newEntity);
 
                     if (i % 3 == 0) {
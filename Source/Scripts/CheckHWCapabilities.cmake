@@ -3,6 +3,11 @@
 
 include(CheckCXXSourceRuns)
 
+# GCC/Clang won't compile AVX2 intrinsics without the matching target flag
+if (NOT WIN32)
+    set(CMAKE_REQUIRED_FLAGS "-mavx2")
+endif()
+
 set(JOE_ENGINE_SIMD_NONE OFF)
 set(JOE_ENGINE_SIMD_AVX OFF)
 set(JOE_ENGINE_SIMD_AVX2 OFF)
@@ -27,11 +32,12 @@ if (HAVE_AVX2_EXTENSIONS)
     set(JOE_ENGINE_SIMD_AVX2 ON)
     if (WIN32)
         set(CMAKE_CXX_FLAGS ${CMAKE_CXX_FLAGS} "/arch:AVX2")
-    else (${CMAKE_SYSTEM_NAME} MATCHES "Darwin")
-        if (CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+    else ()
+        if (CMAKE_CXX_COMPILER_ID MATCHES "Clang" OR CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
             set(CMAKE_CXX_FLAGS ${CMAKE_CXX_FLAGS} "-mavx2")
         endif()
     endif()
+    unset(CMAKE_REQUIRED_FLAGS)
     return()
 endif()
 
@@ -64,5 +70,7 @@ endif()
 #    return()
 #endif()
 
+unset(CMAKE_REQUIRED_FLAGS)
+
 # If we made it this far past the return() calls, no SIMD support is present on this platform
 set(JOE_ENGINE_SIMD_NONE ON)
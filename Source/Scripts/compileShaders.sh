@@ -2,6 +2,14 @@
 echo Compiling Shaders...
 cd ../Source/Shaders/
 glslPath=/usr/local/Caskroom/vulkan-sdk/1.1.121.1/macOS/bin/glslangValidator
+if [ ! -x "$glslPath" ]; then
+    # Fall back to the Vulkan SDK environment or whatever is on the PATH (e.g. Linux)
+    if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslangValidator" ]; then
+        glslPath=$VULKAN_SDK/bin/glslangValidator
+    else
+        glslPath=glslangValidator
+    fi
+fi
 
 for f in *.vert
 do
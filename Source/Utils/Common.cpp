@@ -10,7 +10,7 @@ namespace JoeEngine {
     const std::string JE_TEXTURES_DIR = JE_PROJECT_PATH + "Resources\\Textures\\";
     #endif
 
-    #ifdef JOE_ENGINE_PLATFORM_APPLE
+    #if defined(JOE_ENGINE_PLATFORM_APPLE) || defined(JOE_ENGINE_PLATFORM_LINUX)
     const std::string JE_PROJECT_PATH = std::string("../");
     const std::string JE_SHADER_DIR = JE_PROJECT_PATH + "Source/Shaders/";
     const std::string JE_MODELS_OBJ_DIR = JE_PROJECT_PATH + "Resources/Models/OBJs/";
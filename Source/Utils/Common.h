@@ -73,6 +73,20 @@ namespace JoeEngine {
     //! Scene camera FOV value.
     const float JE_FOVY = glm::radians(22.5f);
 
+    // Mesh level of detail
+
+    //! Largest screen-space error, in pixels, that a mesh LOD may introduce before a finer LOD is selected.
+    constexpr float JE_LOD_MAX_SCREEN_SPACE_ERROR = 1.0f;
+
+    //! Fraction of the previous LOD's triangles that each generated LOD targets.
+    constexpr float JE_MESH_LOD_REDUCTION = 0.5f;
+
+    //! Smallest index count of a generated LOD. Coarser LODs are not generated.
+    constexpr uint32_t JE_MESH_LOD_MIN_INDICES = 3 * 64;
+
+    //! Number of frames simulated by a headless run when no frame count is specified.
+    constexpr uint32_t JE_DEFAULT_HEADLESS_NUM_FRAMES = 1000;
+
     // Engine settings
 
     //! Engine renderer settings bit flag.
@@ -80,6 +94,8 @@ namespace JoeEngine {
         Default = 0x0,
         EnableDeferred = 0x1,
         EnableOIT = 0x2,
+        Headless = 0x4, // No window, no Vulkan device - the renderer acts as a null backend
+        PipelinedFrames = 0x8, // Simulate the next frame while the current one is recorded and submitted (one frame of latency)
         AllSettings = 0xFFFFFFFF
     } RendererSettings;
 
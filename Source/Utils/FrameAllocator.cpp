@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "FrameAllocator.h"
+#include "MemAllocUtils.h"
+
+namespace JoeEngine {
+    JEFrameArena::JEFrameArena(size_t initialSize) : m_offset(0) {
+        m_blocks.reserve(8);
+        AddBlock(initialSize);
+    }
+
+    JEFrameArena::~JEFrameArena() {
+        for (const JEFrameArenaBlock& block : m_blocks) {
+            MemAllocUtils::alignedFree(block.data);
+        }
+    }
+
+    void JEFrameArena::AddBlock(size_t size) {
+        // Grow geometrically so a frame that outgrows the arena only needs a few extra blocks
+        if (!m_blocks.empty()) {
+            size = std::max(size, m_blocks.back().size * 2);
+        }
+
+        JEFrameArenaBlock block;
+        block.data = static_cast<uint8_t*>(MemAllocUtils::alignedAlloc(64, size));
+        if (block.data == nullptr) {
+            throw std::runtime_error("Failed to allocate frame arena block");
+        }
+        block.size = size;
+        m_blocks.push_back(block);
+        m_offset = 0;
+    }
+
+    void JEFrameArena::Reset() {
+        if (m_blocks.size() > 1) {
+            const size_t capacity = GetCapacity();
+            for (const JEFrameArenaBlock& block : m_blocks) {
+                MemAllocUtils::alignedFree(block.data);
+            }
+            m_blocks.clear();
+            AddBlock(capacity);
+        }
+        m_offset = 0;
+    }
+
+    size_t JEFrameArena::GetCapacity() const {
+        size_t capacity = 0;
+        for (const JEFrameArenaBlock& block : m_blocks) {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+}
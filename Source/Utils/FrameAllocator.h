@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace JoeEngine {
+    //! Default size of the frame arena's first block, in bytes.
+    constexpr size_t JE_FRAME_ARENA_DEFAULT_SIZE = 1 << 20;
+
+    //! The Frame Arena class
+    /*!
+      Linear (bump) allocator for data that only lives for one frame. Allocating just advances an offset into the current block,
+      and individual allocations are never freed - everything is released at once by Reset() at the start of the next frame.
+      If a frame needs more than one block, the blocks are merged into a single larger block upon Reset(), so after a few frames
+      the arena settles at one block big enough for the whole frame and stops touching the general heap.
+      Not thread-safe: only use it from the thread that runs the frame.
+      \sa JEFrameAllocator, JEFrameVector
+    */
+    class JEFrameArena {
+    private:
+        //! Arena block.
+        typedef struct je_frame_arena_block_t {
+            //! Block memory.
+            uint8_t* data;
+
+            //! Block size in bytes.
+            size_t size;
+        } JEFrameArenaBlock;
+
+        //! List of blocks. Allocations are made from the last block.
+        std::vector<JEFrameArenaBlock> m_blocks;
+
+        //! Offset of the first unused byte in the last block.
+        size_t m_offset;
+
+        //! Allocate a new block of at least the specified size and make it the current block.
+        void AddBlock(size_t size);
+
+    public:
+        //! Constructor.
+        /*!
+          Allocates the first block.
+          \param initialSize size of the first block in bytes.
+        */
+        JEFrameArena(size_t initialSize = JE_FRAME_ARENA_DEFAULT_SIZE);
+
+        //! Destructor.
+        /*! Frees all blocks. */
+        ~JEFrameArena();
+
+        JEFrameArena(const JEFrameArena& arena) = delete;
+        JEFrameArena& operator=(const JEFrameArena& arena) = delete;
+
+        //! Allocate memory.
+        /*!
+          \param size the number of bytes to allocate.
+          \param alignment the required alignment, must be a power of two.
+          \return pointer to the allocated memory, valid until the next Reset().
+        */
+        void* Allocate(size_t size, size_t alignment) {
+            const JEFrameArenaBlock& block = m_blocks.back();
+            const size_t alignedOffset = (m_offset + alignment - 1) & ~(alignment - 1);
+            if (alignedOffset + size > block.size) {
+                AddBlock(size + alignment);
+                return Allocate(size, alignment);
+            }
+            m_offset = alignedOffset + size;
+            return block.data + alignedOffset;
+        }
+
+        //! Release all allocations, merging the blocks into one if the last frame needed more than one.
+        void Reset();
+
+        //! Get the total size of all blocks in bytes.
+        size_t GetCapacity() const;
+    };
+
+    //! The Frame Allocator class
+    /*!
+      STL-compatible allocator adapter that allocates from a JEFrameArena. Deallocation does nothing, the memory is reclaimed
+      when the arena is reset, so containers using it must not outlive the frame.
+      \sa JEFrameArena, JEFrameVector
+    */
+    template <typename T>
+    class JEFrameAllocator {
+    public:
+        typedef T value_type;
+
+        //! The arena to allocate from.
+        JEFrameArena* m_arena;
+
+        //! Constructor.
+        /*! \param arena the arena to allocate from. */
+        JEFrameAllocator(JEFrameArena* arena) noexcept : m_arena(arena) {}
+
+        //! Converting constructor, allocates from the same arena.
+        template <typename U>
+        JEFrameAllocator(const JEFrameAllocator<U>& allocator) noexcept : m_arena(allocator.m_arena) {}
+
+        //! Allocate storage for n elements of type T.
+        T* allocate(size_t n) {
+            return static_cast<T*>(m_arena->Allocate(n * sizeof(T), alignof(T)));
+        }
+
+        //! Does nothing, see JEFrameArena::Reset().
+        void deallocate(T* ptr, size_t n) noexcept {}
+    };
+
+    template <typename T, typename U>
+    bool operator==(const JEFrameAllocator<T>& a, const JEFrameAllocator<U>& b) noexcept {
+        return a.m_arena == b.m_arena;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const JEFrameAllocator<T>& a, const JEFrameAllocator<U>& b) noexcept {
+        return a.m_arena != b.m_arena;
+    }
+
+    //! Vector whose storage lives in a JEFrameArena. Construct it with a JEFrameAllocator of any type, e.g.
+    //! JEFrameVector<uint32_t> indices(JEFrameAllocator<uint8_t>(&arena)).
+    template <typename T>
+    using JEFrameVector = std::vector<T, JEFrameAllocator<T>>;
+}
@@ -12,11 +12,23 @@ namespace JoeEngine {
             return _aligned_malloc(size, alignment);
             #endif
             
-            #ifdef JOE_ENGINE_PLATFORM_APPLE
-            void* buf;
-            posix_memalign(&buf, alignment, size);
+            #if defined(JOE_ENGINE_PLATFORM_APPLE) || defined(JOE_ENGINE_PLATFORM_LINUX)
+            void* buf = nullptr;
+            if (posix_memalign(&buf, alignment, size) != 0) {
+                return nullptr;
+            }
             return buf;
             #endif
         }
+
+        void alignedFree(void* buf) {
+            #ifdef JOE_ENGINE_PLATFORM_WINDOWS
+            _aligned_free(buf);
+            #endif
+
+            #if defined(JOE_ENGINE_PLATFORM_APPLE) || defined(JOE_ENGINE_PLATFORM_LINUX)
+            free(buf);
+            #endif
+        }
     }
 }
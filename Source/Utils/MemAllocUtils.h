@@ -12,5 +12,12 @@ namespace JoeEngine {
           \return pointer to the newly allocated buffer.
         */
         void* alignedAlloc(size_t alignment, size_t size);
+
+        //! Aligned free
+        /*!
+          Cross-platform function for freeing memory allocated with alignedAlloc().
+          \param buf the buffer to free.
+        */
+        void alignedFree(void* buf);
     }
 }
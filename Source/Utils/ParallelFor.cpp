@@ -0,0 +1,22 @@
+#include <algorithm>
+
+#include "ParallelFor.h"
+
+namespace JoeEngine {
+    namespace ParallelUtils {
+        uint32_t AdaptiveGrainSize(uint32_t count, uint32_t numProbed, uint64_t probeNanoseconds) {
+            // Jobs short enough that every thread, including the calling one, gets several of them
+            const uint64_t maxNumJobs = (uint64_t)(JEThreadPoolInstance.GetNumThreads() + 1) * JE_PARALLEL_FOR_JOBS_PER_THREAD;
+            const uint64_t balancedGrainSize = (count + maxNumJobs - 1) / maxNumJobs;
+
+            // Jobs long enough to be worth enqueuing. A probe too short to measure means the elements are very cheap.
+            uint64_t costGrainSize = count;
+            if (probeNanoseconds > 0) {
+                costGrainSize = std::min<uint64_t>(count, (JE_PARALLEL_FOR_TARGET_JOB_NS * numProbed + probeNanoseconds - 1) /
+                                                          probeNanoseconds);
+            }
+
+            return (uint32_t)std::max<uint64_t>(std::max(balancedGrainSize, costGrainSize), 1);
+        }
+    }
+}
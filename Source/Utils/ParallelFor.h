@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace JoeEngine {
+    //! Duration that an adaptively sized parallel loop job should at least take, in nanoseconds, so that enqueuing and
+    //! stealing it costs little in comparison.
+    constexpr uint64_t JE_PARALLEL_FOR_TARGET_JOB_NS = 10000;
+
+    //! Number of jobs per thread (including the calling thread) that an adaptively sized parallel loop is split into at
+    //! most, leaving room to balance uneven jobs.
+    constexpr uint32_t JE_PARALLEL_FOR_JOBS_PER_THREAD = 4;
+
+    //! Number of jobs a parallel loop can enqueue without allocating.
+    constexpr uint32_t JE_PARALLEL_FOR_INLINE_JOBS = 64;
+
+    //! Duration for which an adaptively sized parallel loop times its first elements on the calling thread, in nanoseconds.
+    constexpr uint64_t JE_PARALLEL_FOR_PROBE_NS = 1000;
+
+    namespace ParallelUtils {
+        //! Adaptive grain size.
+        /*!
+          Picks the grain size of a loop from its measured cost: each job should take at least JE_PARALLEL_FOR_TARGET_JOB_NS,
+          and there should be no more than JE_PARALLEL_FOR_JOBS_PER_THREAD jobs per thread.
+          \param count the number of elements left to process.
+          \param numProbed the number of elements that were timed.
+          \param probeNanoseconds the time it took to process them.
+          \return the grain size, at least one. The loop should run serially if it is at least 'count'.
+        */
+        uint32_t AdaptiveGrainSize(uint32_t count, uint32_t numProbed, uint64_t probeNanoseconds);
+
+        //! Range job of a parallel loop.
+        template <typename RangeFunction>
+        struct JEParallelRangeJob {
+            const RangeFunction* function;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        //! Thread pool job function.
+        template <typename RangeFunction>
+        void RunRange_MT(void* data) {
+            const JEParallelRangeJob<RangeFunction>* job = (const JEParallelRangeJob<RangeFunction>*)data;
+            (*job->function)(job->begin, job->end);
+        }
+
+        //! Run the first elements of a loop on the calling thread in growing ranges until JE_PARALLEL_FOR_PROBE_NS elapsed.
+        /*!
+          \return the number of elements processed, the time taken written to 'probeNanoseconds'.
+        */
+        template <typename RangeFunction>
+        uint32_t ProbeRange(uint32_t begin, uint32_t end, const RangeFunction& function, uint64_t* probeNanoseconds) {
+            using Clock = std::chrono::steady_clock;
+            const Clock::time_point startTime = Clock::now();
+            uint32_t rangeSize = 1;
+            uint32_t i = begin;
+            *probeNanoseconds = 0;
+            while (i < end) {
+                const uint32_t rangeEnd = end - i > rangeSize ? i + rangeSize : end;
+                function(i, rangeEnd);
+                i = rangeEnd;
+                *probeNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+                if (*probeNanoseconds >= JE_PARALLEL_FOR_PROBE_NS) {
+                    break;
+                }
+                rangeSize *= 2;
+            }
+            return i - begin;
+        }
+
+        //! Parallel for loop.
+        /*!
+          Splits [begin, end) into ranges of 'grainSize' elements and calls 'function(rangeBegin, rangeEnd)' on each, spread over
+          JEThreadPoolInstance and the calling thread. Returns once every range was processed. Ranges start at multiples of
+          'grainSize' from 'begin', so a fixed grain size lets the function index per-range output by
+          (rangeBegin - begin) / grainSize.
+          With a grain size of 0, the grain size adapts to the loop: the first elements are timed on the calling thread, then the
+          rest is split so that jobs are worth their overhead while all threads get several of them (see AdaptiveGrainSize()).
+          Cheap, short loops then run serially. The ranges differ from call to call.
+          May be called from thread pool jobs.
+          \param begin the first element.
+          \param end one past the last element.
+          \param grainSize the number of elements per range, or 0 to pick it adaptively.
+          \param function the range function, void(uint32_t rangeBegin, uint32_t rangeEnd). Called concurrently.
+        */
+        template <typename RangeFunction>
+        void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const RangeFunction& function) {
+            if (begin >= end) {
+                return;
+            }
+
+            if (grainSize == 0) {
+                uint64_t probeNanoseconds = 0;
+                const uint32_t numProbed = ProbeRange(begin, end, function, &probeNanoseconds);
+                begin += numProbed;
+                if (begin == end) {
+                    return;
+                }
+                grainSize = AdaptiveGrainSize(end - begin, numProbed, probeNanoseconds);
+            }
+
+            const uint32_t count = end - begin;
+            if (count <= grainSize) {
+                function(begin, end);
+                return;
+            }
+
+            // Hand all but the last range to the thread pool, run the last one on this thread, then wait for the others
+            const uint32_t numJobs = (count - 1) / grainSize + 1;
+            JEParallelRangeJob<RangeFunction> inlineJobs[JE_PARALLEL_FOR_INLINE_JOBS];
+            std::vector<JEParallelRangeJob<RangeFunction>> heapJobs;
+            JEParallelRangeJob<RangeFunction>* jobs = inlineJobs;
+            if (numJobs - 1 > JE_PARALLEL_FOR_INLINE_JOBS) {
+                heapJobs.resize(numJobs - 1);
+                jobs = heapJobs.data();
+            }
+            JEJobCounter jobCounter;
+            for (uint32_t j = 0; j < numJobs - 1; ++j) {
+                jobs[j] = { &function, begin + j * grainSize, begin + (j + 1) * grainSize };
+                JEThreadPoolInstance.EnqueueJob({ RunRange_MT<RangeFunction>, &jobs[j] }, &jobCounter);
+            }
+            function(begin + (numJobs - 1) * grainSize, end);
+            JEThreadPoolInstance.Wait(jobCounter);
+        }
+
+        //! Parallel reduction.
+        /*!
+          Splits [begin, end) into ranges like ParallelFor(), reduces each range with 'function(rangeBegin, rangeEnd)', then
+          combines the range results in order. 'combine' must be associative; it need not be commutative. With a fixed grain
+          size the result is deterministic, while an adaptive grain size may group e.g. floating-point sums differently from
+          call to call.
+          T must not be bool, as the range results are written concurrently.
+          \param begin the first element.
+          \param end one past the last element.
+          \param grainSize the number of elements per range, or 0 to pick it adaptively.
+          \param identity the result of an empty range.
+          \param function the range function, T(uint32_t rangeBegin, uint32_t rangeEnd). Called concurrently.
+          \param combine the combine function, T(const T& a, const T& b), for a range 'a' followed by a range 'b'.
+          \return the combined result.
+        */
+        template <typename T, typename RangeFunction, typename CombineFunction>
+        T ParallelReduce(uint32_t begin, uint32_t end, uint32_t grainSize, const T& identity, const RangeFunction& function,
+                         const CombineFunction& combine) {
+            T result = identity;
+            if (begin >= end) {
+                return result;
+            }
+
+            if (grainSize == 0) {
+                const auto probeFunction = [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+                    result = combine(result, function(rangeBegin, rangeEnd));
+                };
+                uint64_t probeNanoseconds = 0;
+                const uint32_t numProbed = ProbeRange(begin, end, probeFunction, &probeNanoseconds);
+                begin += numProbed;
+                if (begin == end) {
+                    return result;
+                }
+                grainSize = AdaptiveGrainSize(end - begin, numProbed, probeNanoseconds);
+            }
+
+            const uint32_t numRanges = (end - begin - 1) / grainSize + 1;
+            std::vector<T> rangeResults(numRanges, identity);
+            ParallelFor(begin, end, grainSize, [&](uint32_t rangeBegin, uint32_t rangeEnd) {
+                rangeResults[(rangeBegin - begin) / grainSize] = function(rangeBegin, rangeEnd);
+            });
+            for (uint32_t r = 0; r < numRanges; ++r) {
+                result = combine(result, rangeResults[r]);
+            }
+            return result;
+        }
+    }
+}
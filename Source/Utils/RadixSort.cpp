@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstring>
+
+#include "RadixSort.h"
+#include "ThreadPool.h"
+
+namespace JoeEngine {
+    namespace RadixSortUtils {
+        typedef struct radix_sort_job_data_t {
+            const uint64_t* srcKeys;
+            const uint32_t* srcValues;
+            uint64_t* dstKeys;
+            uint32_t* dstValues;
+            uint32_t begin;
+            uint32_t end;
+            uint32_t shift;
+            uint32_t counts[256];
+        } RadixSortJobData;
+
+        static void CountDigits(RadixSortJobData* job) {
+            std::memset(job->counts, 0, sizeof(job->counts));
+            for (uint32_t i = job->begin; i < job->end; ++i) {
+                ++job->counts[(job->srcKeys[i] >> job->shift) & 0xFF];
+            }
+        }
+
+        // Expects 'counts' to hold the first output position of each digit for this job's range
+        static void ScatterDigits(RadixSortJobData* job) {
+            for (uint32_t i = job->begin; i < job->end; ++i) {
+                const uint64_t key = job->srcKeys[i];
+                const uint32_t dst = job->counts[(key >> job->shift) & 0xFF]++;
+                job->dstKeys[dst] = key;
+                job->dstValues[dst] = job->srcValues[i];
+            }
+        }
+
+        static void CountDigits_MT(void* data) {
+            RadixSortJobData* job = (RadixSortJobData*)data;
+            CountDigits(job);
+        }
+
+        static void ScatterDigits_MT(void* data) {
+            RadixSortJobData* job = (RadixSortJobData*)data;
+            ScatterDigits(job);
+        }
+
+        // Hand all but the last job to the thread pool, run the last one on this thread, then wait for the others
+        static void RunJobs(void(*function)(void*), RadixSortJobData* jobs, uint32_t numJobs) {
+            JEJobCounter jobCounter;
+            for (uint32_t j = 0; j < numJobs - 1; ++j) {
+                JEThreadPoolInstance.EnqueueJob({ function, &jobs[j] }, &jobCounter);
+            }
+            function(&jobs[numJobs - 1]);
+            JEThreadPoolInstance.Wait(jobCounter);
+        }
+
+        void SortKeyValuePairs(uint64_t* keys, uint32_t* values, uint64_t* tmpKeys, uint32_t* tmpValues, uint32_t count,
+                               uint32_t numKeyBits) {
+            if (count < 2) {
+                return;
+            }
+
+            // Split each pass evenly into jobs of at least JE_RADIX_SORT_JOB_SIZE elements, so only inputs of at least two
+            // JE_RADIX_SORT_JOB_SIZE elements are split at all
+            const uint32_t numJobs = std::min(std::max(count / JE_RADIX_SORT_JOB_SIZE, 1u), JE_RADIX_SORT_MAX_JOBS);
+            RadixSortJobData jobs[JE_RADIX_SORT_MAX_JOBS];
+            for (uint32_t j = 0; j < numJobs; ++j) {
+                jobs[j].begin = (uint32_t)((uint64_t)count * j / numJobs);
+                jobs[j].end = (uint32_t)((uint64_t)count * (j + 1) / numJobs);
+            }
+
+            uint64_t* srcKeys = keys;
+            uint32_t* srcValues = values;
+            uint64_t* dstKeys = tmpKeys;
+            uint32_t* dstValues = tmpValues;
+
+            const uint32_t numPasses = (std::min(numKeyBits, 64u) + 7) / 8;
+            for (uint32_t pass = 0; pass < numPasses; ++pass) {
+                for (uint32_t j = 0; j < numJobs; ++j) {
+                    jobs[j].srcKeys = srcKeys;
+                    jobs[j].srcValues = srcValues;
+                    jobs[j].dstKeys = dstKeys;
+                    jobs[j].dstValues = dstValues;
+                    jobs[j].shift = pass * 8;
+                }
+
+                if (numJobs > 1) {
+                    RunJobs(CountDigits_MT, jobs, numJobs);
+                } else {
+                    CountDigits(&jobs[0]);
+                }
+
+                // Turn the per-job counts into output positions: by digit first, then by job so that the sort stays stable.
+                // If all keys share the same digit, this pass would not move anything.
+                uint32_t offset = 0;
+                bool skipPass = false;
+                for (uint32_t d = 0; d < 256 && !skipPass; ++d) {
+                    uint32_t digitCount = 0;
+                    for (uint32_t j = 0; j < numJobs; ++j) {
+                        const uint32_t jobCount = jobs[j].counts[d];
+                        jobs[j].counts[d] = offset;
+                        offset += jobCount;
+                        digitCount += jobCount;
+                    }
+                    skipPass = digitCount == count;
+                }
+                if (skipPass) {
+                    continue;
+                }
+
+                if (numJobs > 1) {
+                    RunJobs(ScatterDigits_MT, jobs, numJobs);
+                } else {
+                    ScatterDigits(&jobs[0]);
+                }
+
+                std::swap(srcKeys, dstKeys);
+                std::swap(srcValues, dstValues);
+            }
+
+            if (srcKeys != keys) {
+                std::memcpy(keys, srcKeys, count * sizeof(uint64_t));
+                std::memcpy(values, srcValues, count * sizeof(uint32_t));
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace JoeEngine {
+    //! Minimum number of elements per radix sort thread job. Smaller inputs are sorted on the calling thread.
+    constexpr uint32_t JE_RADIX_SORT_JOB_SIZE = 16384;
+
+    //! Maximum number of thread jobs per radix sort pass.
+    constexpr uint32_t JE_RADIX_SORT_MAX_JOBS = 32;
+
+    namespace RadixSortUtils {
+        //! Number of bits needed to store values up to the specified maximum.
+        /*!
+          \param maxValue the largest value to store.
+          \return the number of bits needed, zero if the maximum is zero.
+        */
+        inline uint32_t NumBitsNeeded(uint64_t maxValue) {
+            uint32_t numBits = 0;
+            while (maxValue != 0) {
+                ++numBits;
+                maxValue >>= 1;
+            }
+            return numBits;
+        }
+
+        //! Sort keys with an attached value.
+        /*!
+          Stable LSD radix sort of 64-bit keys, one byte per pass, carrying a 32-bit value (e.g. an index) along with each key.
+          Passes over bytes above 'numKeyBits', and passes where every key has the same byte, are skipped. Inputs of at least
+          two JE_RADIX_SORT_JOB_SIZE elements split each pass over JEThreadPoolInstance.
+          \param keys the keys to sort, sorted in place.
+          \param values the values attached to the keys, reordered along with them.
+          \param tmpKeys scratch space for 'count' keys.
+          \param tmpValues scratch space for 'count' values.
+          \param count the number of keys.
+          \param numKeyBits the number of low key bits that can be non-zero.
+        */
+        void SortKeyValuePairs(uint64_t* keys, uint32_t* values, uint64_t* tmpKeys, uint32_t* tmpValues, uint32_t count,
+                               uint32_t numKeyBits = 64);
+    }
+}
@@ -1,42 +1,302 @@
+#include "JoeEngineConfig.h"
+
+#ifdef JOE_ENGINE_PLATFORM_WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+#if defined(JOE_ENGINE_PLATFORM_APPLE) || defined(JOE_ENGINE_PLATFORM_LINUX)
+#include <pthread.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 #include "ThreadPool.h"
 
 namespace JoeEngine {
     // Define extern threadpool object
-    JEThreadPool JEThreadPoolInstance = JEThreadPool();
+    JEThreadPool JEThreadPoolInstance;
 
-    // Atomically enqueue a new job
-    void JEThreadPool::EnqueueJob(JEThreadJob job) {
-        {
-            std::unique_lock <std::mutex> lock(m_mutex_queue);
-            m_jobs.push(job);
+    // The pool and deque of the calling thread. External threads are assigned a deque on their first enqueue.
+    static thread_local const JEThreadPool* t_pool = nullptr;
+    static thread_local uint32_t t_dequeIndex = 0;
+
+    // Random number state (xorshift) of the calling thread, used to pick the first deque to steal from so that thieves spread out
+    static thread_local uint32_t t_randomState = 0x9E3779B9u;
+
+    // Hint to the CPU that this is a spin-wait loop
+    static inline void CpuRelax() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    // Back off after a round without finding a job: spin a little longer each round, then yield the core
+    static void IdleBackoff(uint32_t idleRound) {
+        if (idleRound < JE_THREAD_POOL_IDLE_ROUNDS / 2) {
+            for (uint32_t i = 0; i < (1u << std::min(idleRound, 6u)); ++i) {
+                CpuRelax();
+            }
+        } else {
+            std::this_thread::yield();
         }
-        m_cv_queue.notify_one();
     }
 
-    // Get a job from the queue - should be called while the queue mutex is locked
-    JEThreadJob JEThreadPool::DequeueJob() {
-        JEThreadJob job;
-        job = m_jobs.front();
-        m_jobs.pop();
-        return job;
+    // Name the calling thread for profilers and debuggers, and pin it to a hardware thread unless it is negative
+    static void ConfigureCurrentThread(const std::string& name, int32_t hardwareThread) {
+        #ifdef JOE_ENGINE_PLATFORM_WINDOWS
+        const std::wstring wideName(name.begin(), name.end());
+        SetThreadDescription(GetCurrentThread(), wideName.c_str());
+        // Only the first processor group can be targeted this way
+        if (hardwareThread >= 0 && hardwareThread < 64) {
+            SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << hardwareThread);
+        }
+        #endif
+
+        #ifdef JOE_ENGINE_PLATFORM_LINUX
+        // Thread names are limited to 15 characters
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+        if (hardwareThread >= 0 && hardwareThread < CPU_SETSIZE) {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(hardwareThread, &cpuSet);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+        }
+        #endif
+
+        #ifdef JOE_ENGINE_PLATFORM_APPLE
+        // macOS has no thread pinning, only affinity hints
+        pthread_setname_np(name.c_str());
+        #endif
     }
 
-    void JEThreadPool::ThreadDoJob(JEThreadJob threadJob) {
-        threadJob.function(threadJob.data);
+    bool JEJobDeque::Push(const JEQueuedJob& job) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= (int64_t)JE_THREAD_POOL_DEQUE_CAPACITY) {
+            return false;
+        }
+
+        JEJobSlot& slot = m_slots[bottom % JE_THREAD_POOL_DEQUE_CAPACITY];
+        slot.function.store(job.job.function, std::memory_order_relaxed);
+        slot.data.store(job.job.data, std::memory_order_relaxed);
+        slot.counter.store(job.counter, std::memory_order_relaxed);
+        // Publish the slot to thieves
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
     }
 
-    // Infinite loop - thread only gets launched once.
-    void JEThreadPool::ThreadFunction() {
-        while (true) {
-            JEThreadJob job;
+    bool JEJobDeque::Pop(JEQueuedJob* job) {
+        // Reserve the newest job before looking at the top, so that a concurrent thief either sees the reservation or is seen
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        if (top > bottom) {
+            // Empty
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const JEJobSlot& slot = m_slots[bottom % JE_THREAD_POOL_DEQUE_CAPACITY];
+        job->job.function = slot.function.load(std::memory_order_relaxed);
+        job->job.data = slot.data.load(std::memory_order_relaxed);
+        job->counter = slot.counter.load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last job: race the thieves for it
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool JEJobDeque::Steal(JEQueuedJob* job) {
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom) {
+            return false;
+        }
+
+        const JEJobSlot& slot = m_slots[top % JE_THREAD_POOL_DEQUE_CAPACITY];
+        job->job.function = slot.function.load(std::memory_order_relaxed);
+        job->job.data = slot.data.load(std::memory_order_relaxed);
+        job->counter = slot.counter.load(std::memory_order_relaxed);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    JEThreadPool::JEThreadPool() : m_numWorkers(0), m_numExternalThreads(0), m_numOverflowJobs(0), m_numQueuedJobs(0),
+                                   m_numParkedThreads(0), m_quit(false), m_started(false) {
+        for (uint32_t d = 0; d < JE_THREAD_POOL_MAX_EXTERNAL_THREADS; ++d) {
+            m_deques.emplace_back(new JEJobDeque());
+        }
+    }
+
+    void JEThreadPool::Start(const JEThreadPoolSettings& settings) {
+        if (m_started) {
+            throw std::runtime_error("Thread pool already started");
+        }
+        m_started = true;
+
+        // Hardware threads are handed out to the main thread first, then the reserved threads, then the workers
+        const uint32_t numHardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        const uint32_t numReservedThreads = std::min(settings.numReservedThreads, numHardwareThreads);
+        const uint32_t firstWorkerHardwareThread = (settings.mainThreadRunsJobs ? 1 : 0) + numReservedThreads;
+        m_numWorkers = settings.numWorkers;
+        if (m_numWorkers == 0) {
+            m_numWorkers = numHardwareThreads > firstWorkerHardwareThread ? numHardwareThreads - firstWorkerHardwareThread : 1;
+        }
+        m_numWorkers = std::min(m_numWorkers, JE_THREAD_POOL_MAX_WORKERS);
+
+        // All deques must exist before any thread starts stealing from them
+        for (uint32_t w = 0; w < m_numWorkers; ++w) {
+            m_deques.emplace_back(new JEJobDeque());
+        }
+        for (uint32_t w = 0; w < m_numWorkers; ++w) {
+            const int32_t hardwareThread = settings.pinWorkers ? (int32_t)((firstWorkerHardwareThread + w) % numHardwareThreads) : -1;
+            m_threads.emplace_back(std::thread([this, w, hardwareThread] { ThreadFunction(w, hardwareThread); }));
+        }
+    }
+
+    uint32_t JEThreadPool::GetThreadDequeIndex() {
+        if (t_pool != this) {
+            const uint32_t externalIdx = m_numExternalThreads.fetch_add(1, std::memory_order_relaxed);
+            t_pool = this;
+            t_dequeIndex = externalIdx < JE_THREAD_POOL_MAX_EXTERNAL_THREADS ? externalIdx : JE_THREAD_POOL_NO_DEQUE;
+        }
+        return t_dequeIndex;
+    }
+
+    void JEThreadPool::EnqueueJob(JEThreadJob job, JEJobCounter* counter) {
+        if (counter) {
+            counter->m_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const JEQueuedJob queuedJob = { job, counter };
+        const uint32_t dequeIdx = GetThreadDequeIndex();
+        if (dequeIdx == JE_THREAD_POOL_NO_DEQUE || !m_deques[dequeIdx]->Push(queuedJob)) {
+            std::unique_lock<std::mutex> lock(m_mutex_queue);
+            m_jobs.push(queuedJob);
+            m_numOverflowJobs.fetch_add(1, std::memory_order_release);
+        }
+
+        // Either a parking worker sees the new job count, or this sees the parked worker and wakes it. Locking the mutex makes sure
+        // the worker is waiting on the condition variable before it is notified.
+        m_numQueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+        if (m_numParkedThreads.load(std::memory_order_seq_cst) > 0) {
             {
                 std::unique_lock<std::mutex> lock(m_mutex_queue);
-                m_cv_queue.wait(lock, [this] { return !m_jobs.empty() || (m_jobs.empty() && m_quit); });
-                if (m_quit) return;
-                job = DequeueJob();
             }
-            ThreadDoJob(job);
-            job.complete = true;
+            m_cv_queue.notify_one();
+        }
+    }
+
+    bool JEThreadPool::TakeJob(uint32_t dequeIndex, JEQueuedJob* job) {
+        if (dequeIndex != JE_THREAD_POOL_NO_DEQUE && m_deques[dequeIndex]->Pop(job)) {
+            m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Steal from the other deques, starting at a random one
+        const uint32_t numDeques = (uint32_t)m_deques.size();
+        t_randomState ^= t_randomState << 13;
+        t_randomState ^= t_randomState >> 17;
+        t_randomState ^= t_randomState << 5;
+        const uint32_t firstVictim = t_randomState % numDeques;
+        for (uint32_t i = 0; i < numDeques; ++i) {
+            const uint32_t victim = (firstVictim + i) % numDeques;
+            if (victim != dequeIndex && m_deques[victim]->Steal(job)) {
+                m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        if (m_numOverflowJobs.load(std::memory_order_acquire) > 0) {
+            std::unique_lock<std::mutex> lock(m_mutex_queue);
+            if (!m_jobs.empty()) {
+                *job = m_jobs.front();
+                m_jobs.pop();
+                m_numOverflowJobs.fetch_sub(1, std::memory_order_relaxed);
+                m_numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void JEThreadPool::ThreadDoJob(const JEQueuedJob& threadJob) {
+        threadJob.job.function(threadJob.job.data);
+        if (threadJob.counter) {
+            // Release the job's writes to the waiter
+            threadJob.counter->m_count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    bool JEThreadPool::RunPendingJob() {
+        JEQueuedJob job;
+        if (!TakeJob(GetThreadDequeIndex(), &job)) {
+            return false;
+        }
+        ThreadDoJob(job);
+        return true;
+    }
+
+    void JEThreadPool::Wait(const JEJobCounter& counter) {
+        const uint32_t dequeIdx = GetThreadDequeIndex();
+        uint32_t idleRounds = 0;
+        while (!counter.IsDone()) {
+            JEQueuedJob job;
+            if (TakeJob(dequeIdx, &job)) {
+                ThreadDoJob(job);
+                idleRounds = 0;
+            } else {
+                // The remaining jobs are running on other threads. Never park here, as nothing signals the counter.
+                IdleBackoff(std::min(idleRounds++, JE_THREAD_POOL_IDLE_ROUNDS));
+            }
+        }
+    }
+
+    // Infinite loop - thread only gets launched once.
+    void JEThreadPool::ThreadFunction(uint32_t workerIndex, int32_t hardwareThread) {
+        ConfigureCurrentThread("JE Worker " + std::to_string(workerIndex), hardwareThread);
+
+        const uint32_t dequeIndex = JE_THREAD_POOL_MAX_EXTERNAL_THREADS + workerIndex;
+        t_pool = this;
+        t_dequeIndex = dequeIndex;
+        t_randomState = 0x9E3779B9u * (dequeIndex + 1);
+
+        uint32_t idleRounds = 0;
+        while (!m_quit.load(std::memory_order_acquire)) {
+            JEQueuedJob job;
+            if (TakeJob(dequeIndex, &job)) {
+                ThreadDoJob(job);
+                idleRounds = 0;
+                continue;
+            }
+
+            // Nothing to do: back off, then park
+            if (idleRounds < JE_THREAD_POOL_IDLE_ROUNDS) {
+                IdleBackoff(idleRounds++);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex_queue);
+            m_numParkedThreads.fetch_add(1, std::memory_order_seq_cst);
+            m_cv_queue.wait(lock, [this] {
+                return m_numQueuedJobs.load(std::memory_order_seq_cst) > 0 || m_quit.load(std::memory_order_relaxed);
+            });
+            m_numParkedThreads.fetch_sub(1, std::memory_order_relaxed);
+            idleRounds = 0;
         }
     }
 
@@ -48,9 +308,9 @@ namespace JoeEngine {
     }
 
     void JEThreadPool::StopThreadJobs() {
-        m_quit = true;
         {
             std::unique_lock<std::mutex> lock(m_mutex_queue);
+            m_quit.store(true, std::memory_order_release);
             while (!m_jobs.empty()) {
                 m_jobs.pop();
             }
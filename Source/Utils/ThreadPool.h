@@ -1,11 +1,45 @@
 #pragma once
 
-#include <thread>
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
 namespace JoeEngine {
+    //! Capacity of each thread's job deque. Jobs pushed to a full deque go to the pool's shared overflow queue instead.
+    constexpr uint32_t JE_THREAD_POOL_DEQUE_CAPACITY = 4096;
+
+    //! Number of threads outside of the pool (e.g. the main thread) that get a job deque of their own. Any further threads
+    //! enqueue their jobs to the shared overflow queue.
+    constexpr uint32_t JE_THREAD_POOL_MAX_EXTERNAL_THREADS = 4;
+
+    //! Maximum number of worker threads. Start() clamps the requested number of workers to this.
+    constexpr uint32_t JE_THREAD_POOL_MAX_WORKERS = 256;
+
+    //! Number of rounds an idle worker looks for a job, backing off a little more each round, before it parks.
+    constexpr uint32_t JE_THREAD_POOL_IDLE_ROUNDS = 64;
+
+    //! Thread pool settings.
+    typedef struct je_thread_pool_settings_t {
+        //! Number of worker threads. 0 launches one per hardware thread that is not left to the main thread or reserved, but at
+        //! least one. Clamped to JE_THREAD_POOL_MAX_WORKERS.
+        uint32_t numWorkers = 0;
+
+        //! Number of hardware threads to keep the workers off of, e.g. for a render/submit thread.
+        uint32_t numReservedThreads = 0;
+
+        //! Whether to leave a hardware thread to the main thread, which runs jobs while it waits on them.
+        bool mainThreadRunsJobs = true;
+
+        //! Whether to pin each worker to its own hardware thread, after those left to the main thread and reserved threads.
+        //! Workers wrap around to the first hardware threads if there are more workers than hardware threads.
+        bool pinWorkers = false;
+    } JEThreadPoolSettings;
+
     // Sample data/function
     /*struct je_sample_data_t {
         std::string name;
@@ -18,81 +52,215 @@ namespace JoeEngine {
      * Example usage:
        je_sample_data_t data = { "Work not done yet", -1 };
        void* dataPtr = &data;
-       thread_job_t job = { &f, dataPtr, false }; // where f looks like: void f(void*)
+       thread_job_t job = { &f, dataPtr }; // where f looks like: void f(void*)
     */
     //! Thread Job struct
     /*!
-      Data for executing any threaded task.
+      Data for executing any threaded task. Wait for the job with the JEJobCounter it was enqueued with.
     */
     typedef struct je_thread_job_t {
         void(*function)(void*);
         void* data;
-        bool complete;
     } JEThreadJob;
 
+    //! The JEJobCounter class
+    /*!
+      Wait group for thread jobs: counts the jobs enqueued with it that have not finished running yet. A job's writes are released
+      when it finishes and acquired by any thread that then sees the counter done, so the job's output can be read without further
+      synchronization.
+      A counter can be reused once it is done.
+      \sa JEThreadPool
+    */
+    class JEJobCounter {
+    private:
+        //! Number of unfinished jobs.
+        std::atomic<uint32_t> m_count;
+
+        friend class JEThreadPool;
+
+    public:
+        //! Default constructor.
+        JEJobCounter() : m_count(0) {}
+
+        //! Destructor (default).
+        ~JEJobCounter() = default;
+
+        JEJobCounter(const JEJobCounter& counter) = delete;
+        JEJobCounter& operator=(const JEJobCounter& counter) = delete;
+
+        //! Whether every job enqueued with the counter finished running.
+        bool IsDone() const {
+            return m_count.load(std::memory_order_acquire) == 0;
+        }
+    };
+
+    //! Enqueued job struct
+    /*! A thread job along with the counter to count down once it ran. */
+    typedef struct je_queued_job_t {
+        JEThreadJob job;
+
+        //! Counter to count down, or nullptr.
+        JEJobCounter* counter;
+    } JEQueuedJob;
+
+    //! The JEJobDeque class
+    /*!
+      Fixed-capacity Chase-Lev work-stealing deque. The owning thread pushes and pops jobs at the bottom without locking, while any
+      other thread may steal the oldest job from the top with a single compare-and-swap.
+      \sa JEThreadPool
+    */
+    class JEJobDeque {
+    private:
+        //! Job storage slot. The fields are atomic as a thief may read a slot while the owner reuses it; such a read is discarded
+        //! as the thief's compare-and-swap then fails.
+        typedef struct je_job_slot_t {
+            std::atomic<void(*)(void*)> function;
+            std::atomic<void*> data;
+            std::atomic<JEJobCounter*> counter;
+        } JEJobSlot;
+
+        //! Index of the oldest job, advanced by steals (and by the owner's pop of the last job).
+        alignas(64) std::atomic<int64_t> m_top;
+
+        //! Index one past the newest job, only written by the owner.
+        alignas(64) std::atomic<int64_t> m_bottom;
+
+        //! Ring buffer of JE_THREAD_POOL_DEQUE_CAPACITY job slots.
+        std::unique_ptr<JEJobSlot[]> m_slots;
+
+    public:
+        //! Default constructor.
+        JEJobDeque() : m_top(0), m_bottom(0), m_slots(new JEJobSlot[JE_THREAD_POOL_DEQUE_CAPACITY]()) {}
+
+        //! Destructor (default).
+        ~JEJobDeque() = default;
+
+        JEJobDeque(const JEJobDeque& deque) = delete;
+        JEJobDeque& operator=(const JEJobDeque& deque) = delete;
+
+        //! Push a job. Owner thread only.
+        /*!
+          \param job the job to push.
+          \return false if the deque is full.
+        */
+        bool Push(const JEQueuedJob& job);
+
+        //! Pop the newest job. Owner thread only.
+        /*!
+          \param job output for the popped job.
+          \return false if the deque is empty.
+        */
+        bool Pop(JEQueuedJob* job);
+
+        //! Steal the oldest job. Any thread.
+        /*!
+          \param job output for the stolen job.
+          \return false if the deque is empty or another thread took the job first.
+        */
+        bool Steal(JEQueuedJob* job);
+    };
+
     // https://stackoverflow.com/questions/15752659/thread-pooling-in-c11
     // Why not use std::async? https://eli.thegreenplace.net/2016/the-promises-and-challenges-of-stdasync-task-based-parallelism-in-c11/
     //! The JEThreadPool class
     /*!
-      Class that manages any number of threads and a queue of tasks to complete. Threads are created and launched upon construction.
-      Threads run in an infinite loop, block until the queue is populated with a task (or multiple), then execute the task.
+      Work-stealing thread pool. Threads are created and launched by Start(), according to JEThreadPoolSettings. Workers are named
+      "JE Worker <index>" for profilers and debuggers, and optionally pinned to hardware threads.
+      Until the pool is started, jobs are run by the threads that wait on them.
+      Every worker, and each of the first JE_THREAD_POOL_MAX_EXTERNAL_THREADS other threads to enqueue a job, owns a JEJobDeque:
+      enqueued jobs go to the calling thread's deque without any locking. Workers run the jobs of their own deque newest first,
+      and once it is empty steal the oldest jobs from the other deques, starting at a random one. A worker that finds no job
+      spins with increasing backoff for JE_THREAD_POOL_IDLE_ROUNDS rounds, then parks until a job is enqueued.
+      A shared, mutex-guarded overflow queue takes the jobs of full deques and of threads without a deque.
+      Jobs enqueued with a JEJobCounter can be waited on with Wait(), which runs pending jobs on the waiting thread in the meantime.
+      This also lets jobs enqueue and wait on nested jobs without tying up their worker.
     */
     class JEThreadPool {
     private:
+        //! Number of worker threads.
+        uint32_t m_numWorkers;
+
+        //! Job deques. The first JE_THREAD_POOL_MAX_EXTERNAL_THREADS belong to external threads, the others to the workers.
+        std::vector<std::unique_ptr<JEJobDeque>> m_deques;
+
+        //! Number of external threads that requested a deque, which may exceed JE_THREAD_POOL_MAX_EXTERNAL_THREADS.
+        std::atomic<uint32_t> m_numExternalThreads;
+
         //! Queue access mutex.
-        /*! Synchronizes threads pushing/popping jobs on/off the queue. */
+        /*! Synchronizes the overflow queue and the parking of idle workers. */
         std::mutex m_mutex_queue;
 
-        //! Queue access condition variable.
-        /*! Condition variable that is waiting on by each thread in the pool. Notified when a job is added to the queue. */
+        //! Parking condition variable.
+        /*! Waited on by parked workers. Notified when a job is enqueued while any worker is parked. */
         std::condition_variable m_cv_queue;
 
+        //! Overflow queue of thread jobs.
+        /*! Jobs that did not fit in (or had no) deque. */
+        std::queue<JEQueuedJob> m_jobs;
+
+        //! Number of jobs in the overflow queue, checked before locking it.
+        std::atomic<uint32_t> m_numOverflowJobs;
+
+        //! Number of enqueued jobs not yet taken by any thread. May briefly be negative while a job is being enqueued.
+        std::atomic<int64_t> m_numQueuedJobs;
+
+        //! Number of parked workers.
+        std::atomic<uint32_t> m_numParkedThreads;
+
         //! List of threads.
         /*! List of each thread in the pool. */
         std::vector<std::thread> m_threads;
 
-        //! Queue of thread jobs.
-        /*! Queue of each job for the pool of threads to execute. */
-        std::queue<JEThreadJob> m_jobs;
-
         //! Threadpool stopping flag.
         /*! Member flag that is set to true when the thread pool should be destroyed. */
-        bool m_quit;
+        std::atomic<bool> m_quit;
+
+        //! Whether Start() was called.
+        bool m_started;
+
+        //! Deque index of threads without a deque.
+        static constexpr uint32_t JE_THREAD_POOL_NO_DEQUE = 0xFFFFFFFF;
 
         //! Thread execution function.
-        /*! Function that each thread in the pool executes. Synchronously obtains and executes jobs from the job queue. */
-        void ThreadFunction(); // Runs threads on an infinite loop until a job
+        /*!
+          Function that each thread in the pool executes. Names (and optionally pins) the thread, then runs jobs until the pool
+          is stopped.
+          \param workerIndex the index of the worker.
+          \param hardwareThread the hardware thread to pin the worker to, or -1 to leave it unpinned.
+        */
+        void ThreadFunction(uint32_t workerIndex, int32_t hardwareThread);
+
+        //! Get the calling thread's deque, assigning one to external threads on their first call.
+        /*! \return the deque index, or JE_THREAD_POOL_NO_DEQUE if the thread has none. */
+        uint32_t GetThreadDequeIndex();
 
-        //! Dequeue thread job.
+        //! Take a job: from the thread's own deque, else stolen from another deque, else from the overflow queue.
         /*!
-          Removes a job from the job queue.
-          \return the dequeued job.
+          \param dequeIndex the calling thread's deque index, or JE_THREAD_POOL_NO_DEQUE if it has none.
+          \param job output for the job.
+          \return false if no job was found.
         */
-        JEThreadJob DequeueJob();
+        bool TakeJob(uint32_t dequeIndex, JEQueuedJob* job);
 
         //! Perform thread job.
         /*!
-          Helper function for executing a job's function on its data.
+          Helper function for executing a job's function on its data, then counting down its counter.
           \param threadJob the job to execute.
         */
-        void ThreadDoJob(JEThreadJob threadJob);
+        void ThreadDoJob(const JEQueuedJob& threadJob);
 
         //! Join threads.
         /*! Rejoin all threads in the pool to the main thread before terminating the application. */
         void JoinThreads();
 
         //! Stop thread pool.
-        /*! Completely stop the threadpool, remove all jobs, and join all threads. */
+        /*! Completely stop the threadpool and wake up all threads. Jobs that were not started are dropped. */
         void StopThreadJobs();
 
     public:
-        //! Constructor.
-        /*! Creates and launches all threads in the pool. */
-        JEThreadPool() : m_quit(false) {
-            for (uint32_t t = 0; t < std::thread::hardware_concurrency(); ++t) { // TODO: one less than main thread?
-                m_threads.emplace_back(std::thread([this] { ThreadFunction(); }));
-            }
-        }
+        //! Default constructor.
+        /*! Creates the external threads' deques. No workers are launched until Start() is called. */
+        JEThreadPool();
 
         //! Destructor.
         /*! Joins threads. */
@@ -100,12 +268,44 @@ namespace JoeEngine {
             JoinThreads();
         }
 
+        JEThreadPool(const JEThreadPool& pool) = delete;
+        JEThreadPool& operator=(const JEThreadPool& pool) = delete;
+
+        //! Launch the worker threads.
+        /*!
+          Must not be called while other threads use the pool. Throws an error if the pool was already started.
+          \param settings the thread pool settings.
+        */
+        void Start(const JEThreadPoolSettings& settings);
+
+        //! Whether Start() was called.
+        bool IsStarted() const {
+            return m_started;
+        }
+
         //! Enqueue thread job.
         /*!
-          Synchronously add a new thread job to the job queue.
+          Push a new thread job to the calling thread's deque, from which any worker may take it.
           \param job the job to enqueue.
+          \param counter optional counter to count the job with until it finished running.
         */
-        void EnqueueJob(JEThreadJob job);
+        void EnqueueJob(JEThreadJob job, JEJobCounter* counter = nullptr);
+
+        //! Wait for every job counted by a counter to finish.
+        /*!
+          Runs pending jobs on the calling thread while waiting - its own jobs first - and spins with backoff when there are none.
+          \param counter the counter to wait on.
+        */
+        void Wait(const JEJobCounter& counter);
+
+        //! Run one pending job on the calling thread.
+        /*! \return false if no job was pending. */
+        bool RunPendingJob();
+
+        //! Get the number of worker threads, 0 until the pool is started.
+        uint32_t GetNumThreads() const {
+            return m_numWorkers;
+        }
     };
 
     //! Thread pool instance.
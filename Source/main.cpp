@@ -1,15 +1,31 @@
 #include <iostream>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include "EngineInstance.h"
 #include "Components/Rotator/RotatorComponentManager.h"
 
-int RunApp() {
+int RunApp(bool headless, uint32_t numHeadlessFrames, bool pipelined, const JoeEngine::JEThreadPoolSettings& threadPoolSettings) {
     try {
         JoeEngine::RendererSettings rendererSettings = JoeEngine::RendererSettings::EnableDeferred;
         rendererSettings = rendererSettings | JoeEngine::RendererSettings::EnableOIT;
-        JoeEngine::JEEngineInstance app = JoeEngine::JEEngineInstance(rendererSettings);
+        if (headless) {
+            rendererSettings = rendererSettings | JoeEngine::RendererSettings::Headless;
+        }
+        if (pipelined) {
+            rendererSettings = rendererSettings | JoeEngine::RendererSettings::PipelinedFrames;
+        }
+        JoeEngine::JEEngineInstance app = JoeEngine::JEEngineInstance(rendererSettings, threadPoolSettings);
         app.RegisterComponentManager<RotatorComponent, RotatorComponentManager>();
         app.LoadScene(2);
-        app.Run();
+        if (headless) {
+            app.RunHeadless(numHeadlessFrames);
+        } else {
+            app.Run();
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
@@ -17,6 +33,63 @@ int RunApp() {
     return EXIT_SUCCESS;
 }
 
-int main() {
-    return RunApp();
+static const char* USAGE =
+    "Usage: JoeEngine [--headless [numFrames]] [--pipelined] [--worker-threads count] [--reserve-threads count] [--pin-threads]";
+
+// Parses a non-negative decimal count no greater than maxValue. Returns false if the argument is not one.
+bool ParseCount(const char* arg, uint32_t maxValue, uint32_t* value) {
+    // strtoul would accept leading whitespace and signs, and wrap negative values around
+    if (!std::isdigit(static_cast<unsigned char>(arg[0]))) {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(arg, &end, 10);
+    if (errno == ERANGE || *end != '\0' || parsed > maxValue) {
+        return false;
+    }
+    *value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool headless = false;
+    uint32_t numHeadlessFrames = JoeEngine::JE_DEFAULT_HEADLESS_NUM_FRAMES;
+    bool pipelined = false;
+    JoeEngine::JEThreadPoolSettings threadPoolSettings;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-' && !ParseCount(argv[++i], UINT32_MAX, &numHeadlessFrames)) {
+                std::cerr << "Invalid number of headless frames: " << argv[i] << "\n" << USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = true;
+        } else if (std::strcmp(argv[i], "--worker-threads") == 0) {
+            if (i + 1 == argc) {
+                std::cerr << "Missing value for " << argv[i] << "\n" << USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!ParseCount(argv[++i], JoeEngine::JE_THREAD_POOL_MAX_WORKERS, &threadPoolSettings.numWorkers)) {
+                std::cerr << "Invalid number of worker threads: " << argv[i] << "\n" << USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--reserve-threads") == 0) {
+            if (i + 1 == argc) {
+                std::cerr << "Missing value for " << argv[i] << "\n" << USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!ParseCount(argv[++i], JoeEngine::JE_THREAD_POOL_MAX_WORKERS, &threadPoolSettings.numReservedThreads)) {
+                std::cerr << "Invalid number of reserved threads: " << argv[i] << "\n" << USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--pin-threads") == 0) {
+            threadPoolSettings.pinWorkers = true;
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << "\n" << USAGE << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return RunApp(headless, numHeadlessFrames, pipelined, threadPoolSettings);
 }
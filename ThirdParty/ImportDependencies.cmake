@@ -72,6 +72,15 @@ if (${CMAKE_SYSTEM_NAME} MATCHES "Darwin")
     target_link_libraries(JoeEngine ${OPENGL})
 endif()
 
+# If on Linux, GLFW's X11 backend needs X11, pthreads and libdl
+if (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
+    find_package(X11 REQUIRED)
+    target_link_libraries(JoeEngine ${X11_LIBRARIES})
+
+    find_package(Threads REQUIRED)
+    target_link_libraries(JoeEngine Threads::Threads ${CMAKE_DL_LIBS} m)
+endif()
+
 # GLM
 ExternalProject_Add(
   GLM